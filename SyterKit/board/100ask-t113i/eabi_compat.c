@@ -1,6 +1,9 @@
 /* SPDX-License-Identifier: GPL-2.0+ */
 
+#include <log.h>
+
 void abort(void) {
+	log_flush();
 	while (1)
 		;
 }
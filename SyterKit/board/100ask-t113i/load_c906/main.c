@@ -18,10 +18,10 @@
 #include "sys-spi.h"
 
 #include "elf_loader.h"
+#include "fatfs_loader.h"
 #include "ff.h"
 
 #define CONFIG_RISCV_ELF_FILENAME "c906.elf"
-#define CONFIG_RISCV_ELF_LOADADDR (0x45000000)
 
 #define CONFIG_RISCV_OPENSBI_FILENAME "fw_jump.bin"
 #define CONFIG_RISCV_OPENSBI_LOADADDR (0x41fc0000)
@@ -39,7 +39,7 @@ extern dram_para_t dram_para;
 
 #define FILENAME_MAX_LEN 64
 typedef struct {
-	unsigned char *dest;
+	phys_addr_t entry;
 	char filename[FILENAME_MAX_LEN];
 
 	unsigned char *sbi_dest;
@@ -51,51 +51,6 @@ typedef struct {
 
 image_info_t image;
 
-#define CHUNK_SIZE 0x20000
-
-static int fatfs_loadimage(char *filename, BYTE *dest) {
-	FIL file;
-	UINT byte_to_read = CHUNK_SIZE;
-	UINT byte_read;
-	UINT total_read = 0;
-	FRESULT fret;
-	int ret;
-	uint32_t start, time;
-
-	fret = f_open(&file, filename, FA_OPEN_EXISTING | FA_READ);
-	if (fret != FR_OK) {
-		printk_error("FATFS: open, filename: [%s]: error %d\n", filename, fret);
-		ret = -1;
-		goto open_fail;
-	}
-
-	start = time_ms();
-
-	do {
-		byte_read = 0;
-		fret = f_read(&file, (void *) (dest), byte_to_read, &byte_read);
-		dest += byte_to_read;
-		total_read += byte_read;
-	} while (byte_read >= byte_to_read && fret == FR_OK);
-
-	time = time_ms() - start + 1;
-
-	if (fret != FR_OK) {
-		printk_error("FATFS: read: error %d\n", fret);
-		ret = -1;
-		goto read_fail;
-	}
-	ret = 0;
-
-read_fail:
-	fret = f_close(&file);
-
-	printk_debug("FATFS: read in %ums at %.2fMB/S\n", time, (f32) (total_read / time) / 1024.0f);
-
-open_fail:
-	return ret;
-}
-
 static int load_sdcard(image_info_t *image) {
 	FATFS fs;
 	FRESULT fret;
@@ -118,18 +73,23 @@ static int load_sdcard(image_info_t *image) {
 		printk_debug("FATFS: mount OK\n");
 	}
 
-	printk_info("FATFS: read %s addr=%x\n", image->filename, (unsigned int) image->dest);
-	ret = fatfs_loadimage(image->filename, image->dest);
-	if (ret)
-		return ret;
+	/* load OpenSBI and U-Boot in one LBA ordered pass */
+	fatfs_load_entry_t files[] = {
+			{.filename = image->sbi_filename, .dest = image->sbi_dest},
+			{.filename = image->uboot_filename, .dest = image->uboot_dest},
+	};
+
+	for (int i = 0; i < ARRAY_SIZE(files); i++) {
+		printk_info("FATFS: read %s addr=%x\n", files[i].filename, (unsigned int) files[i].dest);
+	}
 
-	printk_info("FATFS: read %s addr=%x\n", image->sbi_filename, (unsigned int) image->sbi_dest);
-	ret = fatfs_loadimage(image->sbi_filename, image->sbi_dest);
+	ret = fatfs_load_batch(files, ARRAY_SIZE(files));
 	if (ret)
 		return ret;
 
-	printk_info("FATFS: read %s addr=%x\n", image->uboot_filename, (unsigned int) image->uboot_dest);
-	ret = fatfs_loadimage(image->uboot_filename, image->uboot_dest);
+	/* stream RISC-V ELF segments straight to their load address */
+	printk_info("FATFS: load ELF %s\n", image->filename);
+	ret = fatfs_load_elf(image->filename, NULL, &image->entry);
 	if (ret)
 		return ret;
 
@@ -160,7 +120,6 @@ int main(void) {
 	memset(&image, 0, sizeof(image_info_t));// Clear the image structure
 
 	// Set destination addresses for different images
-	image.dest = (uint8_t *) CONFIG_RISCV_ELF_LOADADDR;
 	image.sbi_dest = (uint8_t *) CONFIG_RISCV_OPENSBI_LOADADDR;
 	image.uboot_dest = (uint8_t *) CONFIG_RISCV_UBOOT_LOADADDR;
 
@@ -183,23 +142,18 @@ int main(void) {
 		return 0;
 	}
 
-	// Load image from SD card
+	sunxi_c906_clock_reset();// Reset C906 clock
+
+	// Load images from SD card, RISC-V ELF segments are placed while reading
 	if (load_sdcard(&image) != 0) {
 		printk_error("SMHC: loading failed\n");
 		return 0;
 	}
 
-	sunxi_c906_clock_reset();// Reset C906 clock
-
 	// Get entry address of RISC-V ELF
-	uint32_t elf_run_addr = elf64_get_entry_addr((phys_addr_t) image.dest);
+	uint32_t elf_run_addr = image.entry;
 	printk_info("RISC-V ELF run addr: 0x%08x\n", elf_run_addr);
 
-	// Load RISC-V ELF image
-	if (load_elf64_image((phys_addr_t) image.dest)) {
-		printk_error("RISC-V ELF load FAIL\n");
-	}
-
 	printk_info("RISC-V C906 Core now Running... \n");
 
 	mdelay(100);// Delay for 100 milliseconds
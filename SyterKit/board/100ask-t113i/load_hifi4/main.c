@@ -25,10 +25,10 @@
 #include <cli_termesc.h>
 
 #include <elf_loader.h>
+#include <fatfs_loader.h>
 #include <ff.h>
 
 #define CONFIG_HIFI4_ELF_FILENAME "dsp.elf"
-#define CONFIG_HIFI4_ELF_LOADADDR (0x45000000)
 
 #define CONFIG_SDMMC_SPEED_TEST_SIZE 1024// (unit: 512B sectors)
 
@@ -40,56 +40,22 @@ extern dram_para_t dram_para;
 
 #define FILENAME_MAX_LEN 32
 typedef struct {
-	uint8_t *dest;
+	phys_addr_t entry;
 	char filename[FILENAME_MAX_LEN];
 } image_info_t;
 
 image_info_t image;
 
-#define CHUNK_SIZE 0x20000
-
-static int fatfs_loadimage(char *filename, BYTE *dest) {
-	FIL file;
-	UINT byte_to_read = CHUNK_SIZE;
-	UINT byte_read;
-	UINT total_read = 0;
-	FRESULT fret;
-	int ret;
-	uint32_t start, time;
-
-	fret = f_open(&file, filename, FA_OPEN_EXISTING | FA_READ);
-	if (fret != FR_OK) {
-		printk_error("FATFS: open, filename: [%s]: error %d\n", filename, fret);
-		ret = -1;
-		goto open_fail;
-	}
-
-	start = time_ms();
-
-	do {
-		byte_read = 0;
-		fret = f_read(&file, (void *) (dest), byte_to_read, &byte_read);
-		dest += byte_to_read;
-		total_read += byte_read;
-	} while (byte_read >= byte_to_read && fret == FR_OK);
-
-	time = time_ms() - start + 1;
-
-	if (fret != FR_OK) {
-		printk_error("FATFS: read: error %d\n", fret);
-		ret = -1;
-		goto read_fail;
-	}
-	ret = 0;
-
-read_fail:
-	fret = f_close(&file);
-
-	printk_debug("FATFS: read in %ums at %.2fMB/S\n", time, (f32) (total_read / time) / 1024.0f);
+/* HIFI4 need to remap addresses for some addr. */
+static vaddr_range_t hifi4_addr_mapping_range[] = {
+		{0x10000000, 0x1fffffff, 0x30000000},
+		{0x30000000, 0x3fffffff, 0x10000000},
+};
 
-open_fail:
-	return ret;
-}
+static vaddr_map_t hifi4_addr_mapping = {
+		.range = hifi4_addr_mapping_range,
+		.range_size = sizeof(hifi4_addr_mapping_range) / sizeof(vaddr_range_t),
+};
 
 static int load_sdcard(image_info_t *image) {
 	FATFS fs;
@@ -113,8 +79,18 @@ static int load_sdcard(image_info_t *image) {
 		printk_debug("FATFS: mount OK\n");
 	}
 
-	printk_info("FATFS: read %s addr=%x\n", image->filename, (unsigned int) image->dest);
-	ret = fatfs_loadimage(image->filename, image->dest);
+	/* HIFI4 clock must be set up before its local RAM can be written */
+	ret = fatfs_elf_get_entry(image->filename, &image->entry);
+	if (ret)
+		return ret;
+
+	printk_info("HIFI4 ELF run addr: 0x%08x\n", image->entry);
+
+	sunxi_hifi4_clock_init(image->entry);// Initialize clock with entry address
+
+	/* stream HIFI4 ELF segments straight to their load address */
+	printk_info("FATFS: load ELF %s\n", image->filename);
+	ret = fatfs_load_elf(image->filename, &hifi4_addr_mapping, NULL);
 	if (ret)
 		return ret;
 
@@ -158,9 +134,6 @@ int main(void) {
 
 	memset(&image, 0, sizeof(image_info_t));// Clear the image structure
 
-	// Set destination addresses for different images
-	image.dest = (uint8_t *) CONFIG_HIFI4_ELF_LOADADDR;
-
 	// Set filenames for different images
 	strcpy(image.filename, CONFIG_HIFI4_ELF_FILENAME);
 
@@ -178,36 +151,14 @@ int main(void) {
 		return 0;
 	}
 
-	// Load image from SD card
+	sunxi_hifi4_clock_reset();
+
+	// Load HIFI4 ELF image from SD card, segments are placed while reading
 	if (load_sdcard(&image) != 0) {
 		printk_error("SMHC: loading failed\n");
 		return 0;
 	}
 
-	sunxi_hifi4_clock_reset();
-
-	/* HIFI4 need to remap addresses for some addr. */
-	vaddr_range_t hifi4_addr_mapping_range[] = {
-			{0x10000000, 0x1fffffff, 0x30000000},
-			{0x30000000, 0x3fffffff, 0x10000000},
-	};
-
-	vaddr_map_t hifi4_addr_mapping = {
-			.range = hifi4_addr_mapping_range,
-			.range_size = sizeof(hifi4_addr_mapping_range) / sizeof(vaddr_range_t),
-	};
-
-	// Get entry address of HIFI4 ELF
-	uint32_t elf_run_addr = elf32_get_entry_addr((phys_addr_t) image.dest);
-	printk_info("HIFI4 ELF run addr: 0x%08x\n", elf_run_addr);
-
-	sunxi_hifi4_clock_init(elf_run_addr);// Initialize clock with entry address
-
-	// Load HIFI4 ELF image
-	if (load_elf32_image_remap((phys_addr_t) image.dest, &hifi4_addr_mapping)) {
-		printk_error("HIFI4 ELF load FAIL\n");
-	}
-
 	dump_c906_clock();
 
 	printk_info("HIFI4 Core now Running... \n");
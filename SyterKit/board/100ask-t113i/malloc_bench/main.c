@@ -0,0 +1,199 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <types.h>
+
+#include <log.h>
+#include <mmu.h>
+#include <smalloc.h>
+#include <string.h>
+#include <timer.h>
+
+#include <common.h>
+
+#include <sys-dram.h>
+
+#define CONFIG_HEAP_BASE (SDRAM_BASE + 0x01000000)
+#define CONFIG_HEAP_SIZE (16 * 1024 * 1024)
+
+#define BENCH_SLOTS 256
+#define BENCH_LOOPS 100000
+#define STRESS_LOOPS 200000
+
+extern sunxi_serial_t uart_dbg;
+
+extern dram_para_t dram_para;
+
+static uint8_t *slot_ptr[BENCH_SLOTS];
+static uint32_t slot_len[BENCH_SLOTS];
+
+static uint32_t rand_seed = 1;
+
+static uint32_t bench_rand(void) {
+	rand_seed = rand_seed * 1103515245 + 12345;
+	return rand_seed >> 8;
+}
+
+/* Mostly small requests, some medium ones and a few large buffers */
+static uint32_t bench_size(void) {
+	uint32_t r = bench_rand() % 100;
+
+	if (r < 70)
+		return 1 + bench_rand() % 256;
+	if (r < 95)
+		return 1 + bench_rand() % 8192;
+	return 1 + bench_rand() % 262144;
+}
+
+static void slot_fill(uint32_t i) {
+	for (uint32_t k = 0; k < slot_len[i]; k++)
+		slot_ptr[i][k] = (uint8_t) (i * 31 + k);
+}
+
+static bool slot_check(uint32_t i, uint32_t len) {
+	for (uint32_t k = 0; k < len; k++)
+		if (slot_ptr[i][k] != (uint8_t) (i * 31 + k))
+			return false;
+	return true;
+}
+
+static void slots_release(void) {
+	for (uint32_t i = 0; i < BENCH_SLOTS; i++) {
+		sfree(slot_ptr[i]);
+		slot_ptr[i] = NULL;
+	}
+}
+
+static void bench_alloc_free(uint32_t min, uint32_t max) {
+	uint64_t start, time;
+	uint32_t ops = 0, worst = 0;
+
+	rand_seed = 1;
+	start = time_us();
+	for (uint32_t n = 0; n < BENCH_LOOPS; n++) {
+		uint32_t i = bench_rand() % BENCH_SLOTS;
+		uint64_t t = time_us();
+
+		if (slot_ptr[i]) {
+			sfree(slot_ptr[i]);
+			slot_ptr[i] = NULL;
+		} else {
+			slot_ptr[i] = smalloc(min + bench_rand() % (max - min + 1));
+		}
+
+		t = time_us() - t;
+		if (t > worst)
+			worst = t;
+		ops++;
+	}
+	time = time_us() - start;
+
+	slots_release();
+
+	printk_info("alloc/free %6u..%6u: %6u ops in %8u us, worst %u us\n", min, max, ops, (uint32_t) time, worst);
+}
+
+/* Random allocations, frees and resizes with pattern checks, returns the number of errors */
+static int stress(void) {
+	int errors = 0;
+
+	rand_seed = 1;
+	for (uint32_t n = 0; n < STRESS_LOOPS; n++) {
+		uint32_t i = bench_rand() % BENCH_SLOTS;
+		uint32_t op = bench_rand() % 10;
+
+		if (slot_ptr[i]) {
+			if (!slot_check(i, slot_len[i])) {
+				printk_error("stress: slot %u corrupted at loop %u\n", i, n);
+				errors++;
+			}
+
+			if (op < 2) {
+				uint32_t len = bench_size();
+				uint8_t *p = srealloc(slot_ptr[i], len);
+
+				if (p) {
+					slot_ptr[i] = p;
+					if (!slot_check(i, len < slot_len[i] ? len : slot_len[i])) {
+						printk_error("stress: srealloc lost data of slot %u\n", i);
+						errors++;
+					}
+					slot_len[i] = len;
+					slot_fill(i);
+				}
+			} else {
+				sfree(slot_ptr[i]);
+				slot_ptr[i] = NULL;
+			}
+		} else {
+			slot_len[i] = bench_size();
+			if (op < 2) {
+				uint32_t align = 1u << (bench_rand() % 13);
+
+				slot_ptr[i] = smemalign(align, slot_len[i]);
+				if (slot_ptr[i] && ((uint32_t) slot_ptr[i] & (align - 1))) {
+					printk_error("stress: smemalign(%u) returned %p\n", align, slot_ptr[i]);
+					errors++;
+				}
+			} else {
+				slot_ptr[i] = smalloc(slot_len[i]);
+			}
+
+			if (slot_ptr[i])
+				slot_fill(i);
+		}
+
+		if ((n & 1023) == 0 && smalloc_check()) {
+			printk_error("stress: heap corrupted at loop %u\n", n);
+			return errors + 1;
+		}
+	}
+
+	slots_release();
+
+	if (smalloc_check())
+		errors++;
+
+	return errors;
+}
+
+static void show_stats(void) {
+	smalloc_stats_t st;
+
+	smalloc_stats(&st);
+	printk_info("heap: total %u, used %u, peak %u, free %u in %u blocks, largest %u, live %u, failed %u\n", st.total, st.used, st.peak, st.free,
+				st.free_blocks, st.largest_free, st.allocs, st.failures);
+}
+
+int main(void) {
+	int errors;
+
+	sunxi_serial_init(&uart_dbg);
+
+	show_banner();
+
+	sunxi_clk_init();
+
+	uint32_t dram_size = sunxi_dram_init(&dram_para);
+	arm32_mmu_enable(SDRAM_BASE, dram_size);
+
+	smalloc_init(CONFIG_HEAP_BASE, CONFIG_HEAP_SIZE);
+
+	printk_info("Heap benchmark, %u KiB at 0x%08x\n", CONFIG_HEAP_SIZE / 1024, CONFIG_HEAP_BASE);
+
+	bench_alloc_free(16, 64);
+	bench_alloc_free(16, 4096);
+	bench_alloc_free(4096, 65536);
+	show_stats();
+
+	errors = stress();
+	show_stats();
+
+	printk_info("Heap stress %s, %d errors\n", errors ? "FAILED" : "ok", errors);
+
+	printk_info("Heap benchmark done!\n");
+
+	return 0;
+}
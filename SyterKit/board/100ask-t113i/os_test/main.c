@@ -36,6 +36,7 @@ int main(void) {
 
 	while (1) {
 		timer_handle();
+		log_poll();
 		mdelay(1);
 	}
 
@@ -0,0 +1,107 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <types.h>
+
+#include <log.h>
+#include <mmu.h>
+#include <smp.h>
+#include <string.h>
+#include <timer.h>
+
+#include <common.h>
+
+#include <sys-dram.h>
+#include <sys-gic.h>
+
+#define TEST_SRC_ADDR (SDRAM_BASE + 0x01000000)
+#define TEST_DST_ADDR (SDRAM_BASE + 0x02000000)
+#define TEST_SIZE (4 * 1024 * 1024)
+#define TEST_CHUNKS 4
+
+extern sunxi_serial_t uart_dbg;
+
+extern dram_para_t dram_para;
+
+typedef struct {
+	const uint32_t *buf;
+	uint32_t words;
+} sum_job_t;
+
+static sum_job_t jobs[TEST_CHUNKS];
+
+void arm32_do_irq(struct arm_regs_t *regs) {
+	do_irq(regs);
+}
+
+static int sum_words(void *arg) {
+	sum_job_t *job = arg;
+	uint32_t sum = 0;
+
+	for (uint32_t i = 0; i < job->words; i++)
+		sum = (sum << 1 | sum >> 31) ^ job->buf[i];
+
+	return (int) sum;
+}
+
+int main(void) {
+	uint32_t *src = (uint32_t *) TEST_SRC_ADDR;
+	uint32_t chunk = TEST_SIZE / TEST_CHUNKS;
+	uint32_t ref[TEST_CHUNKS];
+	int ticket[TEST_CHUNKS];
+	uint64_t start, serial, parallel;
+	int ok = 1;
+
+	sunxi_serial_init(&uart_dbg);
+
+	show_banner();
+
+	sunxi_clk_init();
+
+	uint32_t dram_size = sunxi_dram_init(&dram_para);
+	arm32_mmu_enable(SDRAM_BASE, dram_size);
+
+	arch_interrupt_init();
+	arm32_interrupt_enable();
+
+	if (smp_init()) {
+		printk_error("SMP: bring-up failed\n");
+		return 0;
+	}
+
+	for (uint32_t i = 0; i < TEST_SIZE / 4; i++)
+		src[i] = i * 0x9e3779b9;
+
+	for (int i = 0; i < TEST_CHUNKS; i++) {
+		jobs[i].buf = (const uint32_t *) (TEST_SRC_ADDR + i * chunk);
+		jobs[i].words = chunk / 4;
+	}
+
+	/* CPU0 alone: checksum every chunk, then fill the destination */
+	start = time_us();
+	for (int i = 0; i < TEST_CHUNKS; i++)
+		ref[i] = sum_words(&jobs[i]);
+	memset((void *) TEST_DST_ADDR, 0x5a, TEST_SIZE);
+	serial = time_us() - start;
+
+	/* CPU1 checksums while CPU0 fills the destination */
+	start = time_us();
+	for (int i = 0; i < TEST_CHUNKS; i++)
+		ticket[i] = smp_run_async(sum_words, &jobs[i]);
+	memset((void *) TEST_DST_ADDR, 0xa5, TEST_SIZE);
+	for (int i = 0; i < TEST_CHUNKS; i++) {
+		if (ticket[i] < 0 || (uint32_t) smp_wait(ticket[i]) != ref[i])
+			ok = 0;
+	}
+	parallel = time_us() - start;
+
+	printk_info("SMP: serial %u us, with CPU1 %u us, %s\n", (uint32_t) serial, (uint32_t) parallel, ok ? "ok" : "MISMATCH");
+
+	smp_exit();
+
+	arm32_interrupt_disable();
+
+	return 0;
+}
@@ -0,0 +1,175 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <types.h>
+
+#include <log.h>
+#include <mmu.h>
+#include <string.h>
+#include <timer.h>
+
+#include <common.h>
+
+#include <sys-dram.h>
+
+#define BENCH_SRC_ADDR (SDRAM_BASE + 0x01000000)
+#define BENCH_DST_ADDR (SDRAM_BASE + 0x02000000)
+#define BENCH_BYTES (4 * 1024 * 1024) /* bytes moved per measurement */
+
+extern sunxi_serial_t uart_dbg;
+
+extern dram_para_t dram_para;
+
+/* Generic ARM routines, always linked next to the selected ones */
+extern void *memcpy_arm(void *dst, const void *src, int cnt);
+extern void *memset_arm(void *dst, int val, int cnt);
+extern int memcmp_arm(const void *dst, const void *src, unsigned int cnt);
+
+static const uint32_t bench_sizes[] = {16, 64, 256, 1024, 4096, 65536, 1024 * 1024};
+
+static const struct {
+	uint32_t src;
+	uint32_t dst;
+} bench_align[] = {{0, 0}, {0, 3}, {1, 0}, {5, 7}};
+
+static uint32_t bench_speed(uint64_t len, uint64_t time) {
+	return time ? (uint32_t) (len / time) : 0; /* bytes per us is MB/s */
+}
+
+static void bench_fill(uint8_t *buf, uint32_t len) {
+	for (uint32_t i = 0; i < len; i++)
+		buf[i] = (uint8_t) (i * 31 + (i >> 8));
+}
+
+static void bench_memcpy(uint32_t len, uint32_t src_off, uint32_t dst_off) {
+	uint8_t *src = (uint8_t *) BENCH_SRC_ADDR + src_off;
+	uint8_t *dst = (uint8_t *) BENCH_DST_ADDR + dst_off;
+	uint32_t loops = BENCH_BYTES / len;
+	uint64_t start, arm_time, sel_time;
+
+	start = time_us();
+	for (uint32_t i = 0; i < loops; i++)
+		memcpy_arm(dst, src, len);
+	arm_time = time_us() - start;
+
+	memset_arm(dst, 0, len);
+
+	start = time_us();
+	for (uint32_t i = 0; i < loops; i++)
+		memcpy(dst, src, len);
+	sel_time = time_us() - start;
+
+	printk_info("memcpy %7u src+%u dst+%u: arm %4u MB/s, selected %4u MB/s, %s\n", len, src_off, dst_off, bench_speed((uint64_t) loops * len, arm_time),
+				bench_speed((uint64_t) loops * len, sel_time), memcmp_arm(dst, src, len) ? "MISMATCH" : "ok");
+}
+
+static void bench_memset(uint32_t len, uint32_t dst_off) {
+	uint8_t *dst = (uint8_t *) BENCH_DST_ADDR + dst_off;
+	uint32_t loops = BENCH_BYTES / len;
+	uint64_t start, arm_time, sel_time;
+	bool ok = true;
+
+	start = time_us();
+	for (uint32_t i = 0; i < loops; i++)
+		memset_arm(dst, 0x5a, len);
+	arm_time = time_us() - start;
+
+	start = time_us();
+	for (uint32_t i = 0; i < loops; i++)
+		memset(dst, 0xa5, len);
+	sel_time = time_us() - start;
+
+	for (uint32_t i = 0; i < len; i++)
+		ok = ok && dst[i] == 0xa5;
+
+	printk_info("memset %7u dst+%u:       arm %4u MB/s, selected %4u MB/s, %s\n", len, dst_off, bench_speed((uint64_t) loops * len, arm_time),
+				bench_speed((uint64_t) loops * len, sel_time), ok ? "ok" : "MISMATCH");
+}
+
+static void bench_memcmp(uint32_t len, uint32_t src_off, uint32_t dst_off) {
+	uint8_t *src = (uint8_t *) BENCH_SRC_ADDR + src_off;
+	uint8_t *dst = (uint8_t *) BENCH_DST_ADDR + dst_off;
+	uint32_t loops = BENCH_BYTES / len;
+	uint64_t start, arm_time, sel_time;
+	int ret = 0;
+
+	/* Equal buffers, both versions have to scan the whole length */
+	memcpy_arm(dst, src, len);
+
+	start = time_us();
+	for (uint32_t i = 0; i < loops; i++)
+		ret |= memcmp_arm(dst, src, len);
+	arm_time = time_us() - start;
+
+	start = time_us();
+	for (uint32_t i = 0; i < loops; i++)
+		ret |= memcmp(dst, src, len);
+	sel_time = time_us() - start;
+
+	/* The last byte differs, the sign has to match the generic version */
+	dst[len - 1] ^= 0x80;
+	if ((memcmp(dst, src, len) < 0) != (memcmp_arm(dst, src, len) < 0) || memcmp(dst, src, len) == 0)
+		ret = 1;
+
+	printk_info("memcmp %7u src+%u dst+%u: arm %4u MB/s, selected %4u MB/s, %s\n", len, src_off, dst_off, bench_speed((uint64_t) loops * len, arm_time),
+				bench_speed((uint64_t) loops * len, sel_time), ret ? "MISMATCH" : "ok");
+}
+
+static void check_overlap(void) {
+	uint8_t *buf = (uint8_t *) BENCH_DST_ADDR;
+	uint8_t *ref = (uint8_t *) BENCH_SRC_ADDR;
+	const uint32_t len = 4096;
+	int ret = 0;
+
+	/* Destination above the source, memcpy has to copy backwards */
+	bench_fill(ref, len + 64);
+	memcpy_arm(buf, ref, len + 64);
+	memcpy(buf + 33, buf, len);
+	ret |= memcmp_arm(buf + 33, ref, len);
+
+	/* Destination below the source */
+	memcpy_arm(buf, ref, len + 64);
+	memcpy(buf, buf + 17, len);
+	ret |= memcmp_arm(buf, ref + 17, len);
+
+	printk_info("memcpy overlap: %s\n", ret ? "MISMATCH" : "ok");
+}
+
+int main(void) {
+	sunxi_serial_init(&uart_dbg);
+
+	show_banner();
+
+	sunxi_clk_init();
+
+	uint32_t dram_size = sunxi_dram_init(&dram_para);
+	arm32_mmu_enable(SDRAM_BASE, dram_size);
+
+#ifdef CONFIG_ARCH_ARM32_NEON
+	printk_info("String benchmark, selected routines use NEON\n");
+#else
+	printk_info("String benchmark, selected routines are the generic ARM ones\n");
+#endif
+
+	bench_fill((uint8_t *) BENCH_SRC_ADDR, 1024 * 1024 + 64);
+
+	for (uint32_t s = 0; s < ARRAY_SIZE(bench_sizes); s++)
+		for (uint32_t a = 0; a < ARRAY_SIZE(bench_align); a++)
+			bench_memcpy(bench_sizes[s], bench_align[a].src, bench_align[a].dst);
+
+	for (uint32_t s = 0; s < ARRAY_SIZE(bench_sizes); s++)
+		for (uint32_t a = 0; a < ARRAY_SIZE(bench_align); a++)
+			bench_memset(bench_sizes[s], bench_align[a].dst);
+
+	for (uint32_t s = 0; s < ARRAY_SIZE(bench_sizes); s++)
+		for (uint32_t a = 0; a < ARRAY_SIZE(bench_align); a++)
+			bench_memcmp(bench_sizes[s], bench_align[a].src, bench_align[a].dst);
+
+	check_overlap();
+
+	printk_info("String benchmark done!\n");
+
+	return 0;
+}
@@ -144,6 +144,7 @@ int main(void)
 
 hang:
     printk_error("Loader hang.\n");
+    log_flush();
     while (1) {
     }
 
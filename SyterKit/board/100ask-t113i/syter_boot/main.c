@@ -9,6 +9,7 @@
 #include <log.h>
 #include <timer.h>
 
+#include <bootstage.h>
 #include <common.h>
 #include <jmp.h>
 #include <mmu.h>
@@ -20,15 +21,23 @@
 #include <cli_shell.h>
 #include <cli_termesc.h>
 
+#include <fit.h>
 #include <image_loader.h>
+#include <part.h>
+#include <smp.h>
 
 #include "sys-dram.h"
+#include "sys-gic.h"
+#include "sys-rproc.h"
 #include "sys-rtc.h"
 #include "sys-sdcard.h"
 #include "sys-sid.h"
 #include "sys-spi.h"
 
+#include "elf.h"
+#include "elf_loader.h"
 #include "fdt_wrapper.h"
+#include "fatfs_loader.h"
 #include "ff.h"
 #include "libfdt.h"
 #include "uart.h"
@@ -37,19 +46,46 @@
 #define CONFIG_DTB_FILENAME "sunxi.dtb"
 #define CONFIG_CONFIG_FILENAME "config.txt"
 
+/* One FIT image carrying kernel, DTB and remote core firmware replaces the separate files */
+#define CONFIG_FIT_FILENAME "boot.itb"
+
+/*
+ * Load kernel and DTB from raw partitions when present, FAT is the fallback.
+ * GPT partitions are found by label, then by type GUID. MBR has no labels,
+ * the partitions are found by type byte.
+ */
+#define CONFIG_RAW_PARTITION_BOOT 1
+#define CONFIG_KERNEL_PARTNAME "kernel"
+#define CONFIG_DTB_PARTNAME "dtb"
+#define CONFIG_CONFIG_PARTNAME "config"
+#define CONFIG_KERNEL_PART_GUID PART_GUID(0x3e32df19, 0x5b79, 0x4d6f, 0xbd, 0xda, 0x8e, 0x69, 0x75, 0x0a, 0x07, 0xd9)
+#define CONFIG_DTB_PART_GUID PART_GUID(0x00518b61, 0xb46a, 0x4a88, 0xa8, 0x1c, 0xf7, 0xaf, 0xf1, 0xd1, 0xfe, 0x6c)
+#define CONFIG_CONFIG_PART_GUID PART_GUID(0x3a683704, 0x128d, 0x4507, 0xb0, 0xab, 0x91, 0x9c, 0xac, 0xcb, 0x52, 0x96)
+#define CONFIG_KERNEL_MBR_TYPE 0x5d
+#define CONFIG_DTB_MBR_TYPE 0x5e
+#define CONFIG_CONFIG_MBR_TYPE 0x5f
+
+/* config.txt is parsed as a string, only this much of the partition is read */
+#define CONFIG_CONFIG_MAX_SIZE (64 * 1024)
+
 #define CONFIG_SDMMC_SPEED_TEST_SIZE 1024// (unit: 512B sectors)
 
 #define CONFIG_DTB_LOAD_ADDR (0x41008000)
 #define CONFIG_KERNEL_LOAD_ADDR (0x41800000)
 #define CONFIG_CONFIG_LOAD_ADDR (0x40008000)
+#define CONFIG_FIT_LOAD_ADDR (0x42000000)
 #define CONFIG_HEAP_BASE (0x40800000)
 #define CONFIG_HEAP_SIZE (16 * 1024 * 1024)
 
+/* Boot log handed to Linux pstore, right below the MMU page table in the last MiB of DRAM */
+#define CONFIG_RAMOOPS_SIZE (64 * 1024)
+
 #define CONFIG_DEFAULT_BOOTDELAY 5
 
 #define FILENAME_MAX_LEN 64
 typedef struct {
 	uint8_t *dest;
+	uint32_t entry; /* Kernel entry point given by a FIT image, 0 to probe the zImage */
 
 	uint8_t *of_dest;
 
@@ -86,53 +122,171 @@ extern dram_para_t dram_para;
 
 image_info_t image;
 
-#define CHUNK_SIZE 0x20000
+static fit_image_t fit;
 
-static int fatfs_loadimage(char *filename, BYTE *dest) {
-	FIL file;
-	UINT byte_to_read = CHUNK_SIZE;
-	UINT byte_read;
-	UINT total_read = 0;
-	FRESULT fret;
-	int ret = 1;
-	uint32_t start, time;
+/* HIFI4 need to remap addresses for some addr. */
+static vaddr_range_t hifi4_addr_mapping_range[] = {
+		{0x10000000, 0x1fffffff, 0x30000000},
+		{0x30000000, 0x3fffffff, 0x10000000},
+};
 
-	fret = f_open(&file, filename, FA_OPEN_EXISTING | FA_READ);
-	if (fret != FR_OK) {
-		printk_error("FATFS: open, filename: [%s]: error %d\n", filename, fret);
-		ret = -1;
-		goto open_fail;
+static vaddr_map_t hifi4_addr_mapping = {
+		.range = hifi4_addr_mapping_range,
+		.range_size = sizeof(hifi4_addr_mapping_range) / sizeof(vaddr_range_t),
+};
+
+#ifdef CONFIG_CHIP_GIC
+void arm32_do_irq(struct arm_regs_t *regs) {
+	do_irq(regs);
+}
+#endif
+
+static int fit_is_elf(fit_component_t *c, uint8_t class) {
+	if (c->comp != FIT_COMP_NONE || c->size < EI_NIDENT)
+		return 0;
+	return c->data[EI_MAG0] == ELFMAG0 && c->data[EI_MAG1] == ELFMAG1 && c->data[EI_MAG2] == ELFMAG2 && c->data[EI_MAG3] == ELFMAG3 &&
+		   c->data[EI_CLASS] == class;
+}
+
+static uint32_t fit_entry(fit_component_t *c) {
+	return c->has_entry ? c->entry : (uint32_t) c->dest;
+}
+
+/**
+ * Load a firmware component of the FIT image and start the core it is built for.
+ *
+ * "riscv" firmware runs on the C906, "xtensa" firmware on the HiFi4. ELF
+ * firmware is loaded by its program headers, raw firmware is placed at
+ * its load address.
+ */
+static int fit_start_firmware(fit_component_t *c) {
+	uint32_t entry;
+
+	if (c->arch && strcmp(c->arch, "riscv") == 0) {
+		sunxi_c906_clock_reset();
+		if (fit_is_elf(c, ELFCLASS64)) {
+			entry = elf64_get_entry_addr((phys_addr_t) c->data);
+			if (load_elf64_image((phys_addr_t) c->data))
+				return -1;
+		} else {
+			if (fit_place(&fit, c))
+				return -1;
+			entry = fit_entry(c);
+		}
+		flush_dcache_all();
+		printk_info("FIT: start C906 '%s' at 0x%08x\n", c->name, entry);
+		sunxi_c906_clock_init(entry);
+	} else if (c->arch && strcmp(c->arch, "xtensa") == 0) {
+		entry = fit_is_elf(c, ELFCLASS32) ? elf32_get_entry_addr((phys_addr_t) c->data) : (c->has_entry ? c->entry : c->load);
+		/* HiFi4 local RAM is only writable once the DSP is clocked */
+		sunxi_hifi4_clock_init(entry);
+		if (fit_is_elf(c, ELFCLASS32)) {
+			if (load_elf32_image_remap((phys_addr_t) c->data, &hifi4_addr_mapping))
+				return -1;
+		} else if (fit_place(&fit, c)) {
+			return -1;
+		}
+		flush_dcache_all();
+		printk_info("FIT: start HiFi4 '%s' at 0x%08x\n", c->name, entry);
+		sunxi_hifi4_start();
+	} else {
+		printk_warning("FIT: skip '%s', no core for arch %s\n", c->name, c->arch ? c->arch : "none");
 	}
 
-	start = time_ms();
+	return 0;
+}
+
+/**
+ * Point the kernel at an initramfs through the /chosen node of the DTB.
+ */
+static int fdt_set_initrd(uint8_t *fdt, uint32_t start, uint32_t size) {
+	int chosen, ret;
+
+	fdt_increase_size(fdt, 512);
+	chosen = fdt_find_or_add_subnode(fdt, 0, "chosen");
+	ret = chosen < 0 ? chosen : fdt_setprop_u32(fdt, chosen, "linux,initrd-start", start);
+	if (ret == 0)
+		ret = fdt_setprop_u32(fdt, chosen, "linux,initrd-end", start + size);
+	if (ret) {
+		printk_error("FIT: can't set initrd: %s\n", fdt_strerror(ret));
+		return -1;
+	}
 
-	do {
-		byte_read = 0;
-		fret = f_read(&file, (void *) (dest), byte_to_read, &byte_read);
-		dest += byte_to_read;
-		total_read += byte_read;
-	} while (byte_read >= byte_to_read && fret == FR_OK);
+	return 0;
+}
 
-	time = time_ms() - start + 1;
+/**
+ * Load the FIT image, verify every component and place kernel, DTB,
+ * ramdisk and remote core firmware.
+ */
+static int load_fit(image_info_t *image) {
+	uint8_t *blob = (uint8_t *) CONFIG_FIT_LOAD_ADDR;
+	fit_component_t *kernel, *fdt, *ramdisk;
+	uint32_t size;
+	int ret;
 
-	if (fret != FR_OK) {
-		printk_error("FATFS: read: error %d\n", fret);
-		ret = -1;
-		goto read_fail;
+	printk_info("FATFS: read %s addr=%x\n", CONFIG_FIT_FILENAME, (uint32_t) blob);
+	ret = fatfs_load_file(CONFIG_FIT_FILENAME, blob, &size);
+	if (ret)
+		return ret;
+	bootstage_mark("load " CONFIG_FIT_FILENAME);
+
+	if (fit_check_header(blob) || fit_total_size(blob) > size) {
+		printk_error("FIT: %s is not a valid FIT image\n", CONFIG_FIT_FILENAME);
+		return -1;
+	}
+
+	if (fit_parse(blob, size, NULL, &fit))
+		return -1;
+
+	if (fit_verify(&fit)) {
+		printk_error("FIT: hash check failed, refusing to boot\n");
+		return -1;
+	}
+	printk_info("FIT: %d images verified\n", fit.count);
+	bootstage_mark("fit verify");
+
+	kernel = fit_find(&fit, "kernel", 0);
+	fdt = fit_find(&fit, "flat_dt", 0);
+	ramdisk = fit_find(&fit, "ramdisk", 0);
+	if (kernel == NULL || fdt == NULL) {
+		printk_error("FIT: configuration needs a kernel and a fdt\n");
+		return -1;
 	}
-	ret = 0;
 
-read_fail:
-	fret = f_close(&file);
+	/* fit_place() keeps the blob intact, every component can still be read from it */
+	if (fit_place(&fit, kernel))
+		return -1;
+	image->dest = kernel->dest;
+	image->entry = fit_entry(kernel);
 
-	printk_info("FATFS: read in %ums at %.2fMB/S\n", time, (f32) (total_read / time) / 1024.0f);
+	/* The DTB grows when bootargs are updated, keep it out of the blob */
+	memcpy(image->of_dest, fdt->data, fdt->size);
 
-open_fail:
-	return ret;
+	if (ramdisk) {
+		if (fit_place(&fit, ramdisk) || fdt_set_initrd(image->of_dest, (uint32_t) ramdisk->dest, ramdisk->dest_size))
+			return -1;
+		printk_info("FIT: ramdisk at 0x%08x size %u\n", (uint32_t) ramdisk->dest, ramdisk->dest_size);
+	}
+	bootstage_mark("fit place");
+
+	for (int i = 0; i < fit.count; i++) {
+		fit_component_t *c = &fit.comp[i];
+		if (c == kernel || c == fdt || c == ramdisk)
+			continue;
+		if (fit_start_firmware(c)) {
+			printk_error("FIT: loading '%s' failed\n", c->name);
+			return -1;
+		}
+	}
+	bootstage_mark("fit firmware");
+
+	return 0;
 }
 
 static int load_sdcard(image_info_t *image) {
 	FATFS fs;
+	FIL file;
 	FRESULT fret;
 	int ret;
 	uint32_t start;
@@ -143,8 +297,6 @@ static int load_sdcard(image_info_t *image) {
 	test_time = time_ms() - start;
 	printk_debug("SDMMC: speedtest %uKB in %ums at %uKB/S\n", (CONFIG_SDMMC_SPEED_TEST_SIZE * 512) / 1024, test_time, (CONFIG_SDMMC_SPEED_TEST_SIZE * 512) / test_time);
 
-	start = time_ms();
-
 	fret = f_mount(&fs, "", 1);
 	if (fret != FR_OK) {
 		printk_error("FATFS: mount error: %d\n", fret);
@@ -152,23 +304,42 @@ static int load_sdcard(image_info_t *image) {
 	} else {
 		printk_debug("FATFS: mount OK\n");
 	}
+	bootstage_mark("mount");
+
+	/* A FIT image loaded earlier may have moved the kernel */
+	image->dest = (uint8_t *) CONFIG_KERNEL_LOAD_ADDR;
+	image->entry = 0;
+
+	fatfs_load_entry_t files[3];
+	uint32_t n_files = 0, config_idx;
+
+	/* A FIT image replaces the DTB and kernel files */
+	fret = f_open(&file, CONFIG_FIT_FILENAME, FA_OPEN_EXISTING | FA_READ);
+	if (fret == FR_OK) {
+		f_close(&file);
+		ret = load_fit(image);
+		if (ret)
+			return ret;
+	} else {
+		files[n_files++] = (fatfs_load_entry_t){.filename = image->of_filename, .dest = image->of_dest};
+		files[n_files++] = (fatfs_load_entry_t){.filename = image->filename, .dest = image->dest};
+		printk_info("FATFS: read %s addr=%x\n", image->of_filename, (uint32_t) image->of_dest);
+		printk_info("FATFS: read %s addr=%x\n", image->filename, (uint32_t) image->dest);
+	}
 
-	/* load DTB */
-	printk_info("FATFS: read %s addr=%x\n", image->of_filename, (uint32_t) image->of_dest);
-	ret = fatfs_loadimage(image->of_filename, image->of_dest);
-	if (ret)
-		return ret;
+	/* load DTB, Kernel and config in one LBA ordered pass */
+	config_idx = n_files;
+	files[n_files++] = (fatfs_load_entry_t){.filename = image->config_filename, .dest = image->config_dest, .optional = true};
+	printk_info("FATFS: read %s addr=%x\n", image->config_filename, (uint32_t) image->config_dest);
 
-	/* load Kernel */
-	printk_info("FATFS: read %s addr=%x\n", image->filename, (uint32_t) image->dest);
-	ret = fatfs_loadimage(image->filename, image->dest);
+	ret = fatfs_load_batch(files, n_files);
 	if (ret)
 		return ret;
+	/* The batch interleaves the files in LBA order, one mark covers them all */
+	bootstage_mark(n_files > 1 ? "load dtb+kernel+config" : "load config");
 
 	/* load config */
-	printk_info("FATFS: read %s addr=%x\n", image->config_filename, (uint32_t) image->config_dest);
-	ret = fatfs_loadimage(image->config_filename, image->config_dest);
-	if (ret) {
+	if (files[config_idx].ret) {
 		printk_info("CONFIG: Cannot find config file, Using default config.\n");
 		image->is_config = 0;
 	} else {
@@ -183,10 +354,104 @@ static int load_sdcard(image_info_t *image) {
 	} else {
 		printk_debug("FATFS: unmount OK\n");
 	}
-	printk_info("FATFS: done in %ums\n", time_ms() - start);
+	bootstage_mark("umount");
+
+	return 0;
+}
+
+#if CONFIG_RAW_PARTITION_BOOT
+static part_table_t part_table;
+
+static uint32_t sdcard_blk_read(void *ctx, uint8_t *buf, uint64_t lba, uint32_t count) {
+	return sdmmc_blk_read((sdmmc_pdata_t *) ctx, buf, lba, count);
+}
+
+static part_entry_t *find_raw_partition(const char *name, const uint8_t *guid, uint8_t mbr_type) {
+	part_entry_t *part;
+
+	if (!part_table.is_gpt)
+		return part_find_by_mbr_type(&part_table, mbr_type);
+
+	part = part_find_by_name(&part_table, name);
+	return part ? part : part_find_by_type(&part_table, guid);
+}
+
+static int load_raw_partitions(image_info_t *image) {
+	static const uint8_t kernel_guid[16] = CONFIG_KERNEL_PART_GUID;
+	static const uint8_t dtb_guid[16] = CONFIG_DTB_PART_GUID;
+	static const uint8_t config_guid[16] = CONFIG_CONFIG_PART_GUID;
+	part_entry_t *kernel, *dtb, *config;
+	uint32_t kernel_size, dtb_size, config_size;
+
+	if (part_scan(&part_table, sdcard_blk_read, &card0) <= 0)
+		return -1;
+	bootstage_mark("gpt scan");
+
+	image->dest = (uint8_t *) CONFIG_KERNEL_LOAD_ADDR;
+	image->entry = 0;
+
+	kernel = find_raw_partition(CONFIG_KERNEL_PARTNAME, kernel_guid, CONFIG_KERNEL_MBR_TYPE);
+	dtb = find_raw_partition(CONFIG_DTB_PARTNAME, dtb_guid, CONFIG_DTB_MBR_TYPE);
+	if (kernel == NULL || dtb == NULL) {
+		printk_debug("PART: no '%s' or '%s' partition\n", CONFIG_KERNEL_PARTNAME, CONFIG_DTB_PARTNAME);
+		return -1;
+	}
+
+	/* Peek at the headers so only the image itself is transferred, not the whole partition */
+	if (part_load(&part_table, dtb, image->of_dest, PART_SECTOR_SIZE) == 0)
+		return -1;
+	if (fdt_check_header(image->of_dest)) {
+		printk_error("GPT: '%s' does not hold a valid DTB\n", CONFIG_DTB_PARTNAME);
+		return -1;
+	}
+	dtb_size = fdt_totalsize(image->of_dest);
+
+	if (part_load(&part_table, kernel, image->dest, PART_SECTOR_SIZE) == 0)
+		return -1;
+	linux_zimage_header_t *zimage_header = (linux_zimage_header_t *) image->dest;
+	if (zimage_header->magic != LINUX_ZIMAGE_MAGIC || zimage_header->end <= zimage_header->start) {
+		printk_error("GPT: '%s' does not hold a zImage\n", CONFIG_KERNEL_PARTNAME);
+		return -1;
+	}
+	kernel_size = zimage_header->end - zimage_header->start;
+
+	/* One contiguous transfer per image */
+	dtb_size = part_load(&part_table, dtb, image->of_dest, dtb_size);
+	bootstage_mark("load dtb");
+	kernel_size = part_load(&part_table, kernel, image->dest, kernel_size);
+	bootstage_mark("load kernel");
+	if (dtb_size == 0 || kernel_size == 0) {
+		printk_error("GPT: raw partition read failed\n");
+		return -1;
+	}
+
+	config = find_raw_partition(CONFIG_CONFIG_PARTNAME, config_guid, CONFIG_CONFIG_MBR_TYPE);
+	image->is_config = 0;
+	if (config != NULL) {
+		config_size = config->num_lba < CONFIG_CONFIG_MAX_SIZE / PART_SECTOR_SIZE ? (uint32_t) config->num_lba * PART_SECTOR_SIZE : CONFIG_CONFIG_MAX_SIZE;
+		config_size = part_load(&part_table, config, image->config_dest, config_size);
+		if (config_size != 0) {
+			/* The config is handled with string functions, the partition holds no terminator */
+			image->config_dest[config_size] = '\0';
+			image->is_config = 1;
+		}
+	}
+	bootstage_mark("load config");
+
+	printk_info("GPT: read dtb %u bytes, kernel %u bytes\n", dtb_size, kernel_size);
 
 	return 0;
 }
+#endif
+
+static int load_images(image_info_t *image) {
+#if CONFIG_RAW_PARTITION_BOOT
+	if (load_raw_partitions(image) == 0)
+		return 0;
+	printk_info("GPT: no raw boot partitions, fallback to FATFS\n");
+#endif
+	return load_sdcard(image);
+}
 
 static void trim(char *str) {
 	int len = strlen(str);
@@ -469,14 +734,31 @@ _err_size:
 }
 
 msh_declare_command(reload);
-msh_define_help(reload, "rescan TF Card and reload DTB, Kernel zImage", "Usage: reload\n");
+msh_define_help(reload, "rescan TF Card and reload DTB, Kernel zImage",
+				"Usage: reload       - reload from raw partitions, fallback to FATFS\n"
+				"       reload fat   - reload from FATFS only\n"
+				"       reload raw   - reload from raw GPT or MBR partitions only\n");
 int cmd_reload(int argc, const char **argv) {
+	int ret;
+
 	if (sdmmc_init(&card0, &sdhci0) != 0) {
 		printk_error("SMHC: init failed\n");
 		return 0;
 	}
 
-	if (load_sdcard(&image) != 0) {
+	if (argc == 2 && strcmp(argv[1], "fat") == 0) {
+		ret = load_sdcard(&image);
+#if CONFIG_RAW_PARTITION_BOOT
+	} else if (argc == 2 && strcmp(argv[1], "raw") == 0) {
+		ret = load_raw_partitions(&image);
+		if (ret == 0)
+			part_dump(&part_table);
+#endif
+	} else {
+		ret = load_images(&image);
+	}
+
+	if (ret != 0) {
 		printk_error("SMHC: loading failed\n");
 		return 0;
 	}
@@ -506,12 +788,30 @@ int cmd_boot(int argc, const char **argv) {
 	uint32_t entry_point = 0;
 	void (*kernel_entry)(int zero, int arch, uint32_t params);
 
-	/* Set up boot parameters for the kernel. */
-	if (zImage_loader((uint8_t *) image.dest, &entry_point)) {
+	/* A FIT kernel is already decompressed and placed, enter it where the image says */
+	if (image.entry) {
+		entry_point = image.entry;
+	} else if (zImage_loader((uint8_t *) image.dest, &entry_point)) {
 		printk_error("boot setup failed\n");
 		abort();
 	}
 
+	/* Hand the timings to the kernel, the jump is the last stage */
+	bootstage_mark("jump");
+	bootstage_fdt_export(image.of_dest);
+
+#ifdef CONFIG_CHIP_SMP
+	/* Park CPU1 again, the kernel brings it up itself */
+	smp_exit();
+#endif
+#if defined(CONFIG_LOG_ASYNC) && defined(CONFIG_CHIP_GIC)
+	/* Linux owns the GIC from here, drain the log by polling */
+	log_irq_exit();
+#endif
+
+	/* Last step with the cache on, the zone is written back for Linux */
+	log_ramoops_fdt_export(image.of_dest);
+
 	/* Disable MMU, data cache, instruction cache, interrupts */
 	clean_syterkit_data();
 
@@ -522,6 +822,7 @@ int cmd_boot(int argc, const char **argv) {
 	printk_info("jump to kernel address: 0x%x\n\n", image.dest);
 
 	/* Jump to the kernel entry point. */
+	log_flush();
 	kernel_entry = (void (*)(int, int, uint32_t)) entry_point;
 	kernel_entry(0, ~0, (uint32_t) image.of_dest);
 
@@ -551,6 +852,7 @@ int main(void) {
 
 	/* Initialize the system clock. */
 	sunxi_clk_init();
+	bootstage_mark("clock init");
 
 	/* Check rtc fel flag. if set flag, goto fel */
 	if (rtc_probe_fel_flag()) {
@@ -564,11 +866,29 @@ int main(void) {
 
 	/* Initialize the DRAM and enable memory management unit (MMU). */
 	uint32_t dram_size = sunxi_dram_init(&dram_para);
+	bootstage_mark("dram init");
+	log_ramoops_init(SDRAM_BASE + ((dram_size - 1) << 20) - CONFIG_RAMOOPS_SIZE, CONFIG_RAMOOPS_SIZE);
 	arm32_mmu_enable(SDRAM_BASE, dram_size);
+	bootstage_mark("mmu");
 
 	/* Debug message to indicate that MMU is enabled. */
 	printk_debug("enable mmu ok\n");
 
+#ifdef CONFIG_CHIP_GIC
+	arch_interrupt_init();
+#ifdef CONFIG_LOG_ASYNC
+	/* The UART drains printk from its TX interrupt */
+	log_irq_init();
+#endif
+	arm32_interrupt_enable();
+#endif
+
+#ifdef CONFIG_CHIP_SMP
+	/* CPU1 shares the FIT hashing with CPU0 */
+	if (smp_init())
+		printk_warning("SMP: CPU1 bring-up failed, hashing on CPU0 only\n");
+#endif
+
 	/* Initialize the small memory allocator. */
 	smalloc_init(CONFIG_HEAP_BASE, CONFIG_HEAP_SIZE);
 
@@ -602,9 +922,10 @@ int main(void) {
 		printk_warning("SMHC: init failed\n");
 		goto _shell;
 	}
+	bootstage_mark("smhc init");
 
 	/* Load the DTB, kernel image, and configuration data from the SD card. */
-	if (load_sdcard(&image) != 0) {
+	if (load_images(&image) != 0) {
 		printk_warning("SMHC: loading failed\n");
 		goto _shell;
 	}
@@ -613,6 +934,7 @@ int main(void) {
 	if (update_bootargs_from_config(dram_size)) {
 		goto _shell;
 	}
+	bootstage_mark("fdt fixup");
 
 	int bootdelay = CONFIG_DEFAULT_BOOTDELAY;
 
@@ -633,6 +955,7 @@ int main(void) {
 	if (abortboot_single_key(bootdelay)) {
 		goto _shell;
 	}
+	bootstage_mark("bootdelay");
 
 	cmd_boot(0, NULL);
 
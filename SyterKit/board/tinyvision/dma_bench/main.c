@@ -0,0 +1,171 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <types.h>
+
+#include <cache.h>
+#include <log.h>
+#include <mmu.h>
+#include <string.h>
+#include <timer.h>
+
+#include <common.h>
+
+#include <sys-dma.h>
+#include <sys-dram.h>
+#include <sys-gic.h>
+
+#define BENCH_SRC_ADDR (SDRAM_BASE + 0x01000000)
+#define BENCH_DST_ADDR (SDRAM_BASE + 0x02000000)
+#define BENCH_CPU_ADDR (SDRAM_BASE + 0x03000000)
+#define BENCH_MAX_SIZE (8 * 1024 * 1024)
+#define BENCH_SCHED_REQS 8
+
+extern sunxi_serial_t uart_dbg;
+
+extern sunxi_dma_t sunxi_dma;
+
+extern dram_para_t dram_para;
+
+static uint32_t bench_speed(uint32_t len, uint64_t time) {
+	return time ? (uint32_t) (len / time) : 0; /* bytes per us is MB/s */
+}
+
+static void bench_copy(uint32_t len) {
+	uint8_t *src = (uint8_t *) BENCH_SRC_ADDR;
+	uint8_t *dst = (uint8_t *) BENCH_DST_ADDR;
+	uint64_t start, cpu_time, dma_time;
+
+	for (uint32_t i = 0; i < len; i += 4)
+		*(uint32_t *) (src + i) = i * 0x9e3779b9;
+
+	start = time_us();
+	memcpy(dst, src, len);
+	cpu_time = time_us() - start;
+
+	memset(dst, 0, len);
+
+	start = time_us();
+	dma_memcpy(dst, src, len);
+	dma_time = time_us() - start;
+
+	printk_info("%8u bytes: cpu %5u us %4u MB/s, dma %5u us %4u MB/s, %s\n", len, (uint32_t) cpu_time, bench_speed(len, cpu_time), (uint32_t) dma_time,
+				bench_speed(len, dma_time), memcmp(dst, src, len) ? "MISMATCH" : "ok");
+}
+
+static void bench_overlap(uint32_t len) {
+	uint8_t *src = (uint8_t *) BENCH_SRC_ADDR;
+	uint8_t *dst = (uint8_t *) BENCH_DST_ADDR;
+	uint8_t *cpu = (uint8_t *) BENCH_CPU_ADDR;
+	uint64_t start, time;
+	uint32_t dma_fd;
+
+	start = time_us();
+	dma_fd = dma_memcpy_async(dst, src, len);
+	memset(cpu, 0x5a, len); /* CPU work while the DMA copies */
+	if (dma_fd)
+		dma_memcpy_wait(dma_fd);
+	time = time_us() - start;
+
+	printk_info("%8u bytes: dma copy + cpu memset in %u us\n", len, (uint32_t) time);
+
+	start = time_us();
+	dma_fd = dma_memset_async(dst, 0xa5, len);
+	if (dma_fd)
+		dma_memcpy_wait(dma_fd);
+	time = time_us() - start;
+
+	printk_info("%8u bytes: dma memset %u us %u MB/s, %s\n", len, (uint32_t) time, bench_speed(len, time), (dst[0] == 0xa5 && dst[len - 1] == 0xa5) ? "ok" : "MISMATCH");
+}
+
+static sunxi_dma_req_t sched_req[BENCH_SCHED_REQS];
+static sunxi_dma_sg_t sched_sg[BENCH_SCHED_REQS];
+static volatile uint32_t sched_done;
+
+void arm32_do_irq(struct arm_regs_t *regs) {
+	do_irq(regs);
+}
+
+static void bench_sched_done(sunxi_dma_req_t *req, void *arg) {
+	sched_done++;
+}
+
+static void bench_sched(uint32_t len) {
+	uint32_t chunk = len / BENCH_SCHED_REQS;
+	uint64_t start, time;
+	uint32_t spins = 0;
+
+	flush_dcache_range(BENCH_SRC_ADDR, BENCH_SRC_ADDR + len);
+	flush_dcache_range(BENCH_DST_ADDR, BENCH_DST_ADDR + len);
+
+	sched_done = 0;
+	start = time_us();
+
+	/* More requests than channels, the rest wait in the scheduler queue */
+	for (uint32_t i = 0; i < BENCH_SCHED_REQS; i++) {
+		sched_sg[i].src = BENCH_SRC_ADDR + i * chunk;
+		sched_sg[i].dst = BENCH_DST_ADDR + i * chunk;
+		sched_sg[i].len = chunk;
+
+		memset(&sched_req[i], 0, sizeof(sunxi_dma_req_t));
+		sched_req[i].cfg.wait_cyc = 8;
+		sched_req[i].cfg.data_block_size = 1 * 32 / 8;
+		sched_req[i].cfg.channel_cfg.src_drq_type = DMAC_CFG_TYPE_DRAM;
+		sched_req[i].cfg.channel_cfg.src_addr_mode = DMAC_CFG_SRC_ADDR_TYPE_LINEAR_MODE;
+		sched_req[i].cfg.channel_cfg.src_burst_length = DMAC_CFG_SRC_8_BURST;
+		sched_req[i].cfg.channel_cfg.src_data_width = DMAC_CFG_SRC_DATA_WIDTH_32BIT;
+		sched_req[i].cfg.channel_cfg.dst_drq_type = DMAC_CFG_TYPE_DRAM;
+		sched_req[i].cfg.channel_cfg.dst_addr_mode = DMAC_CFG_DEST_ADDR_TYPE_LINEAR_MODE;
+		sched_req[i].cfg.channel_cfg.dst_burst_length = DMAC_CFG_DEST_8_BURST;
+		sched_req[i].cfg.channel_cfg.dst_data_width = DMAC_CFG_DEST_DATA_WIDTH_32BIT;
+		sched_req[i].sg = &sched_sg[i];
+		sched_req[i].count = 1;
+		sched_req[i].done = bench_sched_done;
+		sunxi_dma_submit(&sched_req[i]);
+	}
+
+	/* Completions come from the DMA interrupt, the CPU only counts */
+	while (sched_done < BENCH_SCHED_REQS)
+		spins++;
+	time = time_us() - start;
+
+	invalidate_dcache_range(BENCH_DST_ADDR, BENCH_DST_ADDR + len);
+
+	printk_info("%8u bytes: %u scheduled requests in %u us %u MB/s, %u idle loops, %s\n", len, BENCH_SCHED_REQS, (uint32_t) time, bench_speed(len, time), spins,
+				memcmp((void *) BENCH_DST_ADDR, (void *) BENCH_SRC_ADDR, len) ? "MISMATCH" : "ok");
+}
+
+int main(void) {
+	sunxi_serial_init(&uart_dbg);
+
+	show_banner();
+
+	sunxi_clk_init();
+
+	uint32_t dram_size = sunxi_dram_init(&dram_para);
+	arm32_mmu_enable(SDRAM_BASE, dram_size);
+
+	arch_interrupt_init();
+	arm32_interrupt_enable();
+
+	sunxi_dma_init(&sunxi_dma);
+
+	printk_info("DMA memcpy benchmark, caches on\n");
+
+	for (uint32_t len = 4 * 1024; len <= BENCH_MAX_SIZE; len <<= 2)
+		bench_copy(len);
+
+	bench_overlap(BENCH_MAX_SIZE);
+
+	bench_sched(BENCH_MAX_SIZE);
+
+	sunxi_dma_exit(&sunxi_dma);
+
+	arm32_interrupt_disable();
+
+	printk_info("DMA benchmark done!\n");
+
+	return 0;
+}
@@ -13,6 +13,10 @@
 #include <jmp.h>
 
 #include <image_loader.h>
+#include <lz4.h>
+#include <manifest.h>
+#include <sha256.h>
+#include <uimage.h>
 
 #include "sys-dram.h"
 #include "sys-sdcard.h"
@@ -21,20 +25,40 @@
 #include "sys-dma.h"
 #include "sys-spi-nand.h"
 
+#include "fdt_wrapper.h"
 #include "libfdt.h"
 #include "ff.h"
 
 #define CONFIG_KERNEL_FILENAME "zImage"
+#define CONFIG_KERNEL_IMAGE_FILENAME "Image"
 #define CONFIG_DTB_FILENAME "sunxi.dtb"
+#define CONFIG_MANIFEST_FILENAME "manifest.sha256"
 
 #define CONFIG_SDMMC_SPEED_TEST_SIZE 1024// (unit: 512B sectors)
 
 #define CONFIG_DTB_LOAD_ADDR (0x41008000)
 #define CONFIG_KERNEL_LOAD_ADDR (0x41800000)
+/* An uncompressed Image runs in place, it must stay below the DTB including its BSS */
+#define CONFIG_KERNEL_IMAGE_LOAD_ADDR (SDRAM_BASE + LINUX_IMAGE_TEXT_OFFSET)
 
 // 128KB erase sectors, so place them starting from 2nd sector
+// the manifest gets the erase block after the DTB so it can be rewritten alone
 #define CONFIG_SPINAND_DTB_ADDR (128 * 2048)
+#define CONFIG_SPINAND_MANIFEST_ADDR (192 * 2048)
 #define CONFIG_SPINAND_KERNEL_ADDR (256 * 2048)
+#define CONFIG_SPINAND_DTB_MAX_SIZE (CONFIG_SPINAND_MANIFEST_ADDR - CONFIG_SPINAND_DTB_ADDR)
+#define CONFIG_SPINAND_CALIB_MAX_CLK SPI_MAX_FREQUENCY
+
+/*
+ * LZ4 compressed images are read here chunk by chunk and decompressed to their
+ * load address. It sits above the kernel, DTB and a decompressed Image at
+ * CONFIG_KERNEL_IMAGE_LOAD_ADDR so that no decoder output lands on it.
+ */
+#define CONFIG_LZ4_STAGING_ADDR (0x43000000)
+#define CONFIG_LZ4_MAX_SIZE (0x01000000)
+
+/* Expected image digests, boot is refused when a listed image does not match */
+#define CONFIG_MANIFEST_MAX_SIZE 2048
 
 #define FILENAME_MAX_LEN 64
 typedef struct {
@@ -47,6 +71,9 @@ typedef struct {
 
 	char filename[FILENAME_MAX_LEN];
 	char of_filename[FILENAME_MAX_LEN];
+
+	uint8_t digest[SHA256_DIGEST_SIZE];
+	uint8_t of_digest[SHA256_DIGEST_SIZE];
 } image_info_t;
 
 extern sunxi_serial_t uart_dbg;
@@ -59,15 +86,28 @@ extern sdhci_t sdhci0;
 
 image_info_t image;
 
+static manifest_t manifest;
+static bool manifest_loaded;
+
 #define CHUNK_SIZE 0x20000
 
-static int fatfs_loadimage(char *filename, BYTE *dest) {
+/**
+ * Read a file to its load address, decompressing LZ4 files on the way.
+ *
+ * @param max_size Room at dest, a file or decompressed image that does not fit is rejected.
+ * @return 0 on success, -1 otherwise.
+ */
+static int fatfs_loadimage(char *filename, BYTE *dest, uint32_t max_size, uint8_t *digest) {
 	FIL file;
 	UINT byte_to_read = CHUNK_SIZE;
 	UINT byte_read;
 	UINT total_read = 0;
 	FRESULT fret;
-	int ret;
+	BYTE *buf = dest;
+	lz4_stream_t lz4;
+	sha256_ctx_t sha;
+	bool compressed;
+	int ret = 0;
 	uint32_t start, time;
 
 	fret = f_open(&file, filename, FA_OPEN_EXISTING | FA_READ);
@@ -78,13 +118,45 @@ static int fatfs_loadimage(char *filename, BYTE *dest) {
 	}
 
 	start = time_ms();
+	sha256_init(&sha);
+
+	/* Look at the first chunk to tell compressed images apart */
+	byte_read = 0;
+	fret = f_read(&file, (void *) CONFIG_LZ4_STAGING_ADDR, byte_to_read, &byte_read);
+	compressed = fret == FR_OK && byte_read >= 4 && lz4_is_compressed((void *) CONFIG_LZ4_STAGING_ADDR);
+
+	if (compressed) {
+		/* Decompress each chunk to the load address before reading the next one */
+		buf = (BYTE *) CONFIG_LZ4_STAGING_ADDR;
+		lz4_stream_init(&lz4, dest, max_size < CONFIG_LZ4_MAX_SIZE ? max_size : CONFIG_LZ4_MAX_SIZE);
+	} else if (f_size(&file) > max_size) {
+		printk_error("FATFS: %s of size %u does not fit below 0x%08x\n", filename, (uint32_t) f_size(&file), (uint32_t) dest + max_size);
+		f_close(&file);
+		return -1;
+	} else {
+		memcpy(dest, (void *) CONFIG_LZ4_STAGING_ADDR, byte_read);
+	}
 
-	do {
-		byte_read = 0;
-		fret = f_read(&file, (void *) (dest), byte_to_read, &byte_read);
-		dest += byte_to_read;
+	while (fret == FR_OK) {
 		total_read += byte_read;
-	} while (byte_read >= byte_to_read && fret == FR_OK);
+
+		/* Hash the file as stored while the chunk is still in the cache */
+		sha256_update(&sha, compressed ? buf : dest + total_read - byte_read, byte_read);
+
+		if (compressed) {
+			ret = lz4_stream_feed(&lz4, buf, byte_read);
+			if (ret)
+				break;
+		} else {
+			buf += byte_read;
+		}
+
+		if (byte_read < byte_to_read)
+			break;
+
+		byte_read = 0;
+		fret = f_read(&file, (void *) buf, byte_to_read, &byte_read);
+	}
 
 	time = time_ms() - start + 1;
 
@@ -93,6 +165,16 @@ static int fatfs_loadimage(char *filename, BYTE *dest) {
 		ret = -1;
 		goto read_fail;
 	}
+
+	if (compressed) {
+		if (ret < 0 || lz4_stream_end(&lz4)) {
+			printk_error("FATFS: %s: LZ4 decompression failed\n", filename);
+			ret = -1;
+			goto read_fail;
+		}
+		printk_info("FATFS: %s: LZ4 %u -> %u bytes\n", filename, total_read, lz4_stream_size(&lz4));
+	}
+	sha256_final(&sha, digest);
 	ret = 0;
 
 read_fail:
@@ -106,9 +188,10 @@ open_fail:
 
 static int load_sdcard(image_info_t *image) {
 	FATFS fs;
+	FIL file;
 	FRESULT fret;
 	int ret;
-	uint32_t start;
+	uint32_t start, kernel_max_size;
 
 	uint32_t test_time;
 	start = time_ms();
@@ -126,13 +209,41 @@ static int load_sdcard(image_info_t *image) {
 		printk_debug("FATFS: mount OK\n");
 	}
 
+	/* The manifest is optional, without it images are not verified */
+	manifest_loaded = false;
+	fret = f_open(&file, CONFIG_MANIFEST_FILENAME, FA_OPEN_EXISTING | FA_READ);
+	if (fret == FR_OK) {
+		UINT byte_read = 0;
+		fret = f_read(&file, (void *) CONFIG_LZ4_STAGING_ADDR, CONFIG_MANIFEST_MAX_SIZE, &byte_read);
+		f_close(&file);
+		if (fret != FR_OK || manifest_parse(&manifest, (const char *) CONFIG_LZ4_STAGING_ADDR, byte_read) < 0) {
+			printk_error("FATFS: %s is unreadable\n", CONFIG_MANIFEST_FILENAME);
+			return -1;
+		}
+		manifest_loaded = true;
+	}
+
 	printk_info("FATFS: read %s addr=%x\n", image->of_filename, (unsigned int) image->of_dest);
-	ret = fatfs_loadimage(image->of_filename, image->of_dest);
+	ret = fatfs_loadimage(image->of_filename, image->of_dest, CONFIG_KERNEL_LOAD_ADDR - CONFIG_DTB_LOAD_ADDR, image->of_digest);
 	if (ret)
 		return ret;
 
+	/* Prefer an uncompressed Image, booting it skips the kernel decompressor */
+	fret = f_open(&file, CONFIG_KERNEL_IMAGE_FILENAME, FA_OPEN_EXISTING | FA_READ);
+	if (fret == FR_OK) {
+		f_close(&file);
+		strcpy(image->filename, CONFIG_KERNEL_IMAGE_FILENAME);
+		image->dest = (uint8_t *) CONFIG_KERNEL_IMAGE_LOAD_ADDR;
+	}
+
+	/* An Image sits below the DTB and must end before it, a zImage ends before the LZ4 staging buffer */
+	if ((uint32_t) image->dest < CONFIG_DTB_LOAD_ADDR)
+		kernel_max_size = CONFIG_DTB_LOAD_ADDR - (uint32_t) image->dest;
+	else
+		kernel_max_size = CONFIG_LZ4_STAGING_ADDR - (uint32_t) image->dest;
+
 	printk_info("FATFS: read %s addr=%x\n", image->filename, (unsigned int) image->dest);
-	ret = fatfs_loadimage(image->filename, image->dest);
+	ret = fatfs_loadimage(image->filename, image->dest, kernel_max_size, image->digest);
 	if (ret)
 		return ret;
 
@@ -149,6 +260,80 @@ static int load_sdcard(image_info_t *image) {
 	return 0;
 }
 
+typedef struct {
+	uint8_t *dest;
+	sha256_ctx_t sha;
+} spi_nand_hash_ctx_t;
+
+static int spi_nand_hash_feed(void *arg, const uint8_t *buf, uint32_t len) {
+	spi_nand_hash_ctx_t *ctx = (spi_nand_hash_ctx_t *) arg;
+
+	/* Hash the chunk while it is still in the cache */
+	sha256_update(&ctx->sha, buf, len);
+	memcpy(ctx->dest, buf, len);
+	ctx->dest += len;
+
+	return 0;
+}
+
+/**
+ * Read a raw image from SPI NAND to its load address, hashing it on the way.
+ *
+ * @return 0 on success, -1 on a read error.
+ */
+static int spi_nand_read_hashed(sunxi_spi_t *spi, uint8_t *dest, uint32_t addr, uint32_t size, uint8_t *digest) {
+	spi_nand_hash_ctx_t ctx;
+
+	ctx.dest = dest;
+	sha256_init(&ctx.sha);
+	if (spi_nand_read_stream(spi, (uint8_t *) CONFIG_LZ4_STAGING_ADDR, CHUNK_SIZE, addr, size, spi_nand_hash_feed, &ctx) != (int) size)
+		return -1;
+	sha256_final(&ctx.sha, digest);
+
+	return 0;
+}
+
+typedef struct {
+	lz4_stream_t lz4;
+	sha256_ctx_t sha;
+} spi_nand_lz4_ctx_t;
+
+static int spi_nand_lz4_feed(void *arg, const uint8_t *buf, uint32_t len) {
+	spi_nand_lz4_ctx_t *ctx = (spi_nand_lz4_ctx_t *) arg;
+	uint32_t in_size = ctx->lz4.in_size;
+	int ret;
+
+	ret = lz4_stream_feed(&ctx->lz4, buf, len);
+
+	/* Only hash the stream itself, the last chunk runs past its end */
+	sha256_update(&ctx->sha, buf, ctx->lz4.in_size - in_size);
+
+	return ret;
+}
+
+static int load_spi_nand_lz4(sunxi_spi_t *spi, image_info_t *image) {
+	spi_nand_lz4_ctx_t ctx;
+	uint64_t start, time;
+	int len;
+
+	/* The compressed size is unknown, read until the decoder sees the end of the frame */
+	lz4_stream_init(&ctx.lz4, image->dest, CONFIG_LZ4_MAX_SIZE);
+	sha256_init(&ctx.sha);
+	start = time_us();
+	len = spi_nand_read_stream(spi, (uint8_t *) CONFIG_LZ4_STAGING_ADDR, CHUNK_SIZE, CONFIG_SPINAND_KERNEL_ADDR, CONFIG_LZ4_MAX_SIZE, spi_nand_lz4_feed, &ctx);
+	time = time_us() - start + 1;
+
+	if (len < 0 || lz4_stream_end(&ctx.lz4)) {
+		printk_error("SPI-NAND: LZ4 Image decompression failed\n");
+		return -1;
+	}
+	sha256_final(&ctx.sha, image->digest);
+
+	printk_info("SPI-NAND: LZ4 Image %u -> %u bytes in %ums\n", ctx.lz4.in_size, lz4_stream_size(&ctx.lz4), (uint32_t) (time / 1000));
+
+	return 0;
+}
+
 int load_spi_nand(sunxi_spi_t *spi, image_info_t *image) {
 	linux_zimage_header_t *hdr;
 	unsigned int size;
@@ -157,31 +342,66 @@ int load_spi_nand(sunxi_spi_t *spi, image_info_t *image) {
 	if (spi_nand_detect(spi) != 0)
 		return -1;
 
+	/* Run at the highest clock the sample timing allows, else stay at the board clock */
+	spi_nand_calibrate(spi, CONFIG_SPINAND_CALIB_MAX_CLK);
+
+	/* An erased manifest page means the images are not verified */
+	manifest_loaded = false;
+	spi_nand_read_skip_bad(spi, (uint8_t *) CONFIG_LZ4_STAGING_ADDR, CONFIG_SPINAND_MANIFEST_ADDR, CONFIG_MANIFEST_MAX_SIZE);
+	if (*(uint8_t *) CONFIG_LZ4_STAGING_ADDR != 0xff) {
+		if (manifest_parse(&manifest, (const char *) CONFIG_LZ4_STAGING_ADDR, CONFIG_MANIFEST_MAX_SIZE) < 0) {
+			printk_error("SPI-NAND: manifest is unreadable\n");
+			return -1;
+		}
+		manifest_loaded = true;
+	}
+
 	/* get dtb size and read */
-	spi_nand_read(spi, image->of_dest, CONFIG_SPINAND_DTB_ADDR, (uint32_t) sizeof(struct fdt_header));
+	spi_nand_read_skip_bad(spi, image->of_dest, CONFIG_SPINAND_DTB_ADDR, (uint32_t) sizeof(struct fdt_header));
 	if (fdt_check_header(image->of_dest)) {
 		printk_error("SPI-NAND: DTB verification failed\n");
 		return -1;
 	}
 
 	size = fdt_totalsize(image->of_dest);
+	if (size > CONFIG_SPINAND_DTB_MAX_SIZE) {
+		printk_error("SPI-NAND: dt blob of size %u runs into the manifest block\n", size);
+		return -1;
+	}
 	printk_debug("SPI-NAND: dt blob: Copy from 0x%08x to 0x%08lx size:0x%08x\n", CONFIG_SPINAND_DTB_ADDR, (uint32_t) image->of_dest, size);
 	start = time_us();
-	spi_nand_read(spi, image->of_dest, CONFIG_SPINAND_DTB_ADDR, (uint32_t) size);
+	if (spi_nand_read_hashed(spi, image->of_dest, CONFIG_SPINAND_DTB_ADDR, size, image->of_digest)) {
+		printk_error("SPI-NAND: read dt blob failed\n");
+		return -1;
+	}
 	time = time_us() - start;
 	printk_info("SPI-NAND: read dt blob of size %u at %.2fMB/S\n", size, (f32) (size / time));
 
 	/* get kernel size and read */
-	spi_nand_read(spi, image->dest, CONFIG_SPINAND_KERNEL_ADDR, (uint32_t) sizeof(linux_zimage_header_t));
+	spi_nand_read_skip_bad(spi, (uint8_t *) CONFIG_LZ4_STAGING_ADDR, CONFIG_SPINAND_KERNEL_ADDR, (uint32_t) sizeof(linux_zimage_header_t));
+	if (lz4_is_compressed((void *) CONFIG_LZ4_STAGING_ADDR))
+		return load_spi_nand_lz4(spi, image);
+
+	memcpy(image->dest, (void *) CONFIG_LZ4_STAGING_ADDR, sizeof(linux_zimage_header_t));
 	hdr = (linux_zimage_header_t *) image->dest;
-	if (hdr->magic != LINUX_ZIMAGE_MAGIC) {
+	if (uImage_check_header((uimage_header_t *) image->dest) == 0) {
+		size = uImage_size((uimage_header_t *) image->dest);
+	} else if (hdr->magic == LINUX_ZIMAGE_MAGIC) {
+		size = hdr->end - hdr->start;
+	} else {
 		printk_debug("SPI-NAND: zImage verification failed\n");
 		return -1;
 	}
-	size = hdr->end - hdr->start;
+	if (size > CONFIG_LZ4_STAGING_ADDR - (uint32_t) image->dest) {
+		printk_error("SPI-NAND: Image of size %u runs into the staging buffer\n", size);
+		return -1;
+	}
 	printk_debug("SPI-NAND: Image: Copy from 0x%08x to 0x%08lx size:0x%08x\n", CONFIG_SPINAND_KERNEL_ADDR, (uint32_t) image->dest, size);
 	start = time_us();
-	spi_nand_read(spi, image->dest, CONFIG_SPINAND_KERNEL_ADDR, (uint32_t) size);
+	if (spi_nand_read_hashed(spi, image->dest, CONFIG_SPINAND_KERNEL_ADDR, size, image->digest)) {
+		printk_error("SPI-NAND: read Image failed\n");
+		return -1;
+	}
 	time = time_us() - start;
 	printk_info("SPI-NAND: read Image of size %u at %.2fMB/S\n", size, (f32) (size / time));
 
@@ -189,6 +409,53 @@ int load_spi_nand(sunxi_spi_t *spi, image_info_t *image) {
 }
 
 
+static int uimage_setup(image_info_t *image, uint32_t *entry) {
+	uimage_info_t info;
+	int chosen, ret;
+
+	if (uImage_load(image->dest, &info, true))
+		return -1;
+
+	/* A multi-file image may carry its own device tree */
+	if (info.fdt) {
+		memcpy(image->of_dest, info.fdt, info.fdt_size);
+		if (fdt_check_header(image->of_dest)) {
+			printk_error("uImage: bad device tree\n");
+			return -1;
+		}
+	}
+
+	if (info.ramdisk) {
+		fdt_increase_size(image->of_dest, 512);
+		chosen = fdt_find_or_add_subnode(image->of_dest, 0, "chosen");
+		ret = chosen < 0 ? chosen : fdt_setprop_u32(image->of_dest, chosen, "linux,initrd-start", (uint32_t) info.ramdisk);
+		if (ret == 0)
+			ret = fdt_setprop_u32(image->of_dest, chosen, "linux,initrd-end", (uint32_t) info.ramdisk + info.ramdisk_size);
+		if (ret) {
+			printk_error("uImage: can't set initrd: %s\n", fdt_strerror(ret));
+			return -1;
+		}
+		printk_info("uImage: ramdisk at 0x%08x size %u\n", (uint32_t) info.ramdisk, info.ramdisk_size);
+	}
+
+	printk_info("uImage: '%s' kernel at 0x%08x size %u\n", info.name, (uint32_t) info.kernel, info.kernel_size);
+
+	*entry = info.entry;
+	return 0;
+}
+
+static int verify_images(image_info_t *image) {
+	if (!manifest_loaded) {
+		printk_warning("MANIFEST: not found, images are not verified\n");
+		return 0;
+	}
+
+	if (manifest_verify(&manifest, image->of_filename, image->of_digest) != 0)
+		return -1;
+
+	return manifest_verify(&manifest, image->filename, image->digest);
+}
+
 int main(void) {
 	sunxi_serial_init(&uart_dbg);
 
@@ -240,7 +507,20 @@ _spi:
 	sunxi_spi_disable(&sunxi_spi0);
 
 _boot:
-	if (zImage_loader((unsigned char *) image.dest, &entry_point)) {
+	if (verify_images(&image) != 0) {
+		printk_error("image verification failed, refusing to boot\n");
+		abort();
+	}
+
+	/* Formats with a header first, the plain Image is recognised by elimination */
+	if (uImage_check_header((uimage_header_t *) image.dest) == 0) {
+		if (uimage_setup(&image, &entry_point)) {
+			printk_error("boot setup failed\n");
+			abort();
+		}
+	} else if (Image_loader((unsigned char *) image.dest, &entry_point) == 0) {
+		printk_info("Linux Image: entered directly, no kernel decompression\n");
+	} else if (zImage_loader((unsigned char *) image.dest, &entry_point)) {
 		printk_error("boot setup failed\n");
 		abort();
 	}
@@ -258,7 +538,7 @@ _boot:
 	enable_kernel_smp();
 	printk_info("enable kernel smp ok...\n");
 
-	printk_info("jump to kernel address: 0x%x\n\n", image.dest);
+	printk_info("jump to kernel address: 0x%x at %ums\n\n", entry_point, time_ms());
 
 	kernel_entry = (void (*)(int, int, unsigned int)) entry_point;
 	kernel_entry(0, ~0, (unsigned int) image.of_dest);
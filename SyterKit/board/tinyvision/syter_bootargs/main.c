@@ -160,7 +160,7 @@ int load_spi_nand(sunxi_spi_t *spi, image_info_t *image) {
 		return -1;
 
 	/* get dtb size and read */
-	spi_nand_read(spi, image->of_dest, CONFIG_SPINAND_DTB_ADDR, (uint32_t) sizeof(struct fdt_header));
+	spi_nand_read_skip_bad(spi, image->of_dest, CONFIG_SPINAND_DTB_ADDR, (uint32_t) sizeof(struct fdt_header));
 	if (fdt_check_header(image->of_dest)) {
 		printk_error("SPI-NAND: DTB verification failed\n");
 		return -1;
@@ -169,12 +169,15 @@ int load_spi_nand(sunxi_spi_t *spi, image_info_t *image) {
 	size = fdt_totalsize(image->of_dest);
 	printk_debug("SPI-NAND: dt blob: Copy from 0x%08x to 0x%08lx size:0x%08x\n", CONFIG_SPINAND_DTB_ADDR, (uint32_t) image->of_dest, size);
 	start = time_us();
-	spi_nand_read(spi, image->of_dest, CONFIG_SPINAND_DTB_ADDR, (uint32_t) size);
+	if (spi_nand_read_skip_bad(spi, image->of_dest, CONFIG_SPINAND_DTB_ADDR, (uint32_t) size) != size) {
+		printk_error("SPI-NAND: read dt blob failed\n");
+		return -1;
+	}
 	time = time_us() - start;
 	printk_info("SPI-NAND: read dt blob of size %u at %.2fMB/S\n", size, (f32) (size / time));
 
 	/* get kernel size and read */
-	spi_nand_read(spi, image->dest, CONFIG_SPINAND_KERNEL_ADDR, (uint32_t) sizeof(linux_zimage_header_t));
+	spi_nand_read_skip_bad(spi, image->dest, CONFIG_SPINAND_KERNEL_ADDR, (uint32_t) sizeof(linux_zimage_header_t));
 	hdr = (linux_zimage_header_t *) image->dest;
 	if (hdr->magic != LINUX_ZIMAGE_MAGIC) {
 		printk_debug("SPI-NAND: zImage verification failed\n");
@@ -183,7 +186,10 @@ int load_spi_nand(sunxi_spi_t *spi, image_info_t *image) {
 	size = hdr->end - hdr->start;
 	printk_debug("SPI-NAND: Image: Copy from 0x%08x to 0x%08lx size:0x%08x\n", CONFIG_SPINAND_KERNEL_ADDR, (uint32_t) image->dest, size);
 	start = time_us();
-	spi_nand_read(spi, image->dest, CONFIG_SPINAND_KERNEL_ADDR, (uint32_t) size);
+	if (spi_nand_read_skip_bad(spi, image->dest, CONFIG_SPINAND_KERNEL_ADDR, (uint32_t) size) != size) {
+		printk_error("SPI-NAND: read Image failed\n");
+		return -1;
+	}
 	time = time_us() - start;
 	printk_info("SPI-NAND: read Image of size %u at %.2fMB/S\n", size, (f32) (size / time));
 
@@ -1,10 +1,19 @@
 # SPDX-License-Identifier: GPL-2.0+
 
 set(CONFIG_ARCH_ARM32 True)
+set(CONFIG_ARCH_ARM32_NEON True)
 set(CONFIG_CHIP_SUN8IW20 True)
 set(CONFIG_BOARD_100ASK-T113I True)
+set(CONFIG_CHIP_GIC True)
+set(CONFIG_CHIP_SMP True)
+set(CONFIG_LOG_ASYNC True)
+set(CONFIG_LOG_RAMOOPS True)
 
 add_definitions(-DCONFIG_CHIP_SUN8IW20)
+add_definitions(-DCONFIG_CHIP_GIC)
+add_definitions(-DCONFIG_CHIP_SMP)
+add_definitions(-DCONFIG_LOG_ASYNC)
+add_definitions(-DCONFIG_LOG_RAMOOPS)
 
 # Options
 
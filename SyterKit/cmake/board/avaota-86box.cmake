@@ -1,6 +1,7 @@
 # SPDX-License-Identifier: GPL-2.0+
 
 set(CONFIG_ARCH_ARM32 True)
+set(CONFIG_ARCH_ARM32_NEON True)
 set(CONFIG_CHIP_SUN8IW20 True)
 set(CONFIG_BOARD_AVAOTA-86BOX True)
 set(CONFIG_CHIP_MMC_V2 True)
@@ -9,6 +10,7 @@ set(CONFIG_CHIP_GIC True)
 
 add_definitions(-DCONFIG_CHIP_SUN8IW20)
 add_definitions(-DCONFIG_CHIP_MMC_V2)
+add_definitions(-DCONFIG_CHIP_GIC)
 add_definitions(-DCONFIG_FATFS_CACHE_SIZE=0x2000000)
 add_definitions(-DCONFIG_FATFS_CACHE_ADDR=0x48000000)
 
@@ -1,6 +1,7 @@
 # SPDX-License-Identifier: GPL-2.0+
 
 set(CONFIG_ARCH_ARM32 True)
+set(CONFIG_ARCH_ARM32_NEON True)
 set(CONFIG_CHIP_SUN8IW21 True)
 set(CONFIG_BOARD_DONGSHANPI_AICT True)
 
@@ -1,6 +1,7 @@
 # SPDX-License-Identifier: GPL-2.0+
 
 set(CONFIG_ARCH_ARM32 True)
+set(CONFIG_ARCH_ARM32_NEON True)
 set(CONFIG_CHIP_SUN8IW20 True)
 set(CONFIG_CHIP_WITHPMU True)
 set(CONFIG_CHIP_USB True)
@@ -8,6 +9,7 @@ set(CONFIG_CHIP_GIC True)
 set(CONFIG_BOARD_YUZUKIHOMEKIT True)
 
 add_definitions(-DCONFIG_CHIP_SUN8IW20 -DCONFIG_FATFS_CACHE_SIZE=0x2000000 -DCONFIG_FATFS_CACHE_ADDR=0x48000000)
+add_definitions(-DCONFIG_CHIP_GIC)
 
 # Options
 
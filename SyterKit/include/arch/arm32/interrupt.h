@@ -44,4 +44,33 @@ static inline void arm32_interrupt_disable(void) {
 						 : "memory");
 }
 
+/**
+ * @brief Disable interrupts in ARM32 mode and return the previous state.
+ *
+ * @return The CPSR value before interrupts were disabled, to be passed to
+ *         arm32_interrupt_restore().
+ */
+static inline uint32_t arm32_interrupt_save(void) {
+	uint32_t flags;
+
+	__asm__ __volatile__("mrs %0, cpsr\n"
+						 "cpsid i"
+						 : "=r"(flags)
+						 :
+						 : "memory");
+	return flags;
+}
+
+/**
+ * @brief Restore the interrupt state saved by arm32_interrupt_save().
+ *
+ * @param flags The CPSR value returned by arm32_interrupt_save().
+ */
+static inline void arm32_interrupt_restore(uint32_t flags) {
+	__asm__ __volatile__("msr cpsr_c, %0"
+						 :
+						 : "r"(flags)
+						 : "memory");
+}
+
 #endif /* __INTERRUPT_H__ */
\ No newline at end of file
@@ -0,0 +1,96 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+
+#ifndef __SMP_H__
+#define __SMP_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif// __cplusplus
+
+/* SGI used by both cores, new work for CPU1 and completions for CPU0 */
+#define SMP_SGI_WORK 1
+
+/* Work items in flight, the results of older items get overwritten */
+#define SMP_QUEUE_LEN 8
+
+#ifndef CONFIG_SMP_STACK_SIZE
+#define CONFIG_SMP_STACK_SIZE 0x1000
+#endif
+
+/**
+ * @brief Work function run on the secondary core.
+ */
+typedef int (*smp_fn_t)(void *arg);
+
+/**
+ * @brief Boot parameters handed to the secondary core, filled in by smp_init().
+ */
+typedef struct {
+	uint32_t stack; /**< Top of the secondary core stack */
+	uint32_t ttbr0; /**< Translation table of the boot core */
+	uint32_t dacr;	/**< Domain access control of the boot core */
+	uint32_t sctlr; /**< System control of the boot core, MMU and caches */
+} smp_boot_param_t;
+
+/**
+ * @brief Release CPU1 into an idle loop waiting for work.
+ *
+ * CPU1 gets its own stack and the MMU setup of CPU0, so call this after
+ * arm32_mmu_enable() and arch_interrupt_init(). Completions are signalled
+ * to CPU0 with an SGI, the board has to route IRQs to do_irq() to use
+ * smp_wait() with interrupts enabled.
+ *
+ * @return 0 on success, -1 if CPU1 did not come up.
+ */
+int smp_init(void);
+
+/**
+ * @brief Wait for CPU1 to go idle and put it back into reset.
+ *
+ * Call before handing over to the kernel, which brings CPU1 up itself.
+ */
+void smp_exit(void);
+
+/**
+ * @brief Queue a function to run on CPU1.
+ *
+ * The function must not use the console or anything else CPU0 may be using
+ * at the same time.
+ *
+ * @param fn The function to run.
+ * @param arg The argument passed to the function.
+ * @return A ticket for smp_wait(), or -1 if CPU1 is not running or the queue is full.
+ */
+int smp_run_async(smp_fn_t fn, void *arg);
+
+/**
+ * @brief Check whether a queued function has returned.
+ *
+ * @param ticket The ticket returned by smp_run_async().
+ * @return true if the function has returned.
+ */
+bool smp_work_done(int ticket);
+
+/**
+ * @brief Wait for a queued function to return.
+ *
+ * CPU0 sleeps in WFI until the completion SGI arrives.
+ *
+ * @param ticket The ticket returned by smp_run_async().
+ * @return The return value of the function.
+ */
+int smp_wait(int ticket);
+
+/**
+ * @brief Wait until CPU1 has run all queued functions.
+ */
+void smp_wait_all(void);
+
+#ifdef __cplusplus
+}
+#endif// __cplusplus
+
+#endif// __SMP_H__
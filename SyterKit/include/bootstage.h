@@ -0,0 +1,66 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+
+#ifndef __BOOTSTAGE_H__
+#define __BOOTSTAGE_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif// __cplusplus
+
+#define BOOTSTAGE_MAX_RECORDS 32
+
+/* Node under /chosen the records are exported to */
+#define BOOTSTAGE_FDT_NODE "syterkit,bootstage"
+
+/**
+ * @brief One named boot timestamp.
+ */
+typedef struct {
+	const char *name; /**< Stage name, must stay valid until the jump */
+	uint32_t time_us; /**< time_us() when the stage was reached */
+} bootstage_record_t;
+
+/**
+ * Record that a boot stage has been reached.
+ *
+ * Records past BOOTSTAGE_MAX_RECORDS are dropped and counted.
+ *
+ * @param name The stage name, a string literal or other static string.
+ * @return The timestamp in microseconds.
+ */
+uint32_t bootstage_mark(const char *name);
+
+/**
+ * Get the recorded stages.
+ *
+ * @param count Returns the number of records.
+ * @return The records in the order they were marked.
+ */
+const bootstage_record_t *bootstage_get(int *count);
+
+/**
+ * Print the recorded stages as a table with the time spent in each stage.
+ */
+void bootstage_dump(void);
+
+/**
+ * Export the recorded stages to /chosen/syterkit,bootstage.
+ *
+ * The node gets a "names" string list and a "timestamps-us" cell array of
+ * the same length. The blob is grown when it has no room left.
+ *
+ * @param fdt The device tree blob.
+ * @return 0 on success, -1 otherwise.
+ */
+int bootstage_fdt_export(void *fdt);
+
+#ifdef __cplusplus
+}
+#endif// __cplusplus
+
+#endif// __BOOTSTAGE_H__
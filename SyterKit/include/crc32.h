@@ -0,0 +1,33 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+
+#ifndef __CRC32_H__
+#define __CRC32_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif// __cplusplus
+
+/**
+ * Update a CRC-32 (IEEE 802.3, as used by zlib and uImage) with more data.
+ *
+ * Start with crc = 0 and pass the result of the previous call to continue,
+ * so data can be checked chunk by chunk as it is loaded. The lookup tables
+ * are built on the first call.
+ *
+ * @param crc The CRC of the data so far, 0 to start.
+ * @param buf The data.
+ * @param len The number of bytes.
+ * @return The CRC of the data so far including buf.
+ */
+uint32_t crc32(uint32_t crc, const void *buf, uint32_t len);
+
+#ifdef __cplusplus
+}
+#endif// __cplusplus
+
+#endif// __CRC32_H__
@@ -83,4 +83,18 @@
 #define RISCV_STA_ADD_L_REG (RISCV_CFG_BASE + 0x0004)
 #define RISCV_STA_ADD_H_REG (RISCV_CFG_BASE + 0x0008)
 
+/*
+ * CPUX cluster 0 configuration, releases the second Cortex-A7
+ */
+#define C0_CPUX_CFG_BASE (0x09010000)
+#define C0_RST_CTRL_REG (C0_CPUX_CFG_BASE + 0x0000)	  /* Core reset, bit n releases core n */
+#define C0_CPU_STATUS_REG (C0_CPUX_CFG_BASE + 0x0080) /* Core status */
+#define BIT_C0_CORE_RST(cpu) (cpu)
+#define BIT_C0_STANDBYWFI(cpu) (16 + (cpu))
+
+/*
+ * Secondary core entry address, read by the BROM when the core leaves reset
+ */
+#define CPUX_SOFT_ENTRY_REG (0x07000400 + 0x01c8)
+
 #endif// __REG_RPROC_H__
\ No newline at end of file
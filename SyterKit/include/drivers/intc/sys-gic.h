@@ -58,6 +58,23 @@ int sunxi_gic_cpu_interface_init(int cpu);
  */
 int sunxi_gic_cpu_interface_exit(void);
 
+/**
+ * @brief Sends a software generated interrupt
+ * 
+ * @param sgi SGI number, 0 to 15
+ * @param cpu_mask Bit mask of the target CPUs
+ */
+void sunxi_gic_send_sgi(int sgi, uint32_t cpu_mask);
+
+/**
+ * @brief Acknowledges the highest pending interrupt of the calling CPU without dispatching it
+ * 
+ * Meant for cores running with IRQs masked that only use interrupts to leave WFI.
+ * 
+ * @return The interrupt number, or -1 if none was pending
+ */
+int sunxi_gic_ack_irq(void);
+
 #ifdef __cplusplus
 }
 #endif// __cplusplus
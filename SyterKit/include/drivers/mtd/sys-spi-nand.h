@@ -20,6 +20,12 @@
 extern "C" {
 #endif// __cplusplus
 
+/* Largest number of blocks covered by the in-RAM bad block table */
+#define SPI_NAND_BBT_MAX_BLOCKS 4096
+
+/* Number of times a read is retried after an uncorrectable ECC error */
+#define SPI_NAND_READ_RETRY 3
+
 /**
  * @brief Represents the NAND Device ID structure.
  */
@@ -42,6 +48,7 @@ typedef struct {
 	uint32_t planes_per_die;  /**< Number of planes present on a single die. */
 	uint32_t ndies;			  /**< Total number of dies in the NAND package. */
 	spi_io_mode_t mode;		  /**< I/O mode used for communication (assumes the existence of a spi_io_mode_t type). */
+	bool cache_read;		  /**< Supports the sequential cache read commands (0x31/0x3f). */
 } spi_nand_info_t;
 
 /**
@@ -63,6 +70,62 @@ int spi_nand_detect(sunxi_spi_t *spi);
  */
 uint32_t spi_nand_read(sunxi_spi_t *spi, uint8_t *buf, uint32_t addr, uint32_t rxlen);
 
+/**
+ * Read data from SPI NAND flash, skipping bad blocks.
+ *
+ * The factory bad block marker of each block is checked on its first access
+ * and kept in a bad block table, so a block is only scanned once. Bad blocks
+ * are skipped and the data continues in the next good block. Runs of good
+ * blocks are read with a single spi_nand_read(), so there is no overhead
+ * once the blocks are known to be good. A read hitting an uncorrectable ECC
+ * error is retried up to SPI_NAND_READ_RETRY times.
+ *
+ * @param spi Pointer to the sunxi_spi_t structure.
+ * @param buf Pointer to the buffer to store the read data.
+ * @param addr Page aligned start address of the data, ignoring bad blocks.
+ * @param rxlen Number of bytes to read.
+ * @return Number of bytes read, less than rxlen on error.
+ */
+uint32_t spi_nand_read_skip_bad(sunxi_spi_t *spi, uint8_t *buf, uint32_t addr, uint32_t rxlen);
+
+/**
+ * Chunk callback of spi_nand_read_stream().
+ *
+ * @return 0 to continue, 1 once all data has been consumed, -1 to abort.
+ */
+typedef int (*spi_nand_stream_cb_t)(void *arg, const uint8_t *buf, uint32_t len);
+
+/**
+ * Read data in chunks, skipping bad blocks, and hand each chunk to a callback.
+ *
+ * Lets the consumer work on the data as it arrives, e.g. decompress it to
+ * its final address, when the total size is not known up front.
+ *
+ * @param spi Pointer to the sunxi_spi_t structure.
+ * @param buf Chunk buffer, reused for every chunk.
+ * @param chunk Size of the chunk buffer, a multiple of the page size.
+ * @param addr Page aligned start address of the data, ignoring bad blocks.
+ * @param max_len Maximum number of bytes to read.
+ * @param cb Callback receiving each chunk.
+ * @param arg Argument passed to the callback.
+ * @return Number of bytes read, or -1 on a read error or if the callback aborted.
+ */
+int spi_nand_read_stream(sunxi_spi_t *spi, uint8_t *buf, uint32_t chunk, uint32_t addr, uint32_t max_len, spi_nand_stream_cb_t cb, void *arg);
+
+/**
+ * Calibrate the SPI sample timing against the flash and raise the clock.
+ *
+ * The reference pattern, made of the ID bytes and the start of page 0 read
+ * with the configured I/O mode, is read at the current clock, which must be
+ * safe. See sunxi_spi_calibrate() for the search itself.
+ *
+ * @param spi Pointer to the sunxi_spi_t structure, after spi_nand_detect().
+ * @param max_clk Highest clock rate to try.
+ * @return The calibrated clock rate, or 0 if calibration failed and the
+ *         starting clock is kept.
+ */
+uint32_t spi_nand_calibrate(sunxi_spi_t *spi, uint32_t max_clk);
+
 #ifdef __cplusplus
 }
 #endif// __cplusplus
@@ -102,6 +102,8 @@ typedef struct spi_nor_info {
 	uint8_t opcode_erase_32k;	 /**< Opcode to erase a 32K block of the SPI NOR Flash. */
 	uint8_t opcode_erase_64k;	 /**< Opcode to erase a 64K block of the SPI NOR Flash. */
 	uint8_t opcode_erase_256k;	 /**< Opcode to erase a 256K block of the SPI NOR Flash. */
+	spi_io_mode_t read_mode;	 /**< I/O mode used with opcode_read, single unless picked from SFDP. */
+	uint8_t read_dummy;			 /**< Mode and dummy bytes sent after the address for opcode_read. */
 } spi_nor_info_t;
 
 /**
@@ -118,6 +120,10 @@ enum SPI_NOR_OPS {
 	NOR_OPCODE_RDID = 0x9f,		/**< Read ID Command: Retrieve the identity of the memory device */
 	NOR_OPCODE_WRSR = 0x01,		/**< Write Status Register Command: Write to the status register */
 	NOR_OPCODE_RDSR = 0x05,		/**< Read Status Register Command: Read the current status register */
+	NOR_OPCODE_RDSR2 = 0x35,	/**< Read Status Register 2 Command: Read the second status register */
+	NOR_OPCODE_WRSR2 = 0x31,	/**< Write Status Register 2 Command: Write to the second status register */
+	NOR_OPCODE_RDSR2_B7 = 0x3f, /**< Read Status Register 2 Command for parts with QE at bit 7 */
+	NOR_OPCODE_WRSR2_B7 = 0x3e, /**< Write Status Register 2 Command for parts with QE at bit 7 */
 	NOR_OPCODE_WREN = 0x06,		/**< Write Enable Command: Enable write operations on the memory */
 	NOR_OPCODE_READ = 0x03,		/**< Read Data Command: Read data from the memory */
 	NOR_OPCODE_PROG = 0x02,		/**< Page Program Command: Program data into a memory page */
@@ -231,6 +237,21 @@ uint32_t spi_nor_read_block(sunxi_spi_t *spi, uint8_t *buf, uint32_t blk_no, uin
  */
 uint32_t spi_nor_read(sunxi_spi_t *spi, uint8_t *buf, uint32_t addr, uint32_t rxlen);
 
+/**
+ * @brief Calibrates the SPI sample timing against the flash and raises the clock.
+ *
+ * The reference pattern, made of the SFDP headers and the start of the flash
+ * read with the selected fast read mode, is read at the current clock, which
+ * must be safe. See `sunxi_spi_calibrate` for the search itself.
+ *
+ * @param[in] spi Pointer to the SPI interface structure, after `spi_nor_detect`.
+ * @param[in] max_clk Highest clock rate to try.
+ *
+ * @return The calibrated clock rate, or 0 if calibration failed and the
+ *         starting clock is kept.
+ */
+uint32_t spi_nor_calibrate(sunxi_spi_t *spi, uint32_t max_clk);
+
 #ifdef __cplusplus
 }
 #endif// __cplusplus
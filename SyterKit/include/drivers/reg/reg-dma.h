@@ -14,6 +14,7 @@ extern "C" {
 
 #define SUNXI_DMA_CHANNEL_SIZE (0x40)
 #define SUNXI_DMA_LINK_NULL (0xfffff800)
+#define SUNXI_DMA_DESC_MAX_BYTES (0x1000000) /* bytes moved by one descriptor, 25 bit counter rounded down */
 
 #define DMAC_DMATYPE_NORMAL 0
 #define DMAC_CFG_TYPE_DRAM (1)
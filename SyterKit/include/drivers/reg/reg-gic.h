@@ -40,6 +40,10 @@ extern "C" {
 #define GIC_PPI_PRIO(_n) (GIC_DIST_BASE + 0x410 + 4 * (_n))
 #define GIC_SPI_PRIO(_n) (GIC_DIST_BASE + 0x420 + 4 * (_n))
 #define GIC_SPI_PROC_TARG(_n) (GIC_DIST_BASE + 0x820 + 4 * (_n))
+#define GIC_SGI_REG (GIC_DIST_BASE + 0xf00)
+
+/* interrupt ID field of GIC_INT_ACK_REG, the upper bits hold the SGI source CPU */
+#define GIC_INT_ACK_ID_MASK (0x3ff)
 
 /* software generated interrupt */
 #define GIC_SRC_SGI(_n) (_n)
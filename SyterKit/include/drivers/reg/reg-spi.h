@@ -112,6 +112,7 @@
 /* SPI Sample Delay Mode,default:0xaaaa_ffff */
 #define SPI_SAMP_MODE_EN (1U << 2)
 #define SPI_SAMP_DL_SW_EN (1U << 7)
+#define SPI_SAMP_DL_SW_MASK (0x3fU << 0)
 #define DELAY_NORMAL_SAMPLE (0x100)
 #define DELAY_0_5_CYCLE_SAMPLE (0x000)
 #define DELAY_1_CYCLE_SAMPLE (0x010)
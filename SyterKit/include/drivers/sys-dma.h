@@ -94,9 +94,31 @@ typedef struct {
 	sunxi_dma_channel_reg_t *channel;
 	uint32_t reserved;
 	sunxi_dma_desc_t *desc;
+	sunxi_dma_desc_t *chain; /* descriptors taken from the pool by sunxi_dma_start_sg */
 	sunxi_dma_irq_handler_t dma_func;
 } sunxi_dma_source_t;
 
+typedef struct {
+	uint32_t src; /* source address */
+	uint32_t dst; /* destination address */
+	uint32_t len; /* number of bytes */
+} sunxi_dma_sg_t;
+
+struct sunxi_dma_req;
+
+typedef void (*sunxi_dma_cb_t)(struct sunxi_dma_req *req, void *arg);
+
+typedef struct sunxi_dma_req {
+	sunxi_dma_set_t cfg;	   /* channel configuration */
+	const sunxi_dma_sg_t *sg;  /* segments to transfer */
+	uint32_t count;			   /* number of segments */
+	sunxi_dma_cb_t done;	   /* completion callback, may be NULL */
+	void *arg;				   /* argument of the completion callback */
+	struct sunxi_dma_req *next;/* scheduler queue link */
+	uint32_t dma_fd;		   /* channel running the request, 0 while queued */
+	volatile bool busy;		   /* set from submission until completion */
+} sunxi_dma_req_t;
+
 typedef struct {
 	uint32_t dma_reg_base;
 	sunxi_clk_t dma_clk;
@@ -160,6 +182,22 @@ int sunxi_dma_setting(uint32_t dma_fd, sunxi_dma_set_t *cfg);
  */
 int sunxi_dma_start(uint32_t dma_fd, uint32_t saddr, uint32_t daddr, uint32_t bytes);
 
+/**
+ * Start a scatter-gather DMA transfer.
+ *
+ * The segments are queued as a chain of descriptors taken from a shared pool,
+ * using the channel configuration set by sunxi_dma_setting(). Segments larger
+ * than SUNXI_DMA_DESC_MAX_BYTES are split. An address in IO mode stays fixed
+ * across the segment. The descriptors are given back to the pool on the next
+ * start, stop or release of the channel.
+ *
+ * @param dma_fd The DMA channel number to start the transfer on.
+ * @param sg Array of segments.
+ * @param count Number of segments.
+ * @return 0 if successful, -1 if the channel is not requested or the pool is exhausted.
+ */
+int sunxi_dma_start_sg(uint32_t dma_fd, const sunxi_dma_sg_t *sg, uint32_t count);
+
 /**
  * Stop a currently running DMA transfer.
  *
@@ -229,6 +267,86 @@ int sunxi_dma_disable_int(uint32_t dma_fd);
  */
 int sunxi_dma_free_int(uint32_t dma_fd);
 
+/**
+ * Start a DRAM to DRAM copy on a free DMA channel.
+ *
+ * The source is written back from the data cache and the destination is
+ * cleaned before the copy, dma_memcpy_wait() invalidates the destination.
+ * The CPU must not touch the destination until then. Whole words are moved
+ * when both addresses and the length are 4 byte aligned, bytes otherwise.
+ *
+ * @param dst Destination address.
+ * @param src Source address.
+ * @param len Number of bytes to copy.
+ * @return The DMA channel running the copy, or 0 if no channel or descriptor is free.
+ */
+uint32_t dma_memcpy_async(void *dst, const void *src, uint32_t len);
+
+/**
+ * Start filling DRAM with a byte on a free DMA channel.
+ *
+ * The source is a pattern word read in IO mode, otherwise the same as dma_memcpy_async().
+ *
+ * @param dst Destination address.
+ * @param c Byte to fill with.
+ * @param len Number of bytes to fill.
+ * @return The DMA channel running the fill, or 0 if no channel or descriptor is free.
+ */
+uint32_t dma_memset_async(void *dst, uint8_t c, uint32_t len);
+
+/**
+ * Wait for a copy started by dma_memcpy_async() or dma_memset_async().
+ *
+ * Invalidates the destination from the data cache and releases the channel.
+ *
+ * @param dma_fd The DMA channel running the copy.
+ * @return 0 if successful, -1 if the channel is not in use.
+ */
+int dma_memcpy_wait(uint32_t dma_fd);
+
+/**
+ * Copy DRAM to DRAM with the DMA controller and wait for it.
+ *
+ * Falls back to the CPU memcpy() when no DMA channel is available.
+ *
+ * @param dst Destination address.
+ * @param src Source address.
+ * @param len Number of bytes to copy.
+ * @return 0 if copied by DMA, 1 if copied by the CPU.
+ */
+int dma_memcpy(void *dst, const void *src, uint32_t len);
+
+/**
+ * Submit a request to the DMA channel scheduler.
+ *
+ * The request starts on a free channel right away, or is queued until a
+ * channel is released. Completion is detected by the DMA interrupt when the
+ * GIC is available, otherwise by sunxi_dma_sched_poll(). The channel is then
+ * released, the completion callback called and the next queued request
+ * started. Caches are not maintained, the owner of the buffers has to.
+ *
+ * The request and its segments must stay valid until it is completed.
+ *
+ * @param req The request to run.
+ * @return 0 if the request is started or queued, -1 if it is invalid or already submitted.
+ */
+int sunxi_dma_submit(sunxi_dma_req_t *req);
+
+/**
+ * Complete finished scheduler requests and start queued ones.
+ *
+ * Called from the DMA interrupt, and can be called in polling loops when
+ * interrupts are not enabled.
+ */
+void sunxi_dma_sched_poll(void);
+
+/**
+ * Wait for a submitted request to complete.
+ *
+ * @param req The request to wait for.
+ */
+void sunxi_dma_wait(sunxi_dma_req_t *req);
+
 /**
  * Perform a test DMA transfer between the specified source and destination addresses.
  *
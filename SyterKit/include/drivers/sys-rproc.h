@@ -168,6 +168,32 @@ void sunxi_a53_clock_init(uint32_t addr);
  */
 void sunxi_a53_clock_reset(void);
 
+/**
+ * @brief Release a secondary CPUX core from reset.
+ * 
+ * The core starts executing in ARM state at the given physical address
+ * with the MMU and caches off.
+ * 
+ * @param cpu The core number within cluster 0.
+ * @param entry The physical entry address.
+ */
+void sunxi_cpux_start(int cpu, uint32_t entry);
+
+/**
+ * @brief Hold a secondary CPUX core in reset.
+ * 
+ * @param cpu The core number within cluster 0.
+ */
+void sunxi_cpux_stop(int cpu);
+
+/**
+ * @brief Check whether a CPUX core sits in WFI.
+ * 
+ * @param cpu The core number within cluster 0.
+ * @return 1 if the core is in WFI, 0 otherwise.
+ */
+int sunxi_cpux_is_wfi(int cpu);
+
 
 #ifdef __cplusplus
 }
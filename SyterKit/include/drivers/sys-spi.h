@@ -84,6 +84,17 @@ typedef struct {
 	spi_clk_cdr_mode_t cdr_mode;		/**< Clock mode */
 } sunxi_spi_clk_t;
 
+/**
+ * @brief SPI Sample Timing Structure
+ * 
+ * This struct holds the sample mode and delay chain setting found by `sunxi_spi_calibrate`.
+ */
+typedef struct {
+	uint32_t freq;	/**< Bus clock the setting was calibrated at, 0 if not calibrated */
+	uint32_t mode;	/**< Sample mode, one of the DELAY_*_SAMPLE values */
+	uint32_t delay; /**< Delay chain setting, 0 to leave the delay chain off */
+} sunxi_spi_samp_t;
+
 /**
  * @brief SPI Device Configuration Structure
  * 
@@ -97,14 +108,34 @@ typedef struct {
 	sunxi_dma_t *dma_handle;	/**< DMA handle for the SPI device */
 	sunxi_clk_t parent_clk_reg; /**< Parent clock register configuration */
 	sunxi_spi_clk_t spi_clk;	/**< SPI clock configuration */
+	sunxi_spi_samp_t samp;		/**< Calibrated sample timing */
 } sunxi_spi_t;
 
+/**
+ * @brief SPI transfer completion callback.
+ * 
+ * Called once the transfer started by `sunxi_spi_transfer_async` is finished
+ * and its data is in memory. A new transfer may be started from the callback.
+ */
+typedef void (*sunxi_spi_xfer_cb_t)(sunxi_spi_t *spi, void *arg);
+
+/**
+ * @brief SPI calibration pattern check.
+ * 
+ * Reads a known pattern from the device and compares it with a reference taken
+ * at a safe clock.
+ * 
+ * @return 0 if the pattern was read back correctly, -1 otherwise.
+ */
+typedef int (*sunxi_spi_calib_check_t)(sunxi_spi_t *spi, void *arg);
+
 #define MAX_FIFU (64)						   /**< Maximum FIFO size set to 64. */
 #define SPI_CLK_SEL_PERIPH_300M (0x1)		   /**< Selects the SPI peripheral clock to 300 MHz. */
 #define SPI_CLK_SEL_PERIPH_200M (0x2)		   /**< Selects the SPI peripheral clock to 200 MHz. */
 #define SPI_CLK_SEL_FACTOR_N_OFF (8)		   /**< Offset for the SPI clock select factor is 8. */
 #define SPI_DEFAULT_CLK_RST_OFFSET(x) (x + 16) /**< Returns the default clock reset offset, based on the SPI module number (x). */
 #define SPI_DEFAULT_CLK_GATE_OFFSET(x) (x)	   /**< Returns the default clock gate offset, based on the SPI module number (x). */
+#define SPI_SAMP_MIN_WINDOW (2)				   /**< Minimum number of passing sample modes for a clock to be considered stable. */
 
 /**
  * @brief Initializes the SPI interface.
@@ -142,6 +173,28 @@ void sunxi_spi_disable(sunxi_spi_t *spi);
  */
 int sunxi_spi_update_clk(sunxi_spi_t *spi, uint32_t clk);
 
+/**
+ * @brief Calibrates the sample timing and raises the SPI clock.
+ * 
+ * Starting from the current clock, which must read the pattern correctly, the clock is
+ * raised one divider step at a time up to `max_clk`. At each step all sample modes are
+ * tried, and the clock is kept while at least SPI_SAMP_MIN_WINDOW adjacent modes read
+ * the pattern correctly. At the highest stable clock, the delay chain is swept for each
+ * sample mode and the mode with the widest passing window is used, with the delay set
+ * to the centre of that window.
+ * 
+ * The result is stored in `spi->samp` and applied whenever the bus runs at the
+ * calibrated clock again.
+ * 
+ * @param spi Pointer to the SPI structure containing configuration and register information.
+ * @param max_clk Highest clock rate to try.
+ * @param check Pattern check callback.
+ * @param arg Argument passed to the pattern check callback.
+ * 
+ * @return The calibrated clock rate, or 0 if the pattern fails at the starting clock.
+ */
+uint32_t sunxi_spi_calibrate(sunxi_spi_t *spi, uint32_t max_clk, sunxi_spi_calib_check_t check, void *arg);
+
 /**
  * @brief Performs SPI data transfer.
  * 
@@ -162,6 +215,52 @@ int sunxi_spi_update_clk(sunxi_spi_t *spi, uint32_t clk);
 int sunxi_spi_transfer(sunxi_spi_t *spi, spi_io_mode_t mode, void *txbuf, uint32_t txlen, void *rxbuf, uint32_t rxlen);
 
 
+/**
+ * @brief Starts an SPI data transfer without waiting for it to finish.
+ * 
+ * Transfers larger than the FIFO move their data by DMA when the SPI device has a DMA
+ * handle, transmission needs a length multiple of 4 for that. Smaller transfers go
+ * through the FIFO. The reception buffer is not cleared, and buffers are kept coherent
+ * with the data cache around the DMA. Without DMA, a reception larger than the FIFO is
+ * drained before returning.
+ * 
+ * Only one transfer can be in flight. It is finished by `sunxi_spi_transfer_poll` or
+ * `sunxi_spi_transfer_wait`, which also call the completion callback. The buffers must
+ * stay valid until then.
+ * 
+ * @param spi Pointer to the SPI structure containing configuration and register information.
+ * @param mode The I/O mode to use for the transfer (e.g., single, dual, quad).
+ * @param txbuf Pointer to the transmission buffer.
+ * @param txlen Length of the transmission data in bytes.
+ * @param rxbuf Pointer to the reception buffer.
+ * @param rxlen Length of the reception data in bytes.
+ * @param done Optional completion callback.
+ * @param arg Argument passed to the completion callback.
+ * 
+ * @return 0 if the transfer is started, -1 if another transfer is in flight.
+ */
+int sunxi_spi_transfer_async(sunxi_spi_t *spi, spi_io_mode_t mode, void *txbuf, uint32_t txlen, void *rxbuf, uint32_t rxlen, sunxi_spi_xfer_cb_t done,
+							 void *arg);
+
+/**
+ * @brief Checks whether the transfer in flight is finished.
+ * 
+ * Finishes the transfer and calls its completion callback when the controller and the
+ * DMA channels are done.
+ * 
+ * @param spi Pointer to the SPI structure.
+ * 
+ * @return 1 while the transfer is in flight, 0 once it is finished or if none was started.
+ */
+int sunxi_spi_transfer_poll(sunxi_spi_t *spi);
+
+/**
+ * @brief Waits for the transfer in flight to finish.
+ * 
+ * @param spi Pointer to the SPI structure.
+ */
+void sunxi_spi_transfer_wait(sunxi_spi_t *spi);
+
 #ifdef __cplusplus
 }
 #endif// __cplusplus
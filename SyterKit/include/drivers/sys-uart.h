@@ -98,6 +98,8 @@ typedef struct {
 
 #define SERIAL_DEFAULT_PARENT_CLK (24000000)
 
+#define SERIAL_TX_FIFO_SIZE 64
+
 /**
  * Initialize the Sunxi serial interface with the specified configuration.
  *
@@ -129,6 +131,42 @@ int sunxi_serial_tstc(void *arg);
  */
 char sunxi_serial_getc(void *arg);
 
+/**
+ * Load the transmit FIFO without waiting.
+ *
+ * Characters are only written when the FIFO is empty, then up to
+ * SERIAL_TX_FIFO_SIZE of them at once.
+ *
+ * @param uart Pointer to the Sunxi serial interface structure.
+ * @param buf The characters to send.
+ * @param len The number of characters.
+ * @return The number of characters written, 0 while the FIFO is busy.
+ */
+uint32_t sunxi_serial_write_nowait(sunxi_serial_t *uart, const char *buf, uint32_t len);
+
+/**
+ * Wait until the transmit FIFO and shift register are empty.
+ *
+ * @param uart Pointer to the Sunxi serial interface structure.
+ */
+void sunxi_serial_flush(sunxi_serial_t *uart);
+
+/**
+ * Enable or disable the transmit FIFO empty interrupt.
+ *
+ * @param uart Pointer to the Sunxi serial interface structure.
+ * @param enable True to enable the interrupt.
+ */
+void sunxi_serial_tx_irq(sunxi_serial_t *uart, bool enable);
+
+/**
+ * Acknowledge a pending interrupt.
+ *
+ * @param uart Pointer to the Sunxi serial interface structure.
+ * @return The interrupt ID from the IIR register.
+ */
+uint32_t sunxi_serial_irq_ack(sunxi_serial_t *uart);
+
 #ifdef __cplusplus
 }
 #endif// __cplusplus
@@ -0,0 +1,133 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+
+#ifndef __FIT_H__
+#define __FIT_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <types.h>
+
+#include <sha256.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif// __cplusplus
+
+#define FIT_MAX_COMPONENTS 8
+
+/* Compression of a component */
+#define FIT_COMP_NONE 0
+#define FIT_COMP_LZ4 1
+
+/* Hash algorithm of a component */
+#define FIT_HASH_NONE 0
+#define FIT_HASH_CRC32 1
+#define FIT_HASH_SHA256 2
+
+/**
+ * @brief One image of the selected FIT configuration.
+ */
+typedef struct {
+	const char *name;	/**< Image node name */
+	const char *type;	/**< Image type, e.g. "kernel", "flat_dt" or "firmware" */
+	const char *arch;	/**< Architecture, e.g. "arm", "riscv" or "xtensa", NULL if not set */
+	const uint8_t *data; /**< Data in the FIT blob */
+	uint32_t size;		 /**< Data size */
+	uint8_t comp;		 /**< FIT_COMP_* */
+	bool has_load;		 /**< The image has a load address */
+	uint32_t load;		 /**< Load address */
+	bool has_entry;		 /**< The image has an entry point */
+	uint32_t entry;		 /**< Entry point */
+	uint8_t hash_algo;	 /**< FIT_HASH_* of the first supported hash node */
+	const uint8_t *hash; /**< Expected hash value */
+	sha256_ctx_t sha;	 /**< SHA-256 state while verifying */
+	uint8_t *dest;		 /**< Location after fit_place(), data itself if not moved */
+	uint32_t dest_size;	 /**< Size after fit_place() */
+} fit_component_t;
+
+/**
+ * @brief The selected configuration of a FIT image.
+ */
+typedef struct {
+	const void *fit;						/**< FIT blob */
+	uint32_t size;							/**< Bytes of the FIT blob in memory */
+	const char *config;						/**< Configuration name, NULL without configurations */
+	int count;								/**< Number of components */
+	fit_component_t comp[FIT_MAX_COMPONENTS]; /**< Components */
+} fit_image_t;
+
+/**
+ * Check whether a buffer holds a FIT image.
+ *
+ * @param fit The buffer.
+ * @return 0 if it is a FIT image, -1 otherwise.
+ */
+int fit_check_header(const void *fit);
+
+/**
+ * Get the size of a FIT image including external data.
+ *
+ * @param fit A valid FIT image.
+ * @return The number of bytes to load.
+ */
+uint32_t fit_total_size(const void *fit);
+
+/**
+ * Collect the images of a FIT configuration.
+ *
+ * The kernel, fdt, ramdisk, firmware and loadables of the configuration
+ * are collected. Embedded data and external data (data-offset or
+ * data-position) are both supported. Without a /configurations node
+ * every image is collected. External data must lie within the loaded
+ * bytes.
+ *
+ * @param fit The FIT image.
+ * @param size The number of bytes of the FIT image in memory.
+ * @param config The configuration name, NULL for the default one.
+ * @param img Returns the components.
+ * @return 0 on success, -1 on a malformed image.
+ */
+int fit_parse(const void *fit, uint32_t size, const char *config, fit_image_t *img);
+
+/**
+ * Verify the hash of every component.
+ *
+ * SHA-256 hashing is split between CPU0 and CPU1 by size when CPU1 runs
+ * the SMP work queue, CRC32 runs on CPU0. Components without a supported
+ * hash fail the check.
+ *
+ * @param img The components.
+ * @return 0 if every hash matches, -1 otherwise.
+ */
+int fit_verify(fit_image_t *img);
+
+/**
+ * Move a component to its load address.
+ *
+ * LZ4 compressed components are decompressed to their load address,
+ * components without a load address stay in the FIT blob. A load address
+ * that would overwrite the blob is rejected, the other components are
+ * still read from it.
+ *
+ * @param img The components.
+ * @param c The component.
+ * @return 0 on success, -1 otherwise.
+ */
+int fit_place(fit_image_t *img, fit_component_t *c);
+
+/**
+ * Find a component by image type.
+ *
+ * @param img The components.
+ * @param type The image type.
+ * @param index Which one of the components of that type.
+ * @return The component, or NULL if there is none.
+ */
+fit_component_t *fit_find(fit_image_t *img, const char *type, int index);
+
+#ifdef __cplusplus
+}
+#endif// __cplusplus
+
+#endif// __FIT_H__
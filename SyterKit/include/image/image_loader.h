@@ -10,6 +10,10 @@
 
 #define LINUX_ZIMAGE_MAGIC 0x016f2818
 
+/* Uncompressed arm32 Image, placed at TEXT_OFFSET above a 16MiB aligned base */
+#define LINUX_IMAGE_TEXT_OFFSET 0x8000
+#define LINUX_IMAGE_PHYS_ALIGN 0x1000000
+
 /* Linux zImage Header */
 typedef struct {
 	uint32_t code[9];
@@ -20,8 +24,33 @@ typedef struct {
 
 int zImage_loader(uint8_t *addr, uint32_t *entry);
 
+/**
+ * Check an uncompressed arm32 Image and return its entry point.
+ *
+ * The Image is entered directly, skipping the zImage decompressor, with the
+ * same handoff: MMU and caches off, r0 = 0, r1 = ~0 and r2 = DTB address.
+ * The Image has no magic, so anything carrying a zImage, uImage, FIT or
+ * arm64 Image header is rejected. Callers should still probe the formats
+ * with a header first.
+ *
+ * @param addr The load address, must be at LINUX_IMAGE_TEXT_OFFSET above a LINUX_IMAGE_PHYS_ALIGN base.
+ * @param entry Returns the entry point.
+ * @return 0 on success, -1 if addr does not hold an Image at a valid address.
+ */
+int Image_loader(uint8_t *addr, uint32_t *entry);
+
 int bImage_loader(uint8_t *addr, uint32_t *entry);
 
+/**
+ * Verify a single or multi-file uImage and return the kernel entry point.
+ *
+ * See uImage_load() for the details, use it directly to get the ramdisk
+ * and device tree of a multi-file image.
+ *
+ * @param addr The address the uImage was loaded to.
+ * @param entry Returns the entry point.
+ * @return 0 on success, -1 if addr holds no valid uImage.
+ */
 int uImage_loader(uint8_t *addr, uint32_t *entry);
 
 #endif// __IMAGE_LOADER_H__
\ No newline at end of file
@@ -0,0 +1,102 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+
+#ifndef __LZ4_H__
+#define __LZ4_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif// __cplusplus
+
+#define LZ4_FRAME_MAGIC 0x184d2204
+#define LZ4_LEGACY_MAGIC 0x184c2102 /* lz4 -l, used by the kernel build */
+
+/*
+ * Largest compressed block of the legacy format. A block size above it, or
+ * equal to the bytes decoded so far, is the size appended by the kernel build
+ * and ends the stream.
+ */
+#define LZ4_LEGACY_BLOCK_BOUND (8 * 1024 * 1024 + 8 * 1024 * 1024 / 255 + 16)
+
+/**
+ * @brief Streaming LZ4 decoder state.
+ *
+ * The output buffer doubles as the match history, so the decoder keeps no
+ * window and the input can be fed in chunks of any size.
+ */
+typedef struct {
+	uint8_t state;			 /**< Decoder state */
+	bool legacy;			 /**< Legacy format stream */
+	uint8_t flags;			 /**< Frame descriptor FLG byte */
+	uint8_t hdr[16];		 /**< Header bytes collected across chunks */
+	uint32_t have;			 /**< Bytes collected in hdr */
+	uint32_t need;			 /**< Bytes to collect in hdr */
+	uint32_t block_left;	 /**< Input bytes left in the current block */
+	uint32_t lit_left;		 /**< Literal bytes left in the current sequence */
+	uint32_t match_len;		 /**< Match length of the current sequence */
+	uint64_t content_size;	 /**< Decompressed size from the frame header, 0 if unknown */
+	uint32_t in_size;		 /**< Input bytes consumed, up to the end of the stream */
+	uint8_t *out;			 /**< Next output byte */
+	uint8_t *out_start;		 /**< Start of the output buffer */
+	uint8_t *out_end;		 /**< End of the output buffer */
+} lz4_stream_t;
+
+/**
+ * @brief Check whether a buffer starts with an LZ4 frame or legacy stream.
+ *
+ * @param buf At least 4 bytes of the payload.
+ * @return true if the payload is LZ4 compressed.
+ */
+bool lz4_is_compressed(const void *buf);
+
+/**
+ * @brief Start decoding a stream to its final address.
+ *
+ * @param s The decoder state.
+ * @param dst The output buffer.
+ * @param dst_size Size of the output buffer.
+ */
+void lz4_stream_init(lz4_stream_t *s, void *dst, uint32_t dst_size);
+
+/**
+ * @brief Decode the next chunk of the compressed stream.
+ *
+ * @param s The decoder state.
+ * @param src The chunk.
+ * @param len Length of the chunk.
+ * Input past the end of the frame is left alone, in_size tells how much
+ * of the input belonged to the stream.
+ *
+ * @return 1 when the end of the frame is reached, 0 if more input is needed, -1 on corrupt input.
+ */
+int lz4_stream_feed(lz4_stream_t *s, const void *src, uint32_t len);
+
+/**
+ * @brief Check that the input ended on a stream boundary.
+ *
+ * Legacy streams have no end mark and end with the input.
+ *
+ * @param s The decoder state.
+ * @return 0 if the stream is complete, -1 if it is truncated.
+ */
+int lz4_stream_end(lz4_stream_t *s);
+
+/**
+ * @brief Get the number of bytes decoded so far.
+ *
+ * @param s The decoder state.
+ * @return The decoded size.
+ */
+static inline uint32_t lz4_stream_size(lz4_stream_t *s) {
+	return s->out - s->out_start;
+}
+
+#ifdef __cplusplus
+}
+#endif// __cplusplus
+
+#endif// __LZ4_H__
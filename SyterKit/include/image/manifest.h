@@ -0,0 +1,73 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+
+#ifndef __MANIFEST_H__
+#define __MANIFEST_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <types.h>
+
+#include <sha256.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif// __cplusplus
+
+#define MANIFEST_MAX_ENTRIES 8
+#define MANIFEST_NAME_LEN 64
+
+/**
+ * @brief Expected digest of one image.
+ */
+typedef struct {
+	char name[MANIFEST_NAME_LEN];		/**< Image name as listed in the manifest */
+	uint8_t digest[SHA256_DIGEST_SIZE]; /**< Expected SHA-256 digest */
+} manifest_entry_t;
+
+/**
+ * @brief Image digests read from a manifest.
+ */
+typedef struct {
+	int count;								/**< Number of valid entries */
+	manifest_entry_t entry[MANIFEST_MAX_ENTRIES]; /**< Manifest entries */
+} manifest_t;
+
+/**
+ * Parse a manifest in sha256sum format.
+ *
+ * Each line holds 64 hex digits, white space, an optional '*' and the image
+ * name. Empty lines and lines starting with '#' are skipped, parsing stops
+ * at the first NUL or 0xff byte, so a manifest can be read from erased flash.
+ *
+ * @param m The manifest to fill.
+ * @param text The manifest text.
+ * @param len The length of the text.
+ * @return The number of entries, or -1 if a line is malformed or there is none.
+ */
+int manifest_parse(manifest_t *m, const char *text, uint32_t len);
+
+/**
+ * Find the entry of an image.
+ *
+ * @param m The manifest.
+ * @param name The image name, a leading "./" or "/" is ignored on both sides.
+ * @return The entry, or NULL if the image is not listed.
+ */
+const manifest_entry_t *manifest_find(const manifest_t *m, const char *name);
+
+/**
+ * Check the digest of an image against the manifest.
+ *
+ * @param m The manifest.
+ * @param name The image name.
+ * @param digest The computed digest.
+ * @return 0 if the image is listed with this digest, -1 otherwise.
+ */
+int manifest_verify(const manifest_t *m, const char *name, const uint8_t *digest);
+
+#ifdef __cplusplus
+}
+#endif// __cplusplus
+
+#endif// __MANIFEST_H__
@@ -0,0 +1,108 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+
+#ifndef __UIMAGE_H__
+#define __UIMAGE_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif// __cplusplus
+
+#define UIMAGE_MAGIC 0x27051956
+#define UIMAGE_NAME_LEN 32
+
+/* Operating system */
+#define UIMAGE_OS_LINUX 5
+
+/* CPU architecture */
+#define UIMAGE_ARCH_ARM 2
+#define UIMAGE_ARCH_ARM64 22
+#define UIMAGE_ARCH_RISCV 26
+
+/* Image type */
+#define UIMAGE_TYPE_KERNEL 2
+#define UIMAGE_TYPE_RAMDISK 3
+#define UIMAGE_TYPE_MULTI 4
+#define UIMAGE_TYPE_FLATDT 8
+#define UIMAGE_TYPE_KERNEL_NOLOAD 14
+
+/* Compression */
+#define UIMAGE_COMP_NONE 0
+#define UIMAGE_COMP_LZ4 5
+
+/**
+ * @brief Legacy uImage header, all fields are big endian.
+ */
+typedef struct {
+	uint32_t ih_magic;				   /**< Image header magic number */
+	uint32_t ih_hcrc;				   /**< Image header CRC checksum */
+	uint32_t ih_time;				   /**< Image creation timestamp */
+	uint32_t ih_size;				   /**< Image data size */
+	uint32_t ih_load;				   /**< Data load address */
+	uint32_t ih_ep;					   /**< Entry point address */
+	uint32_t ih_dcrc;				   /**< Image data CRC checksum */
+	uint8_t ih_os;					   /**< Operating system */
+	uint8_t ih_arch;				   /**< CPU architecture */
+	uint8_t ih_type;				   /**< Image type */
+	uint8_t ih_comp;				   /**< Compression type */
+	uint8_t ih_name[UIMAGE_NAME_LEN]; /**< Image name */
+} uimage_header_t;
+
+/**
+ * @brief Components of a loaded uImage.
+ */
+typedef struct {
+	uint32_t entry;			/**< Kernel entry point */
+	uint8_t *kernel;		/**< Kernel at its run address */
+	uint32_t kernel_size;	/**< Kernel size after decompression */
+	uint8_t *ramdisk;		/**< Ramdisk of a multi-file image, NULL if none */
+	uint32_t ramdisk_size;	/**< Ramdisk size */
+	uint8_t *fdt;			/**< Device tree of a multi-file image, NULL if none */
+	uint32_t fdt_size;		/**< Device tree size */
+	char name[UIMAGE_NAME_LEN + 1]; /**< Image name */
+} uimage_info_t;
+
+/**
+ * Check the magic and header CRC of a uImage.
+ *
+ * Lets a loader validate the header from the first block and learn the
+ * total size before reading the rest.
+ *
+ * @param hdr The header.
+ * @return 0 if the header is valid, -1 otherwise.
+ */
+int uImage_check_header(const uimage_header_t *hdr);
+
+/**
+ * Get the size of a uImage, header included.
+ *
+ * @param hdr A valid header.
+ * @return The number of bytes to load.
+ */
+uint32_t uImage_size(const uimage_header_t *hdr);
+
+/**
+ * Verify a uImage in memory and move its kernel to the load address.
+ *
+ * Single-file kernel images and multi-file images holding a kernel, an
+ * optional ramdisk and an optional device tree are supported. The kernel
+ * is copied or LZ4 decompressed to ih_load unless it is a KERNEL_NOLOAD
+ * image or already in place. The ramdisk and device tree stay where they
+ * were loaded.
+ *
+ * @param addr The address the uImage was loaded to.
+ * @param info Returns the entry point and components.
+ * @param check_data Verify the data CRC, pass false when it was checked during load.
+ * @return 0 on success, -1 on a bad or unsupported image.
+ */
+int uImage_load(uint8_t *addr, uimage_info_t *info, bool check_data);
+
+#ifdef __cplusplus
+}
+#endif// __cplusplus
+
+#endif// __UIMAGE_H__
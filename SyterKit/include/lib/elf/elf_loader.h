@@ -24,6 +24,14 @@ typedef struct vaddr_map {
 	uint32_t range_size;
 } vaddr_map_t;
 
+/**
+ * @brief Read callback used by the streaming ELF loaders.
+ *
+ * Reads 'len' bytes at file offset 'offset' of the ELF image into 'buf'.
+ * Returns 0 if successful, -1 otherwise.
+ */
+typedef int (*elf_read_t)(void *ctx, uint64_t offset, void *buf, uint32_t len);
+
 /**
  * Extracts the entry address from an ELF32 image loaded at 'base'.
  *
@@ -49,6 +57,21 @@ int load_elf32_image(phys_addr_t img_addr);
  */
 int load_elf32_image_remap(phys_addr_t img_addr, vaddr_map_t *map);
 
+/**
+ * Loads an ELF32 image through a read callback, with remap va to pa.
+ *
+ * Only the headers are read first, then the file bytes of each PT_LOAD
+ * segment are read straight to their remapped destination and the rest
+ * of the segment is zero-filled. No staging copy of the image is needed.
+ *
+ * @param read The read callback.
+ * @param ctx The context passed to the read callback.
+ * @param map The address mapping table.
+ * @param entry Optional pointer to store the entry address.
+ * @return 0 if successful, -1 otherwise.
+ */
+int load_elf32_stream_remap(elf_read_t read, void *ctx, vaddr_map_t *map, phys_addr_t *entry);
+
 /**
  * Extracts the entry address from an ELF64 image loaded at 'base'.
  *
@@ -65,6 +88,16 @@ phys_addr_t elf64_get_entry_addr(phys_addr_t base);
  */
 int load_elf64_image(phys_addr_t img_addr);
 
+/**
+ * Loads an ELF64 image through a read callback.
+ *
+ * @param read The read callback.
+ * @param ctx The context passed to the read callback.
+ * @param entry Optional pointer to store the entry address.
+ * @return 0 if successful, -1 otherwise.
+ */
+int load_elf64_stream(elf_read_t read, void *ctx, phys_addr_t *entry);
+
 #ifdef __cplusplus
 }
 #endif// __cplusplus
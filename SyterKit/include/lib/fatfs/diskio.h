@@ -21,6 +21,14 @@ typedef enum {
 	RES_PARERR	/* 4: Invalid Parameter */
 } DRESULT;
 
+/* Sector cache statistics */
+typedef struct {
+	DWORD hits;	  /* Single sector reads served from the cache */
+	DWORD misses; /* Single sector reads loaded into the cache */
+	DWORD bypass; /* Multi-sector reads sent straight to the media */
+	DWORD blocks; /* Number of cache blocks, 0 when cache is disabled */
+} disk_cache_stat_t;
+
 /*---------------------------------------*/
 /* Prototypes for disk control functions */
 
@@ -29,6 +37,8 @@ DSTATUS disk_status(BYTE pdrv);
 DRESULT disk_read(BYTE pdrv, BYTE *buff, LBA_t sector, UINT count);
 DRESULT disk_write(BYTE pdrv, const BYTE *buff, LBA_t sector, UINT count);
 DRESULT disk_ioctl(BYTE pdrv, BYTE cmd, void *buff);
+void disk_cache_get_stat(disk_cache_stat_t *stat);
+void disk_cache_reset_stat(void);
 
 /* Disk Status Bits (DSTATUS) */
 
@@ -0,0 +1,117 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+
+#ifndef __FATFS_LOADER_H__
+#define __FATFS_LOADER_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <types.h>
+
+#include "elf_loader.h"
+#include "ff.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif// __cplusplus
+
+/* Number of DWORDs in the cluster link map, holds (FATFS_LINKMAP_SIZE - 2) / 2 fragments */
+#define FATFS_LINKMAP_SIZE 130
+
+/* Maximum number of sector extents a single file is resolved into */
+#define FATFS_MAX_EXTENTS ((FATFS_LINKMAP_SIZE - 2) / 2)
+
+/**
+ * @brief A run of physically contiguous sectors holding file data.
+ */
+typedef struct {
+	LBA_t sector;	/**< First sector of the extent */
+	uint32_t count; /**< Number of sectors in the extent */
+} fatfs_extent_t;
+
+/* Maximum number of sector reads queued by a single batch load */
+#define FATFS_BATCH_MAX_READS 256
+
+/**
+ * @brief One file of a batch load request.
+ */
+typedef struct {
+	const char *filename; /**< Name of the file to load */
+	void *dest;			  /**< Destination address */
+	bool optional;		  /**< Missing file is not an error */
+	uint32_t size;		  /**< Number of bytes loaded (output) */
+	int ret;			  /**< 0 if loaded, -1 if missing or failed (output) */
+} fatfs_load_entry_t;
+
+/**
+ * Resolve an opened file into a list of contiguous sector extents.
+ *
+ * The cluster chain is walked once through the FatFs fast seek link map,
+ * and adjacent fragments are merged. The extents cover every sector that
+ * holds file data, including a partially used last sector.
+ *
+ * @param fp The opened file object.
+ * @param extents The array to store the extents.
+ * @param max_extents The number of entries in the extents array.
+ * @return The number of extents, or -1 if the file is too fragmented or on error.
+ */
+int fatfs_file_extents(FIL *fp, fatfs_extent_t *extents, uint32_t max_extents);
+
+/**
+ * Load a whole file from the mounted FatFs volume into memory.
+ *
+ * Each extent of the file is read with a single disk_read() straight into
+ * the destination, falling back to chunked f_read() for files that are too
+ * fragmented for the link map.
+ *
+ * @param filename The name of the file to load.
+ * @param dest The destination address.
+ * @param size Optional pointer to store the number of bytes loaded.
+ * @return 0 if successful, -1 otherwise.
+ */
+int fatfs_load_file(const char *filename, void *dest, uint32_t *size);
+
+/**
+ * Load a set of files from the mounted FatFs volume in one pass.
+ *
+ * The extents of every file are resolved first, then all reads are sorted
+ * by LBA and issued in disk order. Reads that are contiguous both on disk
+ * and in memory are coalesced into a single disk_read().
+ *
+ * @param entries The array of files to load, results are stored back into it.
+ * @param n_entries The number of entries.
+ * @return 0 if all non-optional files are loaded, -1 otherwise.
+ */
+int fatfs_load_batch(fatfs_load_entry_t *entries, uint32_t n_entries);
+
+/**
+ * Read the entry address from the header of an ELF32 or ELF64 file.
+ *
+ * Lets callers set up the remote core before its segments are loaded.
+ *
+ * @param filename The name of the ELF file.
+ * @param entry Pointer to store the entry address.
+ * @return 0 if successful, -1 otherwise.
+ */
+int fatfs_elf_get_entry(const char *filename, phys_addr_t *entry);
+
+/**
+ * Load an ELF32 or ELF64 file straight from the FatFs volume.
+ *
+ * Headers are read first, then the file bytes of each PT_LOAD segment are
+ * read directly to their (remapped) load address and BSS is zero-filled.
+ * Sector aligned segment data is read extent by extent with disk_read(),
+ * so no staging copy of the whole image is made.
+ *
+ * @param filename The name of the ELF file.
+ * @param map Optional va to pa mapping table, only used for ELF32.
+ * @param entry Optional pointer to store the entry address.
+ * @return 0 if successful, -1 otherwise.
+ */
+int fatfs_load_elf(const char *filename, vaddr_map_t *map, phys_addr_t *entry);
+
+#ifdef __cplusplus
+}
+#endif// __cplusplus
+
+#endif// __FATFS_LOADER_H__
@@ -38,6 +38,57 @@ extern "C" {
 
 #endif// LOG_LEVEL_DEFAULT
 
+#ifdef CONFIG_LOG_BINARY
+
+/*
+ * Deferred binary logging: trace and debug calls store the format string
+ * address and their arguments as raw words, tools/logdecode.py formats them
+ * on the host from the ELF. Integers and pointers take one word (64-bit
+ * values keep the low word), floating point arguments are stored as float.
+ * At most 12 arguments are supported.
+ */
+#ifndef CONFIG_LOG_BINARY_RING_WORDS
+#define CONFIG_LOG_BINARY_RING_WORDS 1024
+#endif
+
+#define LOG_BINARY_MAGIC 0xb10c0000
+#define LOG_BINARY_MAGIC_MASK 0xffff0000
+
+#define LOG_NARGS(...) LOG_NARGS_(0, ##__VA_ARGS__, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define LOG_NARGS_(_0, _1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, n, ...) n
+
+/* Every _Generic branch must compile for any argument type, hence the inner selection */
+#define LOG_BINARY_FP(x) _Generic((x), float: (x), double: (x), default: 0.0)
+#define LOG_BINARY_WORD(x) _Generic((x), float: log_binary_float(LOG_BINARY_FP(x)), double: log_binary_float(LOG_BINARY_FP(x)), default: (uint32_t) (uintptr_t) (x))
+
+#define LOG_BINARY_ARGS_0()
+#define LOG_BINARY_ARGS_1(a) LOG_BINARY_WORD(a)
+#define LOG_BINARY_ARGS_2(a, ...) LOG_BINARY_WORD(a), LOG_BINARY_ARGS_1(__VA_ARGS__)
+#define LOG_BINARY_ARGS_3(a, ...) LOG_BINARY_WORD(a), LOG_BINARY_ARGS_2(__VA_ARGS__)
+#define LOG_BINARY_ARGS_4(a, ...) LOG_BINARY_WORD(a), LOG_BINARY_ARGS_3(__VA_ARGS__)
+#define LOG_BINARY_ARGS_5(a, ...) LOG_BINARY_WORD(a), LOG_BINARY_ARGS_4(__VA_ARGS__)
+#define LOG_BINARY_ARGS_6(a, ...) LOG_BINARY_WORD(a), LOG_BINARY_ARGS_5(__VA_ARGS__)
+#define LOG_BINARY_ARGS_7(a, ...) LOG_BINARY_WORD(a), LOG_BINARY_ARGS_6(__VA_ARGS__)
+#define LOG_BINARY_ARGS_8(a, ...) LOG_BINARY_WORD(a), LOG_BINARY_ARGS_7(__VA_ARGS__)
+#define LOG_BINARY_ARGS_9(a, ...) LOG_BINARY_WORD(a), LOG_BINARY_ARGS_8(__VA_ARGS__)
+#define LOG_BINARY_ARGS_10(a, ...) LOG_BINARY_WORD(a), LOG_BINARY_ARGS_9(__VA_ARGS__)
+#define LOG_BINARY_ARGS_11(a, ...) LOG_BINARY_WORD(a), LOG_BINARY_ARGS_10(__VA_ARGS__)
+#define LOG_BINARY_ARGS_12(a, ...) LOG_BINARY_WORD(a), LOG_BINARY_ARGS_11(__VA_ARGS__)
+#define LOG_BINARY_CAT(a, b) a##b
+#define LOG_BINARY_ARGS(n, ...) LOG_BINARY_CAT(LOG_BINARY_ARGS_, n)(__VA_ARGS__)
+
+#define printk_binary(level, fmt, ...)                                                                \
+	do {                                                                                              \
+		const uint32_t __log_args[] = {LOG_BINARY_ARGS(LOG_NARGS(__VA_ARGS__), ##__VA_ARGS__)};     \
+		log_binary(level, fmt, __log_args, LOG_NARGS(__VA_ARGS__));                                 \
+	} while (0)
+
+/* Binary records are cheap enough to keep trace and debug on whatever the log level */
+#define printk_trace(fmt, ...) printk_binary(LOG_LEVEL_TRACE, fmt, ##__VA_ARGS__)
+#define printk_debug(fmt, ...) printk_binary(LOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__)
+
+#else
+
 #if LOG_LEVEL_DEFAULT >= LOG_LEVEL_TRACE
 #define printk_trace(fmt, ...) printk(LOG_LEVEL_TRACE, fmt, ##__VA_ARGS__)
 #else
@@ -50,6 +101,8 @@ extern "C" {
 #define printk_debug(fmt, ...) ((void) 0)
 #endif
 
+#endif// CONFIG_LOG_BINARY
+
 #if LOG_LEVEL_DEFAULT >= LOG_LEVEL_INFO
 #define printk_info(fmt, ...) printk(LOG_LEVEL_INFO, fmt, ##__VA_ARGS__)
 #else
@@ -126,6 +179,122 @@ int printf(const char *fmt, ...);
  */
 void dump_hex(uint32_t start_addr, uint32_t count);
 
+#ifdef CONFIG_LOG_BINARY
+
+/**
+ * @brief Append a binary log record
+ *
+ * The record is a header word (LOG_BINARY_MAGIC, level and argument count),
+ * the time in microseconds, the format string address and the arguments.
+ * The ring keeps the latest CONFIG_LOG_BINARY_RING_WORDS words.
+ *
+ * @param level Log level of the record.
+ * @param fmt Format string, only its address is stored.
+ * @param args Argument words.
+ * @param nargs Number of argument words.
+ */
+void log_binary(int level, const char *fmt, const uint32_t *args, uint32_t nargs);
+
+/**
+ * @brief Store a floating point argument as float bits
+ *
+ * @param v The value.
+ * @return The IEEE 754 single precision bits of the value.
+ */
+uint32_t log_binary_float(double v);
+
+/**
+ * @brief Print the binary ring, oldest word first, for tools/logdecode.py
+ */
+void log_binary_dump(void);
+
+#endif// CONFIG_LOG_BINARY
+
+#ifdef CONFIG_LOG_RAMOOPS
+
+/**
+ * @brief Keep a copy of the printk output in a Linux ramoops console zone
+ *
+ * The region gets a pstore persistent_ram_zone header and every printk
+ * character from now on, so Linux shows the boot log as
+ * /sys/fs/pstore/console-ramoops-0. Its previous content is replaced.
+ *
+ * @param base Physical address of the region in DRAM, word aligned.
+ * @param size Size of the region in bytes.
+ * @return 0 on success, -1 on a bad region.
+ */
+int log_ramoops_init(uint32_t base, uint32_t size);
+
+/**
+ * @brief Append a character to the ramoops console zone
+ *
+ * @param c The character.
+ */
+void log_ramoops_putc(char c);
+
+/**
+ * @brief Describe the ramoops region in the device tree
+ *
+ * Adds a "ramoops" node under /reserved-memory whose console zone covers
+ * the whole region, and writes the zone back from the data cache.
+ *
+ * @param fdt The device tree blob.
+ * @return 0 on success, -1 otherwise.
+ */
+int log_ramoops_fdt_export(void *fdt);
+
+#endif// CONFIG_LOG_RAMOOPS
+
+#ifdef CONFIG_LOG_ASYNC
+
+/**
+ * @brief Push pending log output to the UART without waiting
+ *
+ * printk() only formats into the log ring. Without the TX interrupt the
+ * ring is drained here, one UART FIFO load per call.
+ */
+void log_poll(void);
+
+/**
+ * @brief Write out all pending log output and wait for the UART to go idle
+ *
+ * @note Call before anything that stops the drain: jumping to the kernel,
+ *       masking interrupts for good or resetting the UART.
+ */
+void log_flush(void);
+
+/**
+ * @brief Drain the log ring from the UART TX FIFO empty interrupt
+ *
+ * @return 0 on success, -1 if the chip has no interrupt for the debug UART.
+ */
+int log_irq_init(void);
+
+/**
+ * @brief Flush the log ring and go back to polled draining
+ */
+void log_irq_exit(void);
+
+/**
+ * @brief Pass the output still held in the log ring to a callback
+ *
+ * The ring keeps the last CONFIG_LOG_RING_SIZE characters after they are
+ * sent, without the carriage returns added for the UART.
+ *
+ * @param putc Called for each character, oldest first.
+ */
+void log_ring_replay(void (*putc)(char c));
+
+#else
+
+static inline void log_poll(void) {
+}
+
+static inline void log_flush(void) {
+}
+
+#endif// CONFIG_LOG_ASYNC
+
 #ifdef __cplusplus
 }
 #endif// __cplusplus
@@ -0,0 +1,113 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+
+#ifndef __PART_H__
+#define __PART_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif// __cplusplus
+
+#define PART_MAX_ENTRIES 16
+#define PART_NAME_LEN 36
+#define PART_SECTOR_SIZE 512
+
+#define GPT_HEADER_SIGNATURE "EFI PART"
+#define MBR_SIGNATURE 0xAA55
+#define MBR_TYPE_GPT_PROTECTIVE 0xEE
+
+/* A type GUID in on-disk (mixed endian) byte order, written as in 01234567-89ab-cdef-0123-456789abcdef */
+#define PART_GUID(a, b, c, d0, d1, d2, d3, d4, d5, d6, d7) \
+	{(a) & 0xff, ((a) >> 8) & 0xff, ((a) >> 16) & 0xff, ((a) >> 24) & 0xff, (b) & 0xff, ((b) >> 8) & 0xff, (c) & 0xff, ((c) >> 8) & 0xff, (d0), (d1), (d2), (d3), (d4), (d5), (d6), (d7)}
+
+/**
+ * @brief Block read callback, returns the number of blocks read.
+ */
+typedef uint32_t (*part_blk_read_t)(void *ctx, uint8_t *buf, uint64_t lba, uint32_t count);
+
+/**
+ * @brief One partition found in the GPT or MBR.
+ */
+typedef struct {
+	uint64_t start_lba;			  /**< First LBA of the partition */
+	uint64_t num_lba;			  /**< Number of LBAs in the partition */
+	uint8_t type_guid[16];		  /**< GPT partition type GUID, zero for MBR */
+	uint8_t mbr_type;			  /**< MBR partition type, zero for GPT */
+	char name[PART_NAME_LEN + 1]; /**< GPT partition label (ASCII), empty for MBR */
+} part_entry_t;
+
+/**
+ * @brief Partition table of a block device.
+ */
+typedef struct {
+	part_blk_read_t read;			   /**< Block read callback */
+	void *ctx;						   /**< Context passed to the read callback */
+	bool is_gpt;					   /**< Table was read from a GPT */
+	int count;						   /**< Number of valid entries */
+	part_entry_t part[PART_MAX_ENTRIES]; /**< Partition entries */
+} part_table_t;
+
+/**
+ * Scan the GPT of a block device, falling back to the MBR.
+ *
+ * @param table The partition table to fill.
+ * @param read The block read callback.
+ * @param ctx The context passed to the read callback.
+ * @return The number of partitions found, or -1 if no partition table is found.
+ */
+int part_scan(part_table_t *table, part_blk_read_t read, void *ctx);
+
+/**
+ * Find a GPT partition by label.
+ *
+ * @param table The partition table.
+ * @param name The partition label.
+ * @return The partition entry, or NULL if not found.
+ */
+part_entry_t *part_find_by_name(part_table_t *table, const char *name);
+
+/**
+ * Find the first GPT partition of a given type GUID.
+ *
+ * @param table The partition table.
+ * @param guid The type GUID in on-disk (mixed endian) byte order.
+ * @return The partition entry, or NULL if not found.
+ */
+part_entry_t *part_find_by_type(part_table_t *table, const uint8_t *guid);
+
+/**
+ * Find the first MBR partition of a given type.
+ *
+ * @param table The partition table.
+ * @param type The MBR partition type byte.
+ * @return The partition entry, or NULL if not found.
+ */
+part_entry_t *part_find_by_mbr_type(part_table_t *table, uint8_t type);
+
+/**
+ * Read the start of a partition into memory with a single block transfer.
+ *
+ * @param table The partition table.
+ * @param part The partition to read.
+ * @param dest The destination address.
+ * @param size Number of bytes to read, rounded up to whole sectors, 0 for the whole partition.
+ * @return The number of bytes read, or 0 on error.
+ */
+uint32_t part_load(part_table_t *table, part_entry_t *part, void *dest, uint32_t size);
+
+/**
+ * Print the partition table.
+ *
+ * @param table The partition table.
+ */
+void part_dump(part_table_t *table);
+
+#ifdef __cplusplus
+}
+#endif// __cplusplus
+
+#endif// __PART_H__
@@ -0,0 +1,86 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+
+#ifndef __SHA256_H__
+#define __SHA256_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif// __cplusplus
+
+#define SHA256_DIGEST_SIZE 32
+#define SHA256_BLOCK_SIZE 64
+
+/**
+ * @brief Incremental SHA-256 state.
+ */
+typedef struct {
+	uint32_t state[8];				/**< Intermediate hash value */
+	uint64_t count;					/**< Number of bytes hashed so far */
+	uint8_t buf[SHA256_BLOCK_SIZE]; /**< Partial block waiting for more data */
+	int ticket;						/**< Last update queued to CPU1, -1 if none */
+} sha256_ctx_t;
+
+/**
+ * Start a new SHA-256 computation.
+ *
+ * @param ctx The context to initialize.
+ */
+void sha256_init(sha256_ctx_t *ctx);
+
+/**
+ * Hash more data.
+ *
+ * @param ctx The context.
+ * @param data The data to hash.
+ * @param len The number of bytes.
+ */
+void sha256_update(sha256_ctx_t *ctx, const void *data, uint32_t len);
+
+/**
+ * Hash more data on CPU1 while CPU0 carries on.
+ *
+ * Updates of one context run in the order they are queued. The data must
+ * stay untouched until sha256_wait() or sha256_final() returns. Without
+ * CONFIG_CHIP_SMP, or when CPU1 is not running, the data is hashed
+ * before returning.
+ *
+ * @param ctx The context.
+ * @param data The data to hash.
+ * @param len The number of bytes.
+ */
+void sha256_update_async(sha256_ctx_t *ctx, const void *data, uint32_t len);
+
+/**
+ * Wait for the updates of a context queued to CPU1.
+ *
+ * @param ctx The context.
+ */
+void sha256_wait(sha256_ctx_t *ctx);
+
+/**
+ * Finish the computation and store the digest.
+ *
+ * @param ctx The context, waits for queued updates first.
+ * @param digest The SHA256_DIGEST_SIZE byte digest.
+ */
+void sha256_final(sha256_ctx_t *ctx, uint8_t *digest);
+
+/**
+ * Hash a buffer in one go.
+ *
+ * @param data The data to hash.
+ * @param len The number of bytes.
+ * @param digest The SHA256_DIGEST_SIZE byte digest.
+ */
+void sha256(const void *data, uint32_t len, uint8_t *digest);
+
+#ifdef __cplusplus
+}
+#endif// __cplusplus
+
+#endif// __SHA256_H__
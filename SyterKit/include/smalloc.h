@@ -10,15 +10,24 @@
 extern "C" {
 #endif// __cplusplus
 
-struct alloc_struct_t {
-	phys_addr_t address;
-	uint32_t size;
-	uint32_t o_size;
-	struct alloc_struct_t *next;
-};
-
 #define BYTE_ALIGN(x) (((x + 15) / 16) * 16)
 
+/**
+ * Heap usage snapshot filled by smalloc_stats().
+ *
+ * Byte counts of used blocks include their 16 byte headers.
+ */
+typedef struct {
+	uint32_t total;		   /**< Usable heap size in bytes */
+	uint32_t used;		   /**< Bytes held by live allocations */
+	uint32_t peak;		   /**< Highest value reached by used */
+	uint32_t free;		   /**< Payload bytes of all free blocks */
+	uint32_t largest_free; /**< Largest single free block, the biggest request that can succeed */
+	uint32_t free_blocks;  /**< Number of free blocks, a measure of fragmentation */
+	uint32_t allocs;	   /**< Number of live allocations */
+	uint32_t failures;	   /**< Number of requests that could not be served */
+} smalloc_stats_t;
+
 /**
  * Initialize the simple malloc library with the specified heap parameters.
  *
@@ -36,9 +45,21 @@ int32_t smalloc_init(uint32_t p_heap_head, uint32_t n_heap_size);
  */
 void *smalloc(uint32_t num_bytes);
 
+/**
+ * Allocate a block of memory whose address is a multiple of align.
+ *
+ * @param align The alignment in bytes, a power of two.
+ * @param num_bytes The number of bytes to allocate.
+ * @return A pointer to the allocated memory block, or NULL if allocation fails.
+ */
+void *smemalign(uint32_t align, uint32_t num_bytes);
+
 /**
  * Reallocate a block of memory with the specified new size.
  *
+ * The block is resized in place when possible, otherwise the content is
+ * moved to a new block. A NULL pointer allocates, a zero size frees.
+ *
  * @param p The pointer to the memory block to reallocate.
  * @param num_bytes The new size in bytes.
  * @return A pointer to the reallocated memory block, or NULL if reallocation fails.
@@ -52,6 +73,22 @@ void *srealloc(void *p, uint32_t num_bytes);
  */
 void sfree(void *p);
 
+/**
+ * Get the heap usage statistics.
+ *
+ * Walks the whole heap, meant for diagnostics rather than hot paths.
+ *
+ * @param stats Pointer to the structure to fill.
+ */
+void smalloc_stats(smalloc_stats_t *stats);
+
+/**
+ * Check the consistency of the heap block chain and free lists.
+ *
+ * @return 0 if the heap is consistent, -1 otherwise.
+ */
+int smalloc_check(void);
+
 #ifdef __cplusplus
 }
 #endif// __cplusplus
@@ -108,6 +108,56 @@ int load_elf32_image_remap(phys_addr_t img_addr, vaddr_map_t *map) {
 	return 0;
 }
 
+int load_elf32_stream_remap(elf_read_t read, void *ctx, vaddr_map_t *map, phys_addr_t *entry) {
+	Elf32_Ehdr ehdr;
+	Elf32_Phdr phdr;
+	void *dst = NULL;
+
+	if (map == NULL)
+		map = &default_addr_mapping;
+
+	if (read(ctx, 0, &ehdr, sizeof(ehdr))) {
+		printk_error("ELF: read header failed\n");
+		return -1;
+	}
+
+	if (memcmp(ehdr.e_ident, ELFMAG, SELFMAG) || ehdr.e_ident[EI_CLASS] != ELFCLASS32) {
+		printk_error("ELF: not a valid ELF32 image\n");
+		return -1;
+	}
+
+	print_elf32_ehdr(&ehdr);
+
+	if (entry)
+		*entry = ehdr.e_entry;
+
+	/* load elf program segment, one header at a time */
+	for (int i = 0; i < ehdr.e_phnum; ++i) {
+		if (read(ctx, ehdr.e_phoff + i * ehdr.e_phentsize, &phdr, sizeof(phdr))) {
+			printk_error("ELF: read phdr %d failed\n", i);
+			return -1;
+		}
+
+		if (phdr.p_type != PT_LOAD || phdr.p_memsz == 0)
+			continue;
+
+		/* remap addresses */
+		dst = (void *) (phys_addr_t) set_img_va_to_pa((phys_addr_t) phdr.p_paddr, map->range, map->range_size);
+
+		printk_debug("ELF: Loading phdr %i from 0x%x to 0x%x (%i bytes)\n", i, phdr.p_paddr, dst, phdr.p_filesz);
+
+		if (phdr.p_filesz && read(ctx, phdr.p_offset, dst, phdr.p_filesz)) {
+			printk_error("ELF: read segment %d failed\n", i);
+			return -1;
+		}
+
+		if (phdr.p_filesz < phdr.p_memsz)
+			memset((u8 *) dst + phdr.p_filesz, 0x00, phdr.p_memsz - phdr.p_filesz);
+	}
+
+	return 0;
+}
+
 static Elf32_Shdr *elf32_find_segment(phys_addr_t elf_addr, const char *seg_name) {
 	int i = 0;
 	Elf32_Shdr *shdr;
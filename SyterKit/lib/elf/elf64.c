@@ -74,6 +74,50 @@ int load_elf64_image(phys_addr_t img_addr) {
 	return 0;
 }
 
+int load_elf64_stream(elf_read_t read, void *ctx, phys_addr_t *entry) {
+	Elf64_Ehdr ehdr;
+	Elf64_Phdr phdr;
+	void *dst = NULL;
+
+	if (read(ctx, 0, &ehdr, sizeof(ehdr))) {
+		printk_error("ELF: read header failed\n");
+		return -1;
+	}
+
+	if (memcmp(ehdr.e_ident, ELFMAG, SELFMAG) || ehdr.e_ident[EI_CLASS] != ELFCLASS64) {
+		printk_error("ELF: not a valid ELF64 image\n");
+		return -1;
+	}
+
+	print_elf64_ehdr(&ehdr);
+
+	if (entry)
+		*entry = ehdr.e_entry;
+
+	/* load elf program segment, one header at a time */
+	for (int i = 0; i < ehdr.e_phnum; ++i) {
+		if (read(ctx, ehdr.e_phoff + i * ehdr.e_phentsize, &phdr, sizeof(phdr))) {
+			printk_error("ELF: read phdr %d failed\n", i);
+			return -1;
+		}
+
+		if (phdr.p_type != PT_LOAD || phdr.p_memsz == 0)
+			continue;
+
+		dst = (void *) ((phys_addr_t) phdr.p_paddr);
+
+		if (phdr.p_filesz && read(ctx, phdr.p_offset, dst, phdr.p_filesz)) {
+			printk_error("ELF: read segment %d failed\n", i);
+			return -1;
+		}
+
+		if (phdr.p_filesz < phdr.p_memsz)
+			memset((u8 *) dst + phdr.p_filesz, 0x00, phdr.p_memsz - phdr.p_filesz);
+	}
+
+	return 0;
+}
+
 static Elf64_Shdr *elf64_find_segment(phys_addr_t elf_addr, const char *seg_name) {
 	int i = 0;
 	Elf64_Shdr *shdr;
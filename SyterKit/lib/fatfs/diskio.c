@@ -16,31 +16,88 @@
 
 static DSTATUS Stat = STA_NOINIT; /* Disk status */
 
+static disk_cache_stat_t cache_stat;
+
 #ifdef CONFIG_FATFS_CACHE_SIZE
-/* we can consume up to CONFIG_FATFS_CACHE_SIZE of SDRAM starting at CONFIG_FATFS_CACHE_ADDR */
-#define FATFS_CACHE_CHUNK_SIZE (32 * 1024)
-#define FATFS_CACHE_SECTORS (CONFIG_FATFS_CACHE_SIZE / FF_MIN_SS)
-#define FATFS_CACHE_SECTORS_PER_BIT (FATFS_CACHE_CHUNK_SIZE / FF_MIN_SS)
-#define FATFS_CACHE_CHUNKS (FATFS_CACHE_SECTORS / FATFS_CACHE_SECTORS_PER_BIT)
+/*
+ * Small CLOCK block cache for FAT, directory and boot sectors. FatFs reads
+ * that metadata one sector at a time through its window, while file data
+ * comes in multi-sector bursts which bypass the cache and go straight to
+ * the caller's buffer. Single sectors from the data area (FAT32 directories,
+ * but also the partial sectors at the ends of a file read) are cached
+ * without a reference bit, so a one-off read gets no second chance from the
+ * CLOCK hand and cannot outlive the FAT sectors a cluster chain walk keeps
+ * coming back to.
+ * Data lives at CONFIG_FATFS_CACHE_ADDR, tags in SRAM.
+ */
+#ifndef CONFIG_FATFS_CACHE_BLOCKS
+#define CONFIG_FATFS_CACHE_BLOCKS 256
+#endif
+
+#if (CONFIG_FATFS_CACHE_SIZE / FF_MIN_SS) < CONFIG_FATFS_CACHE_BLOCKS
+#define FATFS_CACHE_BLOCKS (CONFIG_FATFS_CACHE_SIZE / FF_MIN_SS)
+#else
+#define FATFS_CACHE_BLOCKS CONFIG_FATFS_CACHE_BLOCKS
+#endif
+
+#define FATFS_CACHE_INVALID ((LBA_t) -1)
 
 static uint8_t *const cache_data = (uint8_t *) CONFIG_FATFS_CACHE_ADDR; /* in CONFIG_FATFS_CACHE_ADDR */
-static uint8_t cache_bitmap[FATFS_CACHE_CHUNKS / 8];					/* in SRAM */
-static BYTE cache_pdrv = -1;
+static LBA_t cache_tag[FATFS_CACHE_BLOCKS];								/* in SRAM */
+static uint8_t cache_ref[FATFS_CACHE_BLOCKS];							/* CLOCK reference bits */
+static uint32_t cache_hand;
 static int current_cache_sdhci_id = -1;
+static LBA_t cache_data_start = FATFS_CACHE_INVALID; /* First sector of the data area */
+
+static void cache_invalidate_all(void) {
+	for (uint32_t i = 0; i < FATFS_CACHE_BLOCKS; i++) {
+		cache_tag[i] = FATFS_CACHE_INVALID;
+		cache_ref[i] = 0;
+	}
+	cache_hand = 0;
+	cache_data_start = FATFS_CACHE_INVALID;
+}
 
-#define CACHE_SECTOR_TO_OFFSET(ss) (((ss) / FATFS_CACHE_SECTORS_PER_BIT) / 8)
-#define CACHE_SECTOR_TO_BIT(ss) (((ss) / FATFS_CACHE_SECTORS_PER_BIT) % 8)
-
-#define CACHE_IS_VALID(ss)                                                           \
-	({                                                                               \
-		__typeof(ss) _ss = (ss);                                                     \
-		cache_bitmap[CACHE_SECTOR_TO_OFFSET(_ss)] & (1 << CACHE_SECTOR_TO_BIT(_ss)); \
-	})
-#define CACHE_SET_VALID(ss)                                                           \
-	do {                                                                              \
-		__typeof(ss) _ss = (ss);                                                      \
-		cache_bitmap[CACHE_SECTOR_TO_OFFSET(_ss)] |= (1 << CACHE_SECTOR_TO_BIT(_ss)); \
-	} while (0)
+/* Learn where the data area starts when a FAT boot sector goes by */
+static void cache_check_boot_sector(const uint8_t *buf, LBA_t sector) {
+	uint32_t rsvd, fats, root_ents, fat_size;
+
+	if (buf[510] != 0x55 || buf[511] != 0xaa || (buf[0] != 0xeb && buf[0] != 0xe9))
+		return;
+	if ((buf[11] | (buf[12] << 8)) != FF_MIN_SS)
+		return;
+
+	rsvd = buf[14] | (buf[15] << 8);
+	fats = buf[16];
+	root_ents = buf[17] | (buf[18] << 8);
+	fat_size = buf[22] | (buf[23] << 8);
+	if (fat_size == 0)
+		fat_size = buf[36] | (buf[37] << 8) | (buf[38] << 16) | ((uint32_t) buf[39] << 24);
+	if (rsvd == 0 || fats == 0 || fats > 2 || fat_size == 0)
+		return;
+
+	cache_data_start = sector + rsvd + fats * fat_size + (root_ents * 32 + FF_MIN_SS - 1) / FF_MIN_SS;
+	printk_debug("FATFS: cache: data area starts at %u\r\n", (uint32_t) cache_data_start);
+}
+
+static int cache_lookup(LBA_t sector) {
+	for (uint32_t i = 0; i < FATFS_CACHE_BLOCKS; i++) {
+		if (cache_tag[i] == sector)
+			return i;
+	}
+	return -1;
+}
+
+/* Pick a victim with the CLOCK algorithm, second chance for referenced blocks */
+static uint32_t cache_evict(void) {
+	while (cache_ref[cache_hand]) {
+		cache_ref[cache_hand] = 0;
+		cache_hand = (cache_hand + 1) % FATFS_CACHE_BLOCKS;
+	}
+	uint32_t victim = cache_hand;
+	cache_hand = (cache_hand + 1) % FATFS_CACHE_BLOCKS;
+	return victim;
+}
 #endif
 
 /*-----------------------------------------------------------------------*/
@@ -87,43 +144,38 @@ DRESULT disk_read(BYTE pdrv,	/* Physical drive nmuber to identify the drive */
 	printk_trace("FATFS: read %u sectors at %u\r\n", count, (uint32_t) sector);
 
 #ifdef CONFIG_FATFS_CACHE_SIZE
-	if (pdrv != cache_pdrv || current_cache_sdhci_id != card0.hci->id) {
-		printk_debug("FATFS: cache: %u bytes in %u chunks\r\n", CONFIG_FATFS_CACHE_SIZE, FATFS_CACHE_CHUNKS);
-		if (cache_pdrv != -1)
-			memset(cache_bitmap, 0, sizeof(cache_bitmap));
-		cache_pdrv = pdrv;
+	if (current_cache_sdhci_id != card0.hci->id) {
+		printk_debug("FATFS: cache: %u blocks at 0x%08x\r\n", FATFS_CACHE_BLOCKS, CONFIG_FATFS_CACHE_ADDR);
+		cache_invalidate_all();
+		current_cache_sdhci_id = card0.hci->id;
 	}
 
-	current_cache_sdhci_id = card0.hci->id;
-
-	while (count) {
-		if (sector >= FATFS_CACHE_SECTORS) {
-			printk_trace("FATFS: beyond cache %u count %u\r\n", (uint32_t) sector, count);
-			/* beyond end of cache, read remaining */
-			if (sdmmc_blk_read(&card0, buff, sector, count) != count) {
-				printk_warning("FATFS: read failed %u count %u\r\n", (uint32_t) sector, count);
-				return RES_ERROR;
-			}
-			return RES_OK;
-		}
+	/* Bulk file data, read straight into the destination */
+	if (count > 1) {
+		cache_stat.bypass++;
+		return (sdmmc_blk_read(&card0, buff, sector, count) == count ? RES_OK : RES_ERROR);
+	}
 
-		if (!CACHE_IS_VALID(sector)) {
-			LBA_t chunk = sector & ~(FATFS_CACHE_SECTORS_PER_BIT - 1);
-			printk_trace("FATFS: cache miss %u, loading %u count %u\r\n", (uint32_t) sector, chunk, FATFS_CACHE_SECTORS_PER_BIT);
-			if (sdmmc_blk_read(&card0, &cache_data[chunk * FF_MIN_SS], chunk, FATFS_CACHE_SECTORS_PER_BIT) != FATFS_CACHE_SECTORS_PER_BIT) {
-				printk_warning("FATFS: read failed %u count %u\r\n", (uint32_t) sector, FATFS_CACHE_SECTORS_PER_BIT);
-				return RES_ERROR;
-			}
-			CACHE_SET_VALID(sector);
-		} else {
-			printk_trace("FATFS: cache hit %u\r\n", (uint32_t) sector);
+	int slot = cache_lookup(sector);
+	if (slot >= 0) {
+		printk_trace("FATFS: cache hit %u\r\n", (uint32_t) sector);
+		cache_stat.hits++;
+		cache_ref[slot] = 1;
+	} else {
+		printk_trace("FATFS: cache miss %u\r\n", (uint32_t) sector);
+		cache_stat.misses++;
+		slot = cache_evict();
+		cache_tag[slot] = FATFS_CACHE_INVALID;
+		if (sdmmc_blk_read(&card0, &cache_data[slot * FF_MIN_SS], sector, 1) != 1) {
+			printk_warning("FATFS: read failed %u count %u\r\n", (uint32_t) sector, 1);
+			return RES_ERROR;
 		}
-		memcpy(buff, &cache_data[sector * FF_MIN_SS], FF_MIN_SS);
-
-		sector++;
-		buff += FF_MIN_SS;
-		count--;
+		cache_tag[slot] = sector;
+		cache_check_boot_sector(&cache_data[slot * FF_MIN_SS], sector);
+		/* Data area sectors earn their reference bit on the second read */
+		cache_ref[slot] = cache_data_start == FATFS_CACHE_INVALID || sector < cache_data_start;
 	}
+	memcpy(buff, &cache_data[slot * FF_MIN_SS], FF_MIN_SS);
 	return RES_OK;
 #else
 	return (sdmmc_blk_read(&card0, buff, sector, count) == count ? RES_OK : RES_ERROR);
@@ -148,11 +200,36 @@ DRESULT disk_write(BYTE pdrv,		 /* Physical drive nmuber to identify the drive *
 
 	printk_trace("FATFS: write %u sectors at %llu\r\n", count, sector);
 
+#ifdef CONFIG_FATFS_CACHE_SIZE
+	for (UINT i = 0; i < count; i++) {
+		int slot = cache_lookup(sector + i);
+		if (slot >= 0)
+			cache_tag[slot] = FATFS_CACHE_INVALID;
+	}
+#endif
+
 	return (sdmmc_blk_write(&card0, buff, sector, count) == count ? RES_OK : RES_ERROR);
 }
 
 #endif
 
+/*-----------------------------------------------------------------------*/
+/* Sector cache statistics                                               */
+/*-----------------------------------------------------------------------*/
+
+void disk_cache_get_stat(disk_cache_stat_t *stat) {
+	*stat = cache_stat;
+#ifdef CONFIG_FATFS_CACHE_SIZE
+	stat->blocks = FATFS_CACHE_BLOCKS;
+#else
+	stat->blocks = 0;
+#endif
+}
+
+void disk_cache_reset_stat(void) {
+	memset(&cache_stat, 0, sizeof(cache_stat));
+}
+
 /*-----------------------------------------------------------------------*/
 /* Miscellaneous Functions                                               */
 /*-----------------------------------------------------------------------*/
@@ -0,0 +1,435 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <types.h>
+
+#include <log.h>
+#include <timer.h>
+
+#include "ff.h"
+
+#include "diskio.h"
+
+#include "elf.h"
+
+#include "fatfs_loader.h"
+
+#define FATFS_LOADER_CHUNK_SIZE 0x20000
+
+/* Kept out of the stack, SRAM stack is only a few KB */
+static DWORD linkmap[FATFS_LINKMAP_SIZE];
+static fatfs_extent_t file_extents[FATFS_MAX_EXTENTS];
+
+typedef struct {
+	LBA_t sector;	/* First sector to read */
+	uint32_t count; /* Number of sectors */
+	BYTE *dest;		/* Destination of the first sector */
+	uint32_t tail;	/* Non-zero: partial sector, only copy this many bytes */
+} fatfs_batch_read_t;
+
+static fatfs_batch_read_t batch_reads[FATFS_BATCH_MAX_READS];
+static BYTE bounce_buf[FF_MIN_SS] __attribute__((aligned(64)));
+
+int fatfs_file_extents(FIL *fp, fatfs_extent_t *extents, uint32_t max_extents) {
+	FATFS *fs = fp->obj.fs;
+	FSIZE_t remain;
+	FRESULT fret;
+	uint32_t n_ext = 0;
+
+	/* Empty file, nothing to read */
+	if (fp->obj.sclust == 0 || fp->obj.objsize == 0)
+		return 0;
+
+	/* Build the cluster link map, one FAT walk for the whole file */
+	linkmap[0] = FATFS_LINKMAP_SIZE;
+	fp->cltbl = linkmap;
+	fret = f_lseek(fp, CREATE_LINKMAP);
+	fp->cltbl = NULL;
+	if (fret != FR_OK) {
+		printk_debug("FATFS: link map failed: %d, %u items required\n", fret, linkmap[0]);
+		return -1;
+	}
+
+	remain = (fp->obj.objsize + FF_MIN_SS - 1) / FF_MIN_SS;
+
+	/* Table is { size, (count, start cluster)..., 0 } */
+	for (DWORD *tbl = &linkmap[1]; tbl[0] != 0 && remain > 0; tbl += 2) {
+		LBA_t sector = fs->database + (LBA_t) fs->csize * (tbl[1] - 2);
+		FSIZE_t count = (FSIZE_t) tbl[0] * fs->csize;
+
+		if (count > remain)
+			count = remain;
+		remain -= count;
+
+		/* Merge with the previous extent if physically adjacent */
+		if (n_ext > 0 && extents[n_ext - 1].sector + extents[n_ext - 1].count == sector) {
+			extents[n_ext - 1].count += (uint32_t) count;
+			continue;
+		}
+
+		if (n_ext >= max_extents)
+			return -1;
+
+		extents[n_ext].sector = sector;
+		extents[n_ext].count = (uint32_t) count;
+		n_ext++;
+	}
+
+	return remain ? -1 : (int) n_ext;
+}
+
+static FRESULT fatfs_read_chunked(FIL *fp, BYTE *dest, uint32_t *total) {
+	UINT byte_read;
+	FRESULT fret;
+
+	do {
+		byte_read = 0;
+		fret = f_read(fp, (void *) dest, FATFS_LOADER_CHUNK_SIZE, &byte_read);
+		dest += byte_read;
+		*total += byte_read;
+	} while (byte_read >= FATFS_LOADER_CHUNK_SIZE && fret == FR_OK);
+
+	return fret;
+}
+
+static FRESULT fatfs_read_extents(FIL *fp, BYTE *dest, fatfs_extent_t *extents, int n_ext, uint32_t *total) {
+	FATFS *fs = fp->obj.fs;
+	uint32_t tail = (uint32_t) (fp->obj.objsize % FF_MIN_SS);
+
+	for (int i = 0; i < n_ext; i++) {
+		uint32_t count = extents[i].count;
+
+		/* Keep the partial last sector out of the direct read */
+		if (i == n_ext - 1 && tail)
+			count--;
+
+		if (count && disk_read(fs->pdrv, dest, extents[i].sector, count) != RES_OK)
+			return FR_DISK_ERR;
+
+		dest += count * FF_MIN_SS;
+		*total += count * FF_MIN_SS;
+	}
+
+	/* Bounce the last partial sector to avoid overrunning dest */
+	if (tail) {
+		fatfs_extent_t *last = &extents[n_ext - 1];
+		if (disk_read(fs->pdrv, bounce_buf, last->sector + last->count - 1, 1) != RES_OK)
+			return FR_DISK_ERR;
+		memcpy(dest, bounce_buf, tail);
+		*total += tail;
+	}
+
+	return FR_OK;
+}
+
+int fatfs_load_file(const char *filename, void *dest, uint32_t *size) {
+	uint32_t total_read = 0;
+	uint64_t start, time;
+	FRESULT fret;
+	FIL file;
+	int n_ext;
+	int ret = 0;
+
+	fret = f_open(&file, filename, FA_OPEN_EXISTING | FA_READ);
+	if (fret != FR_OK) {
+		printk_error("FATFS: open, filename: [%s]: error %d\n", filename, fret);
+		return -1;
+	}
+
+	start = time_us();
+
+	n_ext = fatfs_file_extents(&file, file_extents, FATFS_MAX_EXTENTS);
+	if (n_ext >= 0) {
+		fret = fatfs_read_extents(&file, (BYTE *) dest, file_extents, n_ext, &total_read);
+	} else {
+		printk_debug("FATFS: %s too fragmented, fallback to f_read\n", filename);
+		fret = fatfs_read_chunked(&file, (BYTE *) dest, &total_read);
+	}
+
+	time = time_us() - start + 1;
+
+	if (fret != FR_OK) {
+		printk_error("FATFS: read: error %d\n", fret);
+		ret = -1;
+	}
+
+	f_close(&file);
+
+	printk_info("FATFS: read %u bytes in %ums, %d extents, at %.2fMB/S\n", total_read, (uint32_t) (time / 1000), n_ext,
+				(f32) total_read / (f32) time * 1000000.0f / 1048576.0f);
+
+	if (size)
+		*size = total_read;
+
+	return ret;
+}
+
+/* Queue the extents of one file, returns -1 if the read table is full */
+static int fatfs_batch_queue(fatfs_extent_t *extents, int n_ext, BYTE *dest, uint32_t tail, uint32_t *n_reads) {
+	for (int i = 0; i < n_ext; i++) {
+		uint32_t count = extents[i].count;
+
+		if (i == n_ext - 1 && tail)
+			count--;
+
+		if (count) {
+			if (*n_reads >= FATFS_BATCH_MAX_READS)
+				return -1;
+			batch_reads[*n_reads].sector = extents[i].sector;
+			batch_reads[*n_reads].count = count;
+			batch_reads[*n_reads].dest = dest;
+			batch_reads[*n_reads].tail = 0;
+			(*n_reads)++;
+			dest += count * FF_MIN_SS;
+		}
+
+		if (i == n_ext - 1 && tail) {
+			if (*n_reads >= FATFS_BATCH_MAX_READS)
+				return -1;
+			batch_reads[*n_reads].sector = extents[i].sector + count;
+			batch_reads[*n_reads].count = 1;
+			batch_reads[*n_reads].dest = dest;
+			batch_reads[*n_reads].tail = tail;
+			(*n_reads)++;
+		}
+	}
+	return 0;
+}
+
+int fatfs_load_batch(fatfs_load_entry_t *entries, uint32_t n_entries) {
+	uint32_t n_reads = 0, n_issued = 0, total_read = 0;
+	fatfs_batch_read_t *rd = NULL;
+	uint64_t start, time;
+	FATFS *fs = NULL;
+	FRESULT fret;
+	FIL file;
+	int ret = 0;
+
+	start = time_us();
+
+	/* Pass 1: resolve the extents of every file */
+	for (uint32_t i = 0; i < n_entries; i++) {
+		fatfs_load_entry_t *entry = &entries[i];
+		uint32_t queued = n_reads;
+		int n_ext;
+
+		entry->size = 0;
+		entry->ret = -1;
+
+		fret = f_open(&file, entry->filename, FA_OPEN_EXISTING | FA_READ);
+		if (fret != FR_OK) {
+			if (entry->optional) {
+				printk_debug("FATFS: optional file [%s] not found\n", entry->filename);
+			} else {
+				printk_error("FATFS: open, filename: [%s]: error %d\n", entry->filename, fret);
+				ret = -1;
+			}
+			continue;
+		}
+
+		fs = file.obj.fs;
+		n_ext = fatfs_file_extents(&file, file_extents, FATFS_MAX_EXTENTS);
+		if (n_ext >= 0 && fatfs_batch_queue(file_extents, n_ext, (BYTE *) entry->dest, (uint32_t) (file.obj.objsize % FF_MIN_SS), &n_reads) == 0) {
+			entry->size = (uint32_t) file.obj.objsize;
+			entry->ret = 0;
+		} else {
+			/* Drop anything partially queued, read this one the slow way */
+			n_reads = queued;
+			printk_debug("FATFS: %s too fragmented, fallback to f_read\n", entry->filename);
+			fret = fatfs_read_chunked(&file, (BYTE *) entry->dest, &entry->size);
+			if (fret == FR_OK) {
+				entry->ret = 0;
+				total_read += entry->size;
+			} else {
+				printk_error("FATFS: read %s: error %d\n", entry->filename, fret);
+				ret = -1;
+			}
+		}
+
+		f_close(&file);
+	}
+
+	/* Pass 2: sort all reads by LBA, the table is small so insertion sort will do */
+	for (uint32_t i = 1; i < n_reads; i++) {
+		fatfs_batch_read_t key = batch_reads[i];
+		int j = (int) i - 1;
+		while (j >= 0 && batch_reads[j].sector > key.sector) {
+			batch_reads[j + 1] = batch_reads[j];
+			j--;
+		}
+		batch_reads[j + 1] = key;
+	}
+
+	/* Pass 3: stream in disk order, coalescing reads contiguous on disk and in memory */
+	for (uint32_t i = 0; i < n_reads; i++) {
+		rd = &batch_reads[i];
+
+		if (rd->tail) {
+			if (disk_read(fs->pdrv, bounce_buf, rd->sector, 1) != RES_OK)
+				goto read_fail;
+			memcpy(rd->dest, bounce_buf, rd->tail);
+			total_read += rd->tail;
+			n_issued++;
+			continue;
+		}
+
+		while (i + 1 < n_reads && !batch_reads[i + 1].tail && rd->sector + rd->count == batch_reads[i + 1].sector &&
+			   rd->dest + rd->count * FF_MIN_SS == batch_reads[i + 1].dest) {
+			rd->count += batch_reads[++i].count;
+		}
+
+		if (disk_read(fs->pdrv, rd->dest, rd->sector, rd->count) != RES_OK)
+			goto read_fail;
+		total_read += rd->count * FF_MIN_SS;
+		n_issued++;
+	}
+
+	time = time_us() - start + 1;
+
+	printk_info("FATFS: batch %u files, %u reads (%u queued) %u bytes in %ums at %.2fMB/S\n", n_entries, n_issued, n_reads, total_read,
+				(uint32_t) (time / 1000), (f32) total_read / (f32) time * 1000000.0f / 1048576.0f);
+
+	return ret;
+
+read_fail:
+	printk_error("FATFS: batch read failed at sector %u count %u\n", (uint32_t) rd->sector, rd->count);
+	for (uint32_t i = 0; i < n_entries; i++) entries[i].ret = -1;
+	return -1;
+}
+
+typedef struct {
+	FIL *fp;
+	int n_ext; /* Number of file_extents, -1 when falling back to f_read */
+} fatfs_elf_ctx_t;
+
+/* Read a byte range of the file through its extents, whole sectors go straight to buf */
+static int fatfs_extents_read(FATFS *fs, fatfs_extent_t *extents, int n_ext, uint64_t offset, BYTE *buf, uint32_t len) {
+	int i = 0;
+	LBA_t base = 0; /* File sector index of extents[i] */
+
+	while (len) {
+		LBA_t fsect = offset / FF_MIN_SS;
+		uint32_t sofs = offset % FF_MIN_SS;
+
+		while (i < n_ext && fsect >= base + extents[i].count) base += extents[i++].count;
+		if (i >= n_ext)
+			return -1;
+
+		LBA_t sector = extents[i].sector + (fsect - base);
+
+		if (sofs == 0 && len >= FF_MIN_SS) {
+			uint32_t count = len / FF_MIN_SS;
+			if (count > extents[i].count - (fsect - base))
+				count = extents[i].count - (fsect - base);
+			if (disk_read(fs->pdrv, buf, sector, count) != RES_OK)
+				return -1;
+			count *= FF_MIN_SS;
+			buf += count;
+			offset += count;
+			len -= count;
+		} else {
+			uint32_t n = FF_MIN_SS - sofs;
+			if (n > len)
+				n = len;
+			if (disk_read(fs->pdrv, bounce_buf, sector, 1) != RES_OK)
+				return -1;
+			memcpy(buf, bounce_buf + sofs, n);
+			buf += n;
+			offset += n;
+			len -= n;
+		}
+	}
+
+	return 0;
+}
+
+static int fatfs_elf_read(void *ctx, uint64_t offset, void *buf, uint32_t len) {
+	fatfs_elf_ctx_t *elf = (fatfs_elf_ctx_t *) ctx;
+	UINT byte_read;
+
+	if (offset + len > elf->fp->obj.objsize)
+		return -1;
+
+	if (elf->n_ext >= 0)
+		return fatfs_extents_read(elf->fp->obj.fs, file_extents, elf->n_ext, offset, (BYTE *) buf, len);
+
+	if (f_lseek(elf->fp, offset) != FR_OK)
+		return -1;
+	if (f_read(elf->fp, buf, len, &byte_read) != FR_OK || byte_read != len)
+		return -1;
+	return 0;
+}
+
+int fatfs_elf_get_entry(const char *filename, phys_addr_t *entry) {
+	Elf64_Ehdr ehdr;
+	UINT byte_read;
+	FRESULT fret;
+	FIL file;
+
+	fret = f_open(&file, filename, FA_OPEN_EXISTING | FA_READ);
+	if (fret != FR_OK) {
+		printk_error("FATFS: open, filename: [%s]: error %d\n", filename, fret);
+		return -1;
+	}
+
+	fret = f_read(&file, &ehdr, sizeof(ehdr), &byte_read);
+	f_close(&file);
+
+	if (fret != FR_OK || byte_read < sizeof(Elf32_Ehdr) || memcmp(ehdr.e_ident, ELFMAG, SELFMAG)) {
+		printk_error("FATFS: %s is not a valid ELF file\n", filename);
+		return -1;
+	}
+
+	if (ehdr.e_ident[EI_CLASS] == ELFCLASS32)
+		*entry = ((Elf32_Ehdr *) &ehdr)->e_entry;
+	else
+		*entry = (phys_addr_t) ehdr.e_entry;
+
+	return 0;
+}
+
+int fatfs_load_elf(const char *filename, vaddr_map_t *map, phys_addr_t *entry) {
+	fatfs_elf_ctx_t ctx;
+	uint8_t ident[EI_NIDENT];
+	uint64_t start, time;
+	FRESULT fret;
+	FIL file;
+	int ret;
+
+	fret = f_open(&file, filename, FA_OPEN_EXISTING | FA_READ);
+	if (fret != FR_OK) {
+		printk_error("FATFS: open, filename: [%s]: error %d\n", filename, fret);
+		return -1;
+	}
+
+	start = time_us();
+
+	ctx.fp = &file;
+	ctx.n_ext = fatfs_file_extents(&file, file_extents, FATFS_MAX_EXTENTS);
+	if (ctx.n_ext < 0)
+		printk_debug("FATFS: %s too fragmented, fallback to f_read\n", filename);
+
+	if (fatfs_elf_read(&ctx, 0, ident, EI_NIDENT)) {
+		ret = -1;
+	} else if (ident[EI_CLASS] == ELFCLASS32) {
+		ret = load_elf32_stream_remap(fatfs_elf_read, &ctx, map, entry);
+	} else {
+		ret = load_elf64_stream(fatfs_elf_read, &ctx, entry);
+	}
+
+	time = time_us() - start + 1;
+
+	f_close(&file);
+
+	if (ret) {
+		printk_error("FATFS: load ELF %s failed\n", filename);
+		return -1;
+	}
+
+	printk_info("FATFS: ELF %s loaded in %ums\n", filename, (uint32_t) (time / 1000));
+
+	return 0;
+}
@@ -0,0 +1,196 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <types.h>
+
+#include <barrier.h>
+#include <cache.h>
+#include <interrupt.h>
+#include <log.h>
+#include <smp.h>
+#include <timer.h>
+
+#include <sys-gic.h>
+#include <sys-rproc.h>
+
+#define SMP_CPU 1
+
+/* Tickets are non-negative ints, the ring counters wrap at 2^31 */
+#define SMP_TICKET_MASK 0x7fffffff
+
+typedef struct {
+	smp_fn_t fn;
+	void *arg;
+	volatile int ret;
+	volatile uint32_t ticket;
+} smp_slot_t;
+
+extern void smp_secondary_entry(void);
+
+smp_boot_param_t smp_boot_param __attribute__((aligned(64)));
+
+static uint8_t smp_stack[CONFIG_SMP_STACK_SIZE] __attribute__((aligned(64)));
+
+/*
+ * Single producer, single consumer ring: CPU0 only writes smp_head, CPU1
+ * only writes smp_tail, so no lock is needed, only barriers.
+ */
+static smp_slot_t smp_queue[SMP_QUEUE_LEN];
+static volatile uint32_t smp_head;
+static volatile uint32_t smp_tail;
+static volatile uint32_t smp_online;
+
+static void smp_sgi_handler(void *data) {
+	/* Only wakes CPU0 from WFI, smp_wait() checks the ring itself */
+}
+
+/**
+ * @brief Idle loop of CPU1, entered from smp_secondary_entry.
+ *
+ * Runs with IRQs masked: a pending SGI still ends WFI, it is acknowledged
+ * here instead of going through the exception vectors of CPU0.
+ */
+void smp_secondary_main(void) {
+	smp_slot_t *slot;
+
+	sunxi_gic_cpu_interface_init(SMP_CPU);
+
+	smp_online = 1;
+	dsb();
+
+	for (;;) {
+		while (smp_tail == smp_head) {
+			__asm__ __volatile__("wfi");
+			sunxi_gic_ack_irq();
+		}
+		dmb();
+
+		slot = &smp_queue[smp_tail % SMP_QUEUE_LEN];
+		slot->ret = slot->fn(slot->arg);
+
+		dmb();
+		smp_tail = (smp_tail + 1) & SMP_TICKET_MASK;
+		sunxi_gic_send_sgi(SMP_SGI_WORK, 1 << 0);
+	}
+}
+
+int smp_init(void) {
+	uint32_t val, start;
+
+	if (smp_online)
+		return 0;
+
+	smp_boot_param.stack = (uint32_t) smp_stack + sizeof(smp_stack);
+	__asm__ __volatile__("mrc p15, 0, %0, c2, c0, 0" : "=r"(val));
+	smp_boot_param.ttbr0 = val;
+	__asm__ __volatile__("mrc p15, 0, %0, c3, c0, 0" : "=r"(val));
+	smp_boot_param.dacr = val;
+	__asm__ __volatile__("mrc p15, 0, %0, c1, c0, 0" : "=r"(val));
+	smp_boot_param.sctlr = val;
+
+	smp_head = 0;
+	smp_tail = 0;
+
+	/* CPU1 reads the parameters with its caches off */
+	flush_dcache_range((uint32_t) &smp_boot_param, (uint32_t) &smp_boot_param + sizeof(smp_boot_param));
+
+	irq_install_handler(GIC_SRC_SGI(SMP_SGI_WORK), smp_sgi_handler, NULL);
+
+	sunxi_cpux_start(SMP_CPU, (uint32_t) smp_secondary_entry);
+
+	start = time_ms();
+	while (!smp_online) {
+		if (time_ms() - start > 100) {
+			printk_error("SMP: CPU%d did not come up\n", SMP_CPU);
+			sunxi_cpux_stop(SMP_CPU);
+			return -1;
+		}
+	}
+
+	printk_debug("SMP: CPU%d online\n", SMP_CPU);
+	return 0;
+}
+
+void smp_exit(void) {
+	if (!smp_online)
+		return;
+
+	smp_wait_all();
+
+	/* Let CPU1 settle in WFI before the reset */
+	while (!sunxi_cpux_is_wfi(SMP_CPU))
+		;
+
+	sunxi_cpux_stop(SMP_CPU);
+	smp_online = 0;
+	irq_free_handler(GIC_SRC_SGI(SMP_SGI_WORK));
+}
+
+int smp_run_async(smp_fn_t fn, void *arg) {
+	smp_slot_t *slot;
+	uint32_t ticket = smp_head;
+
+	if (!smp_online || ((ticket - smp_tail) & SMP_TICKET_MASK) >= SMP_QUEUE_LEN)
+		return -1;
+
+	slot = &smp_queue[ticket % SMP_QUEUE_LEN];
+	slot->fn = fn;
+	slot->arg = arg;
+	slot->ret = 0;
+	slot->ticket = ticket;
+
+	dmb();
+	smp_head = (ticket + 1) & SMP_TICKET_MASK;
+	sunxi_gic_send_sgi(SMP_SGI_WORK, 1 << SMP_CPU);
+
+	return ticket;
+}
+
+bool smp_work_done(int ticket) {
+	/* Serial number compare in the 31 bit ticket space */
+	return (int32_t) ((smp_tail - (uint32_t) ticket) << 1) > 0;
+}
+
+int smp_wait(int ticket) {
+	smp_slot_t *slot = &smp_queue[(uint32_t) ticket % SMP_QUEUE_LEN];
+	uint32_t flags;
+
+	/*
+	 * Check and sleep with IRQs masked: a completion SGI taken between the
+	 * check and WFI would otherwise be lost. A pending IRQ still ends WFI,
+	 * it is handled once IRQs are unmasked.
+	 */
+	for (;;) {
+		flags = arm32_interrupt_save();
+		if (smp_work_done(ticket))
+			break;
+		__asm__ __volatile__("wfi");
+		arm32_interrupt_restore(flags);
+	}
+	arm32_interrupt_restore(flags);
+	dmb();
+
+	if (slot->ticket != (uint32_t) ticket) {
+		printk_warning("SMP: result of ticket %d was overwritten\n", ticket);
+		return 0;
+	}
+
+	return slot->ret;
+}
+
+void smp_wait_all(void) {
+	uint32_t flags;
+
+	/* Same masked check and sleep as smp_wait() */
+	for (;;) {
+		flags = arm32_interrupt_save();
+		if (smp_tail == smp_head)
+			break;
+		__asm__ __volatile__("wfi");
+		arm32_interrupt_restore(flags);
+	}
+	arm32_interrupt_restore(flags);
+	dmb();
+}
@@ -0,0 +1,96 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <types.h>
+
+#include <log.h>
+#include <timer.h>
+
+#include <bootstage.h>
+#include <fdt_wrapper.h>
+
+#include "libfdt.h"
+
+static bootstage_record_t records[BOOTSTAGE_MAX_RECORDS];
+static int record_count;
+static int record_dropped;
+
+uint32_t bootstage_mark(const char *name) {
+	uint32_t now = (uint32_t) time_us();
+
+	if (record_count >= BOOTSTAGE_MAX_RECORDS) {
+		record_dropped++;
+		return now;
+	}
+
+	records[record_count].name = name;
+	records[record_count].time_us = now;
+	record_count++;
+
+	return now;
+}
+
+const bootstage_record_t *bootstage_get(int *count) {
+	*count = record_count;
+	return records;
+}
+
+void bootstage_dump(void) {
+	uint32_t prev = 0;
+
+	printk(LOG_LEVEL_MUTE, "%-20s %12s %12s\n", "stage", "time (us)", "delta (us)");
+	for (int i = 0; i < record_count; i++) {
+		printk(LOG_LEVEL_MUTE, "%-20s %12u %12u\n", records[i].name, records[i].time_us, records[i].time_us - prev);
+		prev = records[i].time_us;
+	}
+	if (record_dropped)
+		printk(LOG_LEVEL_MUTE, "%d records dropped, table holds %d\n", record_dropped, BOOTSTAGE_MAX_RECORDS);
+}
+
+int bootstage_fdt_export(void *fdt) {
+	fdt32_t times[BOOTSTAGE_MAX_RECORDS];
+	int names_len = 0, chosen, node, ret;
+
+	if (record_count == 0)
+		return 0;
+
+	for (int i = 0; i < record_count; i++) {
+		names_len += strlen(records[i].name) + 1;
+		times[i] = cpu_to_fdt32(records[i].time_us);
+	}
+
+	/* Node, two properties and their names, with room to spare */
+	ret = fdt_increase_size(fdt, names_len + sizeof(times) + 128);
+	if (ret) {
+		printk_warning("BOOTSTAGE: cannot grow FDT: %s\n", fdt_strerror(ret));
+		return -1;
+	}
+
+	chosen = fdt_find_or_add_subnode(fdt, 0, "chosen");
+	if (chosen < 0)
+		goto err;
+
+	node = fdt_find_or_add_subnode(fdt, chosen, BOOTSTAGE_FDT_NODE);
+	if (node < 0)
+		goto err;
+
+	ret = fdt_setprop(fdt, node, "names", NULL, 0);
+	for (int i = 0; ret == 0 && i < record_count; i++)
+		ret = fdt_appendprop_string(fdt, node, "names", records[i].name);
+	if (ret)
+		goto err;
+
+	ret = fdt_setprop(fdt, node, "timestamps-us", times, record_count * sizeof(fdt32_t));
+	if (ret)
+		goto err;
+
+	printk_debug("BOOTSTAGE: exported %d records\n", record_count);
+	return 0;
+
+err:
+	printk_warning("BOOTSTAGE: export to /chosen/%s failed\n", BOOTSTAGE_FDT_NODE);
+	return -1;
+}
@@ -2,8 +2,12 @@
 #include <string.h>
 #include <sstdlib.h>
 
+#include <bootstage.h>
 #include <log.h>
 
+#include <ff.h>
+#include <diskio.h>
+
 #include "cli.h"
 #include "cli_config.h"
 #include "cli_history.h"
@@ -67,6 +71,41 @@ static int cmd_write32(int argc, const char **argv) {
 	return 0;
 }
 
+static int cmd_fscache(int argc, const char **argv) {
+	disk_cache_stat_t stat;
+
+	if (argc == 2 && strcmp(argv[1], "reset") == 0) {
+		disk_cache_reset_stat();
+		return 0;
+	}
+
+	disk_cache_get_stat(&stat);
+	if (stat.blocks == 0) {
+		printk(LOG_LEVEL_MUTE, "FATFS sector cache not enabled\n");
+		return 0;
+	}
+
+	printk(LOG_LEVEL_MUTE, "FATFS sector cache: %u blocks\n", stat.blocks);
+	printk(LOG_LEVEL_MUTE, "  hits:   %u\n", stat.hits);
+	printk(LOG_LEVEL_MUTE, "  misses: %u\n", stat.misses);
+	printk(LOG_LEVEL_MUTE, "  bypass: %u\n", stat.bypass);
+	if (stat.hits + stat.misses)
+		printk(LOG_LEVEL_MUTE, "  hit rate: %u%%\n", stat.hits * 100 / (stat.hits + stat.misses));
+	return 0;
+}
+
+static int cmd_bootstage(int argc, const char **argv) {
+	bootstage_dump();
+	return 0;
+}
+
+#ifdef CONFIG_LOG_BINARY
+static int cmd_binlog(int argc, const char **argv) {
+	log_binary_dump();
+	return 0;
+}
+#endif
+
 static int cmd_history(int argc, const char **argv) {
 	for (int i = get_history_count(); i >= 0; i--) {
 		uart_puts(history_get(i));
@@ -113,6 +152,11 @@ const msh_command_entry msh_builtin_commands[] = {
 		{"read32", cmd_read32, "read 32-bits value from device reg", "Usage: read32 [address]\n"},
 		{"write32", cmd_write32, "write 32-bits value to device reg", "Usage: write32 [address] [data]\n"},
 		{"ls", cmd_ls, "linux nerd compatible", "Usage: ls\n"},
+		{"fscache", cmd_fscache, "show FATFS sector cache hit/miss counters", "Usage: fscache [reset]\n"},
+		{"bootstage", cmd_bootstage, "show the boot stage timings", "Usage: bootstage\n"},
+#ifdef CONFIG_LOG_BINARY
+		{"binlog", cmd_binlog, "dump the binary log ring for tools/logdecode.py", "Usage: binlog\n"},
+#endif
 		msh_command_end,
 };
 
@@ -0,0 +1,65 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <types.h>
+
+#include <crc32.h>
+
+#define CRC32_POLY 0xedb88320
+
+/*
+ * Slice-by-8 tables, crc32_table[k][n] is the CRC of byte n followed by k
+ * zero bytes. Built at run time so they live in .bss instead of the image.
+ */
+static uint32_t crc32_table[8][256];
+static bool crc32_table_ready;
+
+static void crc32_init_table(void) {
+	for (uint32_t n = 0; n < 256; n++) {
+		uint32_t c = n;
+		for (int k = 0; k < 8; k++) c = (c & 1) ? (c >> 1) ^ CRC32_POLY : c >> 1;
+		crc32_table[0][n] = c;
+	}
+
+	for (uint32_t n = 0; n < 256; n++) {
+		uint32_t c = crc32_table[0][n];
+		for (int k = 1; k < 8; k++) {
+			c = crc32_table[0][c & 0xff] ^ (c >> 8);
+			crc32_table[k][n] = c;
+		}
+	}
+
+	crc32_table_ready = true;
+}
+
+uint32_t crc32(uint32_t crc, const void *buf, uint32_t len) {
+	const uint8_t *p = (const uint8_t *) buf;
+	uint32_t lo, hi;
+
+	if (!crc32_table_ready)
+		crc32_init_table();
+
+	crc = ~crc;
+
+	/* Byte wise up to a word boundary */
+	while (len && ((uintptr_t) p & 3)) {
+		crc = crc32_table[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+		len--;
+	}
+
+	/* Eight bytes per step, little endian words */
+	while (len >= 8) {
+		lo = *(const uint32_t *) p ^ crc;
+		hi = *(const uint32_t *) (p + 4);
+		crc = crc32_table[7][lo & 0xff] ^ crc32_table[6][(lo >> 8) & 0xff] ^ crc32_table[5][(lo >> 16) & 0xff] ^ crc32_table[4][lo >> 24] ^
+			  crc32_table[3][hi & 0xff] ^ crc32_table[2][(hi >> 8) & 0xff] ^ crc32_table[1][(hi >> 16) & 0xff] ^ crc32_table[0][hi >> 24];
+		p += 8;
+		len -= 8;
+	}
+
+	while (len--) crc = crc32_table[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+
+	return ~crc;
+}
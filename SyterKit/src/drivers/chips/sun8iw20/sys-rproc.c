@@ -8,6 +8,7 @@
 #include <types.h>
 
 #include <log.h>
+#include <timer.h>
 
 #include <sys-clk.h>
 
@@ -144,6 +145,32 @@ void sunxi_c906_clock_reset(void) {
 	writel(reg_val, CCU_BASE + CCU_RISCV_CFG_BGR_REG);
 }
 
+void sunxi_cpux_start(int cpu, uint32_t entry) {
+	uint32_t reg_val;
+
+	writel(entry, CPUX_SOFT_ENTRY_REG);
+
+	/* cycle the core reset, the core starts at the soft entry */
+	reg_val = readl(C0_RST_CTRL_REG);
+	reg_val &= ~(1 << BIT_C0_CORE_RST(cpu));
+	writel(reg_val, C0_RST_CTRL_REG);
+	sdelay(10);
+	reg_val |= (1 << BIT_C0_CORE_RST(cpu));
+	writel(reg_val, C0_RST_CTRL_REG);
+}
+
+void sunxi_cpux_stop(int cpu) {
+	uint32_t reg_val;
+
+	reg_val = readl(C0_RST_CTRL_REG);
+	reg_val &= ~(1 << BIT_C0_CORE_RST(cpu));
+	writel(reg_val, C0_RST_CTRL_REG);
+}
+
+int sunxi_cpux_is_wfi(int cpu) {
+	return (readl(C0_CPU_STATUS_REG) >> BIT_C0_STANDBYWFI(cpu)) & 0x1;
+}
+
 void dump_c906_clock(void) {
 	uint32_t reg_val, pll_perf, factor_m, factor_n, pll_riscv, pll_dsp;
 	uint32_t plln, pllm;
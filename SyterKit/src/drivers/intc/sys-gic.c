@@ -8,6 +8,7 @@
 #include <types.h>
 
 #include <log.h>
+#include <barrier.h>
 #include <mmu.h>
 
 #include <reg-ncat.h>
@@ -121,6 +122,10 @@ static void default_isr(void *data) {
 }
 
 static void gic_sgi_handler(uint32_t irq_no) {
+	if (sunxi_int_handlers[irq_no].func != default_isr) {
+		sunxi_int_handlers[irq_no].func(sunxi_int_handlers[irq_no].data);
+		return;
+	}
 	printk_debug("GIC: SGI irq %d coming... \n", irq_no);
 }
 
@@ -147,7 +152,10 @@ static void gic_clear_pending(uint32_t irq_no) {
 }
 
 int arch_interrupt_init(void) {
-	for (int i = 0; i < GIC_IRQ_NUM; i++) sunxi_int_handlers[i].data = default_isr;
+	for (int i = 0; i < GIC_IRQ_NUM; i++) {
+		sunxi_int_handlers[i].data = (void *) i;
+		sunxi_int_handlers[i].func = default_isr;
+	}
 	gic_distributor_init();
 	gic_cpuif_init();
 	return 0;
@@ -170,7 +178,8 @@ int sunxi_gic_cpu_interface_exit(void) {
 }
 
 void do_irq(struct arm_regs_t *regs) {
-	uint32_t idnum = readl(GIC_INT_ACK_REG);
+	uint32_t ack = readl(GIC_INT_ACK_REG);
+	uint32_t idnum = ack & GIC_INT_ACK_ID_MASK; /* SGIs carry the source CPU above the ID */
 
 	if ((idnum == 1022) || (idnum == 1023)) {
 		printk_error("GIC: spurious irq !!\n");
@@ -186,12 +195,28 @@ void do_irq(struct arm_regs_t *regs) {
 		gic_ppi_handler(idnum);
 	else
 		gic_spi_handler(idnum);
-	writel(idnum, GIC_END_INT_REG);
-	writel(idnum, GIC_DEACT_INT_REG);
+	writel(ack, GIC_END_INT_REG);
+	writel(ack, GIC_DEACT_INT_REG);
 	gic_clear_pending(idnum);
 	return;
 }
 
+void sunxi_gic_send_sgi(int sgi, uint32_t cpu_mask) {
+	dsb(); /* make the data behind the SGI visible first */
+	writel(((cpu_mask & 0xff) << 16) | (sgi & 0xf), GIC_SGI_REG);
+}
+
+int sunxi_gic_ack_irq(void) {
+	uint32_t ack = readl(GIC_INT_ACK_REG);
+
+	if ((ack & GIC_INT_ACK_ID_MASK) >= 1022)
+		return -1;
+
+	writel(ack, GIC_END_INT_REG);
+	writel(ack, GIC_DEACT_INT_REG);
+	return ack & GIC_INT_ACK_ID_MASK;
+}
+
 void irq_free_handler(int irq) {
 	arm32_interrupt_disable();
 	if (irq >= GIC_IRQ_NUM) {
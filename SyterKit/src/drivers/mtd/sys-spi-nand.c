@@ -23,6 +23,8 @@ enum {
 	OPCODE_READ_STATUS = 0x0f,
 	OPCODE_WRITE_STATUS = 0x1f,
 	OPCODE_READ_PAGE = 0x13,
+	OPCODE_READ_CACHE_SEQ = 0x31,
+	OPCODE_READ_CACHE_LAST = 0x3f,
 	OPCODE_READ = 0x03,
 	OPCODE_FAST_READ = 0x0b,
 	OPCODE_FAST_READ_DUAL_O = 0x3b,
@@ -64,7 +66,7 @@ static const spi_nand_info_t spi_nand_infos[] = {
 
 		/* Gigadevice */
 		{"GD5F1GQ4UAWxx", {.mfr = SPI_NAND_MFR_GIGADEVICE, .dev = 0x10, 1}, 2048, 64, 64, 1024, 1, 1, SPI_IO_QUAD_RX},
-		{"GD5F1GQ5UExxG", {.mfr = SPI_NAND_MFR_GIGADEVICE, .dev = 0x51, 1}, 2048, 128, 64, 1024, 1, 1, SPI_IO_QUAD_RX},
+		{"GD5F1GQ5UExxG", {.mfr = SPI_NAND_MFR_GIGADEVICE, .dev = 0x51, 1}, 2048, 128, 64, 1024, 1, 1, SPI_IO_QUAD_RX, true},
 		{"GD5F1GQ4UExIG", {.mfr = SPI_NAND_MFR_GIGADEVICE, .dev = 0xd1, 1}, 2048, 128, 64, 1024, 1, 1, SPI_IO_QUAD_RX},
 		{"GD5F2GQ4xFxxG", {.mfr = SPI_NAND_MFR_GIGADEVICE, .dev = 0xd2, 1}, 2048, 256, 64, 2048, 1, 1, SPI_IO_QUAD_RX},
 		{"GD5F1GQ4UExxH", {.mfr = SPI_NAND_MFR_GIGADEVICE, .dev = 0xd9, 1}, 2048, 64, 64, 1024, 1, 1, SPI_IO_QUAD_RX},
@@ -74,7 +76,7 @@ static const spi_nand_info_t spi_nand_infos[] = {
 		{"GD5F2GQ4xAYIG", {.mfr = SPI_NAND_MFR_GIGADEVICE, .dev = 0xf2, 1}, 2048, 64, 64, 2048, 1, 1, SPI_IO_QUAD_RX},
 		{"GD5F4GQ4UBxIG", {.mfr = SPI_NAND_MFR_GIGADEVICE, .dev = 0xd4, 1}, 4096, 256, 64, 2048, 1, 1, SPI_IO_QUAD_RX},
 		{"GD5F4GQ4xAYIG", {.mfr = SPI_NAND_MFR_GIGADEVICE, .dev = 0xf4, 1}, 2048, 64, 64, 4096, 1, 1, SPI_IO_QUAD_RX},
-		{"GD5F2GQ5UExxG", {.mfr = SPI_NAND_MFR_GIGADEVICE, .dev = 0x52, 1}, 2048, 128, 64, 2048, 1, 1, SPI_IO_QUAD_RX},
+		{"GD5F2GQ5UExxG", {.mfr = SPI_NAND_MFR_GIGADEVICE, .dev = 0x52, 1}, 2048, 128, 64, 2048, 1, 1, SPI_IO_QUAD_RX, true},
 		{"GD5F4GQ4UCxIG", {.mfr = SPI_NAND_MFR_GIGADEVICE, .dev = 0xb4, 1}, 4096, 256, 64, 2048, 1, 1, SPI_IO_QUAD_RX},
 		{"GD5F4GQ4RCxIG", {.mfr = SPI_NAND_MFR_GIGADEVICE, .dev = 0xa4, 1}, 4096, 256, 64, 2048, 1, 1, SPI_IO_QUAD_RX},
 
@@ -126,11 +128,11 @@ static const spi_nand_info_t spi_nand_infos[] = {
 
 		/* Micron */
 		{"MT29F1G01AAADD", {.mfr = SPI_NAND_MFR_MICRON, .dev = 0x12, 1}, 2048, 64, 64, 1024, 1, 1, SPI_IO_DUAL_RX},
-		{"MT29F1G01ABAFD", {.mfr = SPI_NAND_MFR_MICRON, .dev = 0x14, 1}, 2048, 128, 64, 1024, 1, 1, SPI_IO_DUAL_RX},
+		{"MT29F1G01ABAFD", {.mfr = SPI_NAND_MFR_MICRON, .dev = 0x14, 1}, 2048, 128, 64, 1024, 1, 1, SPI_IO_DUAL_RX, true},
 		{"MT29F2G01AAAED", {.mfr = SPI_NAND_MFR_MICRON, .dev = 0x9f, 1}, 2048, 64, 64, 2048, 2, 1, SPI_IO_DUAL_RX},
-		{"MT29F2G01ABAGD", {.mfr = SPI_NAND_MFR_MICRON, .dev = 0x24, 1}, 2048, 128, 64, 2048, 2, 1, SPI_IO_DUAL_RX},
+		{"MT29F2G01ABAGD", {.mfr = SPI_NAND_MFR_MICRON, .dev = 0x24, 1}, 2048, 128, 64, 2048, 2, 1, SPI_IO_DUAL_RX, true},
 		{"MT29F4G01AAADD", {.mfr = SPI_NAND_MFR_MICRON, .dev = 0x32, 1}, 2048, 64, 64, 4096, 2, 1, SPI_IO_DUAL_RX},
-		{"MT29F4G01ABAFD", {.mfr = SPI_NAND_MFR_MICRON, .dev = 0x34, 1}, 4096, 256, 64, 2048, 1, 1, SPI_IO_DUAL_RX},
+		{"MT29F4G01ABAFD", {.mfr = SPI_NAND_MFR_MICRON, .dev = 0x34, 1}, 4096, 256, 64, 2048, 1, 1, SPI_IO_DUAL_RX, true},
 		{"MT29F4G01ADAGD", {.mfr = SPI_NAND_MFR_MICRON, .dev = 0x36, 1}, 2048, 128, 64, 2048, 2, 2, SPI_IO_DUAL_RX},
 		{"MT29F8G01ADAFD", {.mfr = SPI_NAND_MFR_MICRON, .dev = 0x46, 1}, 4096, 256, 64, 2048, 1, 2, SPI_IO_DUAL_RX},
 
@@ -144,6 +146,24 @@ static const spi_nand_info_t spi_nand_infos[] = {
 
 static spi_nand_info_t info; /* Static variable to store SPI NAND information */
 
+/* Bad block table, two bits per block, filled on first access to a block */
+enum {
+	BBT_BLOCK_UNKNOWN = 0x0,
+	BBT_BLOCK_GOOD = 0x1,
+	BBT_BLOCK_BAD = 0x2,
+};
+
+static uint8_t bbt[SPI_NAND_BBT_MAX_BLOCKS / 4];
+
+static uint8_t last_status; /* Status register value of the last busy wait */
+static uint32_t ecc_errors; /* Uncorrectable ECC errors seen since the last reset */
+
+#define SPI_NAND_CALIB_ID_LEN 4
+#define SPI_NAND_CALIB_DATA_LEN 60
+
+static uint8_t calib_ref[SPI_NAND_CALIB_ID_LEN + SPI_NAND_CALIB_DATA_LEN]; /* Pattern read at the starting clock */
+static uint8_t calib_buf[SPI_NAND_CALIB_ID_LEN + SPI_NAND_CALIB_DATA_LEN];
+
 /**
  * Retrieve SPI NAND information.
  *
@@ -192,6 +212,7 @@ static int spi_nand_info(sunxi_spi_t *spi) {
 			info.planes_per_die = info_table->planes_per_die;
 			info.ndies = info_table->ndies;
 			info.mode = info_table->mode;
+			info.cache_read = info_table->cache_read;
 			return 0; /* Return success */
 		}
 	}
@@ -230,6 +251,7 @@ static int spi_nand_info(sunxi_spi_t *spi) {
 			info.planes_per_die = info_table->planes_per_die;
 			info.ndies = info_table->ndies;
 			info.mode = info_table->mode;
+			info.cache_read = info_table->cache_read;
 			return 0; /* Return success */
 		}
 	}
@@ -328,9 +350,41 @@ static bool spi_nand_wait_while_busy(sunxi_spi_t *spi) {
 		}
 	} while ((rx[0] & 0x1) == 0x1); /* Check SR3 Busy bit */
 
+	last_status = rx[0];
+
 	return true;
 }
 
+/**
+ * Account an uncorrectable ECC error reported in a status register value.
+ *
+ * Most vendors report an uncorrectable error as 0b10 in ECC status bits
+ * [5:4]. Winbond also uses 0b11 for an error in an earlier page of a
+ * continuous read. XTX keeps a four bit field in bits [7:4] where 0b1111
+ * is uncorrectable and smaller values count corrected bit flips.
+ *
+ * @param status Value of the status register (0xc0).
+ */
+static void spi_nand_check_ecc(uint8_t status) {
+	uint8_t ecc = (status >> 4) & 0x3;
+	bool uncorrectable;
+
+	switch (info.id.mfr) {
+		case SPI_NAND_MFR_XTX:
+			uncorrectable = ((status >> 4) & 0xf) == 0xf;
+			break;
+		case SPI_NAND_MFR_WINBOND:
+			uncorrectable = ecc == 0x2 || ecc == 0x3;
+			break;
+		default:
+			uncorrectable = ecc == 0x2;
+			break;
+	}
+
+	if (uncorrectable)
+		ecc_errors++;
+}
+
 /**
  * Detect and initialize SPI NAND flash.
  *
@@ -368,6 +422,8 @@ int spi_nand_detect(sunxi_spi_t *spi) {
 			}
 		}
 
+		memset(bbt, 0, sizeof(bbt));
+
 		printk_info("SPI-NAND: %s detected\n", info.name);
 
 		return 0; /* Return success */
@@ -397,13 +453,86 @@ static int spi_nand_load_page(sunxi_spi_t *spi, uint32_t offset) {
 
 	sunxi_spi_transfer(spi, SPI_IO_SINGLE, tx, 4, 0, 0); /* Perform SPI transfer */
 	spi_nand_wait_while_busy(spi);						 /* Wait until SPI NAND is not busy */
+	spi_nand_check_ecc(last_status);					 /* ECC status of the loaded page */
 
 	return 0; /* Return success */
 }
 
+/**
+ * Move the loaded page from the cache to the data register and, unless it
+ * is the last page, start loading the next page into the cache.
+ *
+ * @param spi Pointer to the sunxi_spi_t structure.
+ * @param last True for the last page of the sequence.
+ */
+static void spi_nand_cache_read_next(sunxi_spi_t *spi, bool last) {
+	uint8_t tx = last ? OPCODE_READ_CACHE_LAST : OPCODE_READ_CACHE_SEQ;
+
+	sunxi_spi_transfer(spi, SPI_IO_SINGLE, &tx, 1, 0, 0);
+	spi_nand_wait_while_busy(spi); /* Busy only while the data register is filled */
+	spi_nand_check_ecc(last_status);
+}
+
+/**
+ * Read data of the loaded page from the cache.
+ *
+ * @param spi Pointer to the sunxi_spi_t structure.
+ * @param opcode Read from cache opcode matching info.mode.
+ * @param txlen Length of opcode, column address and dummy bytes.
+ * @param address Flash address of the loaded page, selects the plane on two plane parts.
+ * @param ca Column address within the page, the spare area starts at info.page_size.
+ * @param buf Pointer to the buffer to store the read data.
+ * @param n Number of bytes to read, must not cross the page end.
+ */
+static void spi_nand_read_from_cache(sunxi_spi_t *spi, uint8_t opcode, uint32_t txlen, uint32_t address, uint32_t ca, uint8_t *buf, uint32_t n) {
+	uint8_t tx[6]; /* Transmit buffer */
+
+	/* Plane select bit follows the column address on two plane parts */
+	if (info.planes_per_die == 2)
+		ca |= ((address / info.page_size / info.pages_per_block) & 0x1) << 12;
+
+	tx[0] = opcode;
+	tx[1] = (uint8_t) (ca >> 8);
+	tx[2] = (uint8_t) (ca >> 0);
+	tx[3] = 0x0;
+	tx[4] = 0x0;
+	tx[5] = 0x0;
+
+	sunxi_spi_transfer(spi, info.mode, tx, txlen, buf, n);
+}
+
+/**
+ * Get the read from cache opcode for the configured I/O mode.
+ *
+ * @param txlen Pointer to store the length of opcode, column address and dummy bytes.
+ * @return The opcode, or -1 if the I/O mode is invalid.
+ */
+static int spi_nand_get_read_opcode(uint32_t *txlen) {
+	*txlen = 4;
+	switch (info.mode) {
+		case SPI_IO_SINGLE:
+			return OPCODE_READ;
+		case SPI_IO_DUAL_RX:
+			return OPCODE_FAST_READ_DUAL_O;
+		case SPI_IO_QUAD_RX:
+			return OPCODE_FAST_READ_QUAD_O;
+		case SPI_IO_QUAD_IO:
+			*txlen = 5; /* Quad IO has 2 dummy bytes */
+			return OPCODE_FAST_READ_QUAD_IO;
+		default:
+			printk_error("spi_nand: invalid mode\n");
+			return -1;
+	}
+}
+
 /**
  * Read data from SPI NAND flash.
  *
+ * Winbond parts are read in continuous mode with a single transfer. Parts
+ * supporting the sequential cache read commands load the next page into the
+ * cache while the current one is clocked out of the data register, other
+ * parts load and read one page at a time.
+ *
  * @param spi Pointer to the sunxi_spi_t structure.
  * @param buf Pointer to the buffer to store the read data.
  * @param addr Starting address to read from.
@@ -416,72 +545,329 @@ uint32_t spi_nand_read(sunxi_spi_t *spi, uint8_t *buf, uint32_t addr, uint32_t r
 	uint32_t n;				 /* Number of bytes to read in each iteration */
 	uint32_t len = 0;		 /* Total number of bytes read */
 	uint32_t ca;			 /* Current address within a page */
-	uint32_t txlen = 4;		 /* Transmit buffer length */
-	uint8_t tx[6];			 /* Transmit buffer */
+	uint32_t txlen;			 /* Transmit buffer length */
 
-	int read_opcode = OPCODE_READ; /* Read opcode */
-	switch (info.mode) {
-		case SPI_IO_SINGLE:
-			read_opcode = OPCODE_READ;
-			break;
-		case SPI_IO_DUAL_RX:
-			read_opcode = OPCODE_FAST_READ_DUAL_O;
-			break;
-		case SPI_IO_QUAD_RX:
-			read_opcode = OPCODE_FAST_READ_QUAD_O;
-			break;
-		case SPI_IO_QUAD_IO:
-			read_opcode = OPCODE_FAST_READ_QUAD_IO;
-			txlen = 5; /* Quad IO has 2 dummy bytes */
-			break;
-		default:
-			printk_error("spi_nand: invalid mode\n");
-			return -1;
-	};
+	int read_opcode = spi_nand_get_read_opcode(&txlen); /* Read opcode */
+	if (read_opcode < 0)
+		return -1;
 
 	if (addr % info.page_size) {
 		printk_error("spi_nand: address is not page-aligned\n");
 		return -1;
 	}
 
-	if (info.id.mfr == SPI_NAND_MFR_GIGADEVICE || info.id.mfr == SPI_NAND_MFR_FORESEE || info.id.mfr == SPI_NAND_MFR_XTX) {
-		while (cnt > 0) {
-			ca = address & (info.page_size - 1);
-			n = cnt > (info.page_size - ca) ? (info.page_size - ca) : cnt;
+	if (rxlen == 0)
+		return 0;
+
+	if (info.id.mfr == SPI_NAND_MFR_WINBOND) {
+		spi_nand_load_page(spi, addr);
 
+		// With Winbond, we use continuous mode which has 1 more dummy
+		// This allows us to not load each page
+		spi_nand_read_from_cache(spi, read_opcode, txlen + 1, address, 0, buf, rxlen);
+
+		/* ECC status covers every page of the continuous read */
+		spi_nand_get_config(spi, CONFIG_ADDR_STATUS, &last_status);
+		spi_nand_check_ecc(last_status);
+
+		return rxlen;
+	}
+
+	spi_nand_load_page(spi, address);
+
+	while (cnt > 0) {
+		ca = address & (info.page_size - 1);
+		n = cnt > (info.page_size - ca) ? (info.page_size - ca) : cnt;
+
+		if (info.cache_read) {
+			/* Pages are queued ahead, only the first one is loaded explicitly */
+			if (address != addr || cnt > n)
+				spi_nand_cache_read_next(spi, cnt == n);
+		} else if (address != addr) {
 			spi_nand_load_page(spi, address);
+		}
+
+		spi_nand_read_from_cache(spi, read_opcode, txlen, address, ca, buf, n);
 
-			tx[0] = read_opcode;
-			tx[1] = (uint8_t) (ca >> 8);
-			tx[2] = (uint8_t) (ca >> 0);
-			tx[3] = 0x0;
+		address += n;
+		buf += n;
+		len += n;
+		cnt -= n;
+	}
 
-			sunxi_spi_transfer(spi, info.mode, tx, 4, buf, n);
+	return len; /* Return total number of bytes read */
+}
 
-			address += n;
-			buf += n;
-			len += n;
-			cnt -= n;
+/**
+ * Get the bad block table state of a block.
+ *
+ * @param block Block number.
+ * @return One of BBT_BLOCK_UNKNOWN, BBT_BLOCK_GOOD or BBT_BLOCK_BAD.
+ */
+static inline uint8_t spi_nand_bbt_get(uint32_t block) {
+	return (bbt[block / 4] >> ((block % 4) * 2)) & 0x3;
+}
+
+/**
+ * Set the bad block table state of a block.
+ *
+ * @param block Block number.
+ * @param state One of BBT_BLOCK_GOOD or BBT_BLOCK_BAD.
+ */
+static inline void spi_nand_bbt_set(uint32_t block, uint8_t state) {
+	bbt[block / 4] &= ~(0x3 << ((block % 4) * 2));
+	bbt[block / 4] |= state << ((block % 4) * 2);
+}
+
+/**
+ * Check the factory bad block markers of a range of blocks.
+ *
+ * Only blocks not yet in the bad block table are read. A block is bad if
+ * the first byte of the spare area of its first page is not 0xff.
+ *
+ * @param spi Pointer to the sunxi_spi_t structure.
+ * @param block First block to check.
+ * @param count Number of blocks to check.
+ */
+static void spi_nand_bbt_scan(sunxi_spi_t *spi, uint32_t block, uint32_t count) {
+	uint32_t block_size = info.page_size * info.pages_per_block;
+	uint32_t txlen, end;
+	uint8_t otp = 0, marker;
+	int read_opcode;
+
+	end = block + count;
+	if (end > info.blocks_per_die * info.ndies)
+		end = info.blocks_per_die * info.ndies;
+	if (end > SPI_NAND_BBT_MAX_BLOCKS)
+		end = SPI_NAND_BBT_MAX_BLOCKS;
+
+	while (block < end && spi_nand_bbt_get(block) != BBT_BLOCK_UNKNOWN)
+		block++;
+	if (block >= end)
+		return;
+
+	read_opcode = spi_nand_get_read_opcode(&txlen);
+	if (read_opcode < 0)
+		return;
+
+	/* Winbond ignores the column address in continuous mode, switch to buffer mode */
+	if (info.id.mfr == SPI_NAND_MFR_WINBOND) {
+		spi_nand_get_config(spi, CONFIG_ADDR_OTP, &otp);
+		spi_nand_set_config(spi, CONFIG_ADDR_OTP, otp | CONFIG_POS_BUF);
+		spi_nand_wait_while_busy(spi);
+	}
+
+	for (; block < end; block++) {
+		if (spi_nand_bbt_get(block) != BBT_BLOCK_UNKNOWN)
+			continue;
+
+		spi_nand_load_page(spi, block * block_size);
+		spi_nand_read_from_cache(spi, read_opcode, txlen, block * block_size, info.page_size, &marker, 1);
+
+		if (marker != 0xff) {
+			printk_warning("SPI-NAND: block %u is bad\n", block);
+			spi_nand_bbt_set(block, BBT_BLOCK_BAD);
+		} else {
+			spi_nand_bbt_set(block, BBT_BLOCK_GOOD);
 		}
-	} else {
-		spi_nand_load_page(spi, addr);
+	}
 
-		// With Winbond, we use continuous mode which has 1 more dummy
-		// This allows us to not load each page
-		if (info.id.mfr == SPI_NAND_MFR_WINBOND) {
-			txlen++;
+	if (info.id.mfr == SPI_NAND_MFR_WINBOND) {
+		spi_nand_set_config(spi, CONFIG_ADDR_OTP, otp);
+		spi_nand_wait_while_busy(spi);
+	}
+}
+
+/**
+ * Check whether a block is bad, scanning its marker on first access.
+ *
+ * @param spi Pointer to the sunxi_spi_t structure.
+ * @param block Block number.
+ * @return true if the block is bad or out of range, false otherwise.
+ */
+static bool spi_nand_block_is_bad(sunxi_spi_t *spi, uint32_t block) {
+	if (block >= info.blocks_per_die * info.ndies || block >= SPI_NAND_BBT_MAX_BLOCKS)
+		return true;
+
+	if (spi_nand_bbt_get(block) == BBT_BLOCK_UNKNOWN)
+		spi_nand_bbt_scan(spi, block, 1);
+
+	return spi_nand_bbt_get(block) == BBT_BLOCK_BAD;
+}
+
+/**
+ * Read data, retrying on uncorrectable ECC errors.
+ *
+ * @param spi Pointer to the sunxi_spi_t structure.
+ * @param buf Pointer to the buffer to store the read data.
+ * @param addr Page aligned flash address.
+ * @param n Number of bytes to read.
+ * @return 0 on success, -1 if the ECC error persists.
+ */
+static int spi_nand_read_retry(sunxi_spi_t *spi, uint8_t *buf, uint32_t addr, uint32_t n) {
+	for (int retry = 0;; retry++) {
+		ecc_errors = 0;
+		spi_nand_read(spi, buf, addr, n);
+		if (ecc_errors == 0)
+			return 0;
+		if (retry >= SPI_NAND_READ_RETRY) {
+			printk_error("SPI-NAND: uncorrectable ECC error at 0x%08x\n", addr);
+			return -1;
 		}
+		printk_warning("SPI-NAND: ECC error at 0x%08x, retry %d\n", addr, retry + 1);
+	}
+}
 
-		ca = address & (info.page_size - 1);
+uint32_t spi_nand_read_skip_bad(sunxi_spi_t *spi, uint8_t *buf, uint32_t addr, uint32_t rxlen) {
+	uint32_t block_size = info.page_size * info.pages_per_block;
+	uint32_t nblocks = info.blocks_per_die * info.ndies;
+	uint32_t block, next, offset, run, n;
+	uint32_t len = 0;
+
+	if (addr % info.page_size) {
+		printk_error("spi_nand: address is not page-aligned\n");
+		return 0;
+	}
+
+	block = addr / block_size;
+	offset = addr % block_size;
+
+	/* Scan the blocks covered when none is bad in one go */
+	spi_nand_bbt_scan(spi, block, (offset + rxlen + block_size - 1) / block_size);
+
+	while (len < rxlen) {
+		while (spi_nand_block_is_bad(spi, block)) {
+			if (block >= nblocks) {
+				printk_error("SPI-NAND: no good block left at 0x%08x\n", block * block_size);
+				return len;
+			}
+			printk_debug("SPI-NAND: skip bad block %u\n", block);
+			block++;
+			offset = 0;
+		}
+
+		/* Merge following good blocks, a run without bad blocks is a single read */
+		run = block_size - offset;
+		next = block + 1;
+		while (len + run < rxlen && !spi_nand_block_is_bad(spi, next)) {
+			run += block_size;
+			next++;
+		}
+		n = (rxlen - len) < run ? (rxlen - len) : run;
 
-		tx[0] = read_opcode;
-		tx[1] = (uint8_t) (ca >> 8);
-		tx[2] = (uint8_t) (ca >> 0);
-		tx[3] = 0x0;
-		tx[4] = 0x0;
+		if (spi_nand_read_retry(spi, buf + len, block * block_size + offset, n))
+			return len;
 
-		sunxi_spi_transfer(spi, info.mode, tx, txlen, buf, rxlen);
+		len += n;
+		block = next;
+		offset = 0;
 	}
 
-	return len; /* Return total number of bytes read */
+	return len;
+}
+
+int spi_nand_read_stream(sunxi_spi_t *spi, uint8_t *buf, uint32_t chunk, uint32_t addr, uint32_t max_len, spi_nand_stream_cb_t cb, void *arg) {
+	uint32_t block_size = info.page_size * info.pages_per_block;
+	uint32_t nblocks = info.blocks_per_die * info.ndies;
+	uint32_t block, offset, n;
+	uint32_t len = 0;
+	int ret = 0;
+
+	if (addr % info.page_size || chunk % info.page_size) {
+		printk_error("spi_nand: address or chunk is not page-aligned\n");
+		return -1;
+	}
+
+	block = addr / block_size;
+	offset = addr % block_size;
+
+	while (len < max_len && ret == 0) {
+		while (block < nblocks && spi_nand_block_is_bad(spi, block)) {
+			printk_debug("SPI-NAND: skip bad block %u\n", block);
+			block++;
+			offset = 0;
+		}
+		if (block >= nblocks) {
+			printk_error("SPI-NAND: no good block left at 0x%08x\n", block * block_size);
+			return -1;
+		}
+
+		/* A chunk never crosses a block, the next block may be bad */
+		n = block_size - offset;
+		if (n > chunk)
+			n = chunk;
+		if (n > max_len - len)
+			n = max_len - len;
+
+		if (spi_nand_read_retry(spi, buf, block * block_size + offset, n))
+			return -1;
+
+		ret = cb(arg, buf, n);
+		len += n;
+		offset += n;
+		if (offset == block_size) {
+			block++;
+			offset = 0;
+		}
+	}
+
+	return ret < 0 ? -1 : (int) len;
+}
+
+/**
+ * Read the calibration pattern: the ID bytes followed by the start of the
+ * page loaded in the cache, read with the configured I/O mode.
+ *
+ * @param spi Pointer to the sunxi_spi_t structure.
+ * @param buf Pointer to the buffer to store the pattern.
+ */
+static void spi_nand_calib_read(sunxi_spi_t *spi, uint8_t *buf) {
+	uint8_t tx = OPCODE_READ_ID;
+	uint32_t txlen;
+	int read_opcode;
+
+	sunxi_spi_transfer(spi, SPI_IO_SINGLE, &tx, 1, buf, SPI_NAND_CALIB_ID_LEN);
+
+	read_opcode = spi_nand_get_read_opcode(&txlen);
+	if (read_opcode >= 0)
+		spi_nand_read_from_cache(spi, read_opcode, txlen, 0, 0, buf + SPI_NAND_CALIB_ID_LEN, SPI_NAND_CALIB_DATA_LEN);
+}
+
+/**
+ * Pattern check for sunxi_spi_calibrate().
+ *
+ * @param spi Pointer to the sunxi_spi_t structure.
+ * @param arg Unused.
+ * @return 0 if the pattern matches the reference, -1 otherwise.
+ */
+static int spi_nand_calib_check(sunxi_spi_t *spi, void *arg) {
+	memset(calib_buf, 0, sizeof(calib_buf));
+	spi_nand_calib_read(spi, calib_buf);
+
+	return memcmp(calib_buf, calib_ref, sizeof(calib_ref)) ? -1 : 0;
+}
+
+uint32_t spi_nand_calibrate(sunxi_spi_t *spi, uint32_t max_clk) {
+	uint32_t freq;
+	uint8_t otp = 0;
+
+	/* Winbond continuous mode moves on to the next page, keep the page in the buffer */
+	if (info.id.mfr == SPI_NAND_MFR_WINBOND) {
+		spi_nand_get_config(spi, CONFIG_ADDR_OTP, &otp);
+		spi_nand_set_config(spi, CONFIG_ADDR_OTP, otp | CONFIG_POS_BUF);
+		spi_nand_wait_while_busy(spi);
+	}
+
+	/* The pattern is read from the cache, page 0 only needs loading once */
+	spi_nand_load_page(spi, 0);
+	spi_nand_calib_read(spi, calib_ref);
+
+	freq = sunxi_spi_calibrate(spi, max_clk, spi_nand_calib_check, NULL);
+
+	if (info.id.mfr == SPI_NAND_MFR_WINBOND) {
+		spi_nand_set_config(spi, CONFIG_ADDR_OTP, otp);
+		spi_nand_wait_while_busy(spi);
+	}
+
+	return freq;
 }
@@ -18,8 +18,27 @@
 #include <sys-spi-nor.h>
 #include <sys-spi.h>
 
+/* Quad Enable Requirements, basic flash parameter table 15th dword bits 22:20 */
+#define SFDP_QER_NONE 0			   /* No QE bit, IO2/IO3 are always data lines */
+#define SFDP_QER_SR2_BIT1_NO_RD 1  /* QE is SR2 bit 1, written as 2nd byte of WRSR, SR2 cannot be read */
+#define SFDP_QER_SR1_BIT6 2		   /* QE is SR1 bit 6 */
+#define SFDP_QER_SR2_BIT7 3		   /* QE is SR2 bit 7, accessed with 0x3f/0x3e */
+#define SFDP_QER_SR2_BIT1 4		   /* QE is SR2 bit 1, written as 2nd byte of WRSR */
+#define SFDP_QER_SR2_BIT1_READ 5   /* QE is SR2 bit 1, read with 0x35 */
+#define SFDP_QER_SR2_BIT1_WRSR2 6  /* QE is SR2 bit 1, written with 0x31 */
+
+/* Maximum mode + dummy bytes sent after the read address */
+#define SPI_NOR_MAX_DUMMY 8
+
+/* Calibration pattern, SFDP header and first parameter header then flash data */
+#define SPI_NOR_CALIB_SFDP_LEN 16
+#define SPI_NOR_CALIB_DATA_LEN 48
+
 static spi_nor_info_t info;
 
+static uint8_t calib_ref[SPI_NOR_CALIB_SFDP_LEN + SPI_NOR_CALIB_DATA_LEN];
+static uint8_t calib_buf[SPI_NOR_CALIB_SFDP_LEN + SPI_NOR_CALIB_DATA_LEN];
+
 static const spi_nor_info_t spi_nor_info_table[] = {
 		{"W25X40", 0xef3013, 512 * 1024, 4096, 1, 256, 3, NOR_OPCODE_READ, NOR_OPCODE_PROG, NOR_OPCODE_WREN, NOR_OPCODE_E4K, 0, NOR_OPCODE_E64K, 0},
 		{"W25Q128JVEIQ", 0xefc018, 16 * 1024 * 1024, 4096, 1, 256, 3, NOR_OPCODE_READ, NOR_OPCODE_PROG, NOR_OPCODE_WREN, NOR_OPCODE_E4K, NOR_OPCODE_E32K, NOR_OPCODE_E64K, 0},
@@ -122,7 +141,7 @@ static inline int spi_nor_read_sfdp(sunxi_spi_t *spi, sfdp_t *sfdp) {
 			tx[2] = (addr >> 8) & 0xff;
 			tx[3] = (addr >> 0) & 0xff;
 			tx[4] = 0x0;
-			if (sunxi_spi_transfer(spi, SPI_IO_SINGLE, tx, 5, &sfdp->basic_table.table[0], sfdp->parameter_header[i].length * 4)) {
+			if (sunxi_spi_transfer(spi, SPI_IO_SINGLE, tx, 5, &sfdp->basic_table.table[0], min(sfdp->parameter_header[i].length * 4, sizeof(sfdp->basic_table.table)))) {
 				sfdp->basic_table.major = sfdp->parameter_header[i].major;
 				sfdp->basic_table.minor = sfdp->parameter_header[i].minor;
 				return 1;
@@ -236,7 +255,182 @@ static inline void spi_nor_chip_reset(sunxi_spi_t *spi) {
  * @param spi Pointer to a `sunxi_spi_t` structure representing the SPI device.
  */
 static inline void spi_nor_set_write_enable(sunxi_spi_t *spi) {
-	sunxi_spi_transfer(spi, SPI_IO_SINGLE, (void *) info.opcode_write_enable, 1, NULL, 0);
+	uint8_t tx = info.opcode_write_enable;
+
+	sunxi_spi_transfer(spi, SPI_IO_SINGLE, &tx, 1, NULL, 0);
+}
+
+/**
+ * @brief Read a one byte register of the SPI NOR Flash chip.
+ * 
+ * @param spi Pointer to a `sunxi_spi_t` structure representing the SPI device.
+ * @param opcode The register read opcode, e.g. RDSR or RDSR2.
+ * 
+ * @return The register value.
+ */
+static inline uint8_t spi_nor_read_reg(sunxi_spi_t *spi, uint8_t opcode) {
+	uint8_t rx = 0;
+
+	sunxi_spi_transfer(spi, SPI_IO_SINGLE, &opcode, 1, &rx, 1);
+	return rx;
+}
+
+/**
+ * @brief Get a dword of the SFDP basic flash parameter table.
+ * 
+ * @param sfdp Pointer to the SFDP data read by `spi_nor_read_sfdp`.
+ * @param n The 1-based dword number, as used by JESD216.
+ * 
+ * @return The dword value.
+ */
+static inline uint32_t sfdp_basic_dword(const sfdp_t *sfdp, int n) {
+	const uint8_t *p = &sfdp->basic_table.table[(n - 1) * 4];
+
+	return ((uint32_t) p[3] << 24) | (p[2] << 16) | (p[1] << 8) | (p[0] << 0);
+}
+
+/**
+ * @brief Set the Quad Enable bit of the SPI NOR Flash chip.
+ * 
+ * The location of the QE bit and the way it is written are given by the
+ * Quad Enable Requirements field of the SFDP basic flash parameter table.
+ * The bit is only written if it is not already set, and read back afterwards.
+ * When SR2 cannot be read it is written blindly, with only the QE bit set.
+ * 
+ * @param spi Pointer to a `sunxi_spi_t` structure representing the SPI device.
+ * @param qer The Quad Enable Requirements value (0 to 6).
+ * 
+ * @return 0 if the QE bit is set or not needed, -1 otherwise.
+ */
+static int spi_nor_quad_enable(sunxi_spi_t *spi, uint8_t qer) {
+	uint8_t tx[3];
+	uint8_t rd_opcode, bit, val;
+	uint32_t txlen = 2;
+
+	switch (qer) {
+		case SFDP_QER_NONE:
+			return 0;
+		case SFDP_QER_SR2_BIT1_NO_RD:
+			/* Like Linux spi_nor_sr2_bit1_quad_enable(), no RDSR2 and nothing to check against */
+			tx[0] = NOR_OPCODE_WRSR;
+			tx[1] = spi_nor_read_status_register(spi);
+			tx[2] = BIT(1);
+			spi_nor_set_write_enable(spi);
+			sunxi_spi_transfer(spi, SPI_IO_SINGLE, tx, 3, NULL, 0);
+			spi_nor_wait_for_busy(spi);
+			printk_debug("SPI NOR: QE bit written, qer=%u\n", qer);
+			return 0;
+		case SFDP_QER_SR1_BIT6:
+			rd_opcode = NOR_OPCODE_RDSR;
+			bit = BIT(6);
+			break;
+		case SFDP_QER_SR2_BIT7:
+			rd_opcode = NOR_OPCODE_RDSR2_B7;
+			bit = BIT(7);
+			break;
+		case SFDP_QER_SR2_BIT1:
+		case SFDP_QER_SR2_BIT1_READ:
+		case SFDP_QER_SR2_BIT1_WRSR2:
+			rd_opcode = NOR_OPCODE_RDSR2;
+			bit = BIT(1);
+			break;
+		default:
+			return -1;
+	}
+
+	val = spi_nor_read_reg(spi, rd_opcode);
+	if (val & bit)
+		return 0;
+	val |= bit;
+
+	switch (qer) {
+		case SFDP_QER_SR1_BIT6:
+			tx[0] = NOR_OPCODE_WRSR;
+			tx[1] = val;
+			break;
+		case SFDP_QER_SR2_BIT7:
+			tx[0] = NOR_OPCODE_WRSR2_B7;
+			tx[1] = val;
+			break;
+		case SFDP_QER_SR2_BIT1_WRSR2:
+			tx[0] = NOR_OPCODE_WRSR2;
+			tx[1] = val;
+			break;
+		default:
+			/* SR1 and SR2 are written together, keep SR1 unchanged */
+			tx[0] = NOR_OPCODE_WRSR;
+			tx[1] = spi_nor_read_status_register(spi);
+			tx[2] = val;
+			txlen = 3;
+			break;
+	}
+
+	spi_nor_set_write_enable(spi);
+	sunxi_spi_transfer(spi, SPI_IO_SINGLE, tx, txlen, NULL, 0);
+	spi_nor_wait_for_busy(spi);
+
+	if (!(spi_nor_read_reg(spi, rd_opcode) & bit)) {
+		printk_warning("SPI NOR: failed to set QE bit, qer=%u\n", qer);
+		return -1;
+	}
+
+	printk_debug("SPI NOR: QE bit set, qer=%u\n", qer);
+	return 0;
+}
+
+/**
+ * @brief Pick the fastest read mode advertised by the SFDP basic flash parameter table.
+ * 
+ * Modes are tried in the order 1-4-4, 1-1-4, 1-1-2. Quad modes are only used
+ * when the Quad Enable Requirements are known (table revision 1.5 and later)
+ * and the QE bit could be set. A mode is skipped if its mode and dummy clocks
+ * do not fill whole bytes on the bus, since the controller counts dummy cycles
+ * as transmitted bytes. Falls back to the single line read opcode.
+ * 
+ * @param spi Pointer to a `sunxi_spi_t` structure representing the SPI device.
+ * @param sfdp Pointer to the SFDP data read by `spi_nor_read_sfdp`.
+ */
+static void spi_nor_select_read_mode(sunxi_spi_t *spi, const sfdp_t *sfdp) {
+	uint32_t dw1 = sfdp_basic_dword(sfdp, 1);
+	uint32_t dw3 = sfdp_basic_dword(sfdp, 3);
+	uint32_t dw4 = sfdp_basic_dword(sfdp, 4);
+	uint32_t clocks;
+	int qer = -1;
+
+	info.opcode_read = NOR_OPCODE_READ;
+	info.read_mode = SPI_IO_SINGLE;
+	info.read_dummy = 0;
+
+	if ((sfdp->basic_table.major == 1) && (sfdp->basic_table.minor >= 5))
+		qer = (sfdp_basic_dword(sfdp, 15) >> 20) & 0x7;
+
+	if (qer >= 0) {
+		/* 1-4-4: address, mode and dummy on four lines, two clocks per byte */
+		clocks = ((dw3 >> 0) & 0x1f) + ((dw3 >> 5) & 0x7);
+		if ((dw1 & BIT(21)) && (clocks % 2 == 0) && (clocks / 2 <= SPI_NOR_MAX_DUMMY) && spi_nor_quad_enable(spi, qer) == 0) {
+			info.opcode_read = (dw3 >> 8) & 0xff;
+			info.read_mode = SPI_IO_QUAD_IO;
+			info.read_dummy = clocks / 2;
+			return;
+		}
+
+		/* 1-1-4: address, mode and dummy on one line, eight clocks per byte */
+		clocks = ((dw3 >> 16) & 0x1f) + ((dw3 >> 21) & 0x7);
+		if ((dw1 & BIT(22)) && (clocks % 8 == 0) && (clocks / 8 <= SPI_NOR_MAX_DUMMY) && spi_nor_quad_enable(spi, qer) == 0) {
+			info.opcode_read = (dw3 >> 24) & 0xff;
+			info.read_mode = SPI_IO_QUAD_RX;
+			info.read_dummy = clocks / 8;
+			return;
+		}
+	}
+
+	/* 1-1-2 needs no QE bit */
+	clocks = ((dw4 >> 0) & 0x1f) + ((dw4 >> 5) & 0x7);
+	if ((dw1 & BIT(16)) && (clocks % 8 == 0) && (clocks / 8 <= SPI_NOR_MAX_DUMMY)) {
+		info.opcode_read = (dw4 >> 8) & 0xff;
+		info.read_mode = SPI_IO_DUAL_RX;
+		info.read_dummy = clocks / 8;
+	}
 }
 
 
@@ -382,7 +576,7 @@ static inline int spi_nor_get_info(sunxi_spi_t *spi) {
 
 		info.opcode_write_enable = NOR_OPCODE_WREN;
 		info.read_granularity = 1;
-		info.opcode_read = NOR_OPCODE_READ;
+		spi_nor_select_read_mode(spi, &sfdp);
 
 		if ((sfdp.basic_table.major == 1) && (sfdp.basic_table.minor < 5)) {
 			/* Basic flash parameter table 1th dword */
@@ -436,28 +630,33 @@ static inline int spi_nor_get_info(sunxi_spi_t *spi) {
  * and the read opcode to the SPI NOR. The data is then transferred to 
  * the provided buffer. The function supports 3-byte or 4-byte address
  * modes, but any other address length is not supported.
+ *
+ * The opcode, the I/O mode and the number of mode/dummy bytes following
+ * the address are those picked from SFDP by `spi_nor_select_read_mode`.
  */
 static void spi_nor_read_bytes(sunxi_spi_t *spi, uint32_t addr, uint8_t *buf, uint32_t count) {
-	uint8_t tx[5];
+	uint8_t tx[5 + SPI_NOR_MAX_DUMMY];
+	uint32_t txlen = 0;
+
+	tx[txlen++] = info.opcode_read;
 	switch (info.address_length) {
 		case 3:
-			tx[0] = info.opcode_read;
-			tx[1] = (uint8_t) (addr >> 16);
-			tx[2] = (uint8_t) (addr >> 8);
-			tx[3] = (uint8_t) (addr >> 0);
-			sunxi_spi_transfer(spi, SPI_IO_SINGLE, tx, 4, buf, count);
 			break;
 		case 4:
-			tx[0] = info.opcode_read;
-			tx[1] = (uint8_t) (addr >> 24);
-			tx[2] = (uint8_t) (addr >> 16);
-			tx[3] = (uint8_t) (addr >> 8);
-			tx[4] = (uint8_t) (addr >> 0);
-			sunxi_spi_transfer(spi, SPI_IO_SINGLE, tx, 5, buf, count);
+			tx[txlen++] = (uint8_t) (addr >> 24);
 			break;
 		default:
-			break;
+			return;
 	}
+	tx[txlen++] = (uint8_t) (addr >> 16);
+	tx[txlen++] = (uint8_t) (addr >> 8);
+	tx[txlen++] = (uint8_t) (addr >> 0);
+
+	/* Mode bits are sent as zero, so the chip never enters continuous read */
+	memset(&tx[txlen], 0, info.read_dummy);
+	txlen += info.read_dummy;
+
+	sunxi_spi_transfer(spi, info.read_mode, tx, txlen, buf, count);
 }
 
 /**
@@ -493,6 +692,7 @@ int spi_nor_detect(sunxi_spi_t *spi) {
 	}
 
 	printk_info("SPI NOR: detect spi nor id=0x%06x capacity=%dMB\n", info.id, info.capacity / 1024 / 1024);
+	printk_debug("SPI NOR: read opcode=0x%02x mode=%u dummy=%u\n", info.opcode_read, info.read_mode, info.read_dummy);
 
 	return 0;
 }
@@ -613,3 +813,45 @@ uint32_t spi_nor_read(sunxi_spi_t *spi, uint8_t *buf, uint32_t addr, uint32_t rx
 	}
 	return ret;
 }
+
+/**
+ * @brief Reads the calibration pattern.
+ *
+ * The pattern is the SFDP header and parameter headers, read in single mode,
+ * followed by the start of the flash read with the selected fast read mode.
+ *
+ * @param spi Pointer to the SPI interface structure.
+ * @param buf Buffer to store the pattern.
+ */
+static void spi_nor_calib_read(sunxi_spi_t *spi, uint8_t *buf) {
+	uint8_t tx[5] = {NOR_OPCODE_SFDP, 0x0, 0x0, 0x0, 0x0};
+
+	sunxi_spi_transfer(spi, SPI_IO_SINGLE, tx, 5, buf, SPI_NOR_CALIB_SFDP_LEN);
+	spi_nor_read_bytes(spi, 0, buf + SPI_NOR_CALIB_SFDP_LEN, SPI_NOR_CALIB_DATA_LEN);
+}
+
+/**
+ * @brief Pattern check for `sunxi_spi_calibrate`.
+ *
+ * @param spi Pointer to the SPI interface structure.
+ * @param arg Unused.
+ *
+ * @return 0 if the pattern matches the reference, -1 otherwise.
+ */
+static int spi_nor_calib_check(sunxi_spi_t *spi, void *arg) {
+	memset(calib_buf, 0, sizeof(calib_buf));
+	spi_nor_calib_read(spi, calib_buf);
+
+	return memcmp(calib_buf, calib_ref, sizeof(calib_ref)) ? -1 : 0;
+}
+
+uint32_t spi_nor_calibrate(sunxi_spi_t *spi, uint32_t max_clk) {
+	spi_nor_calib_read(spi, calib_ref);
+
+	if (calib_ref[0] != 'S' || calib_ref[1] != 'F' || calib_ref[2] != 'D' || calib_ref[3] != 'P') {
+		printk_warning("SPI NOR: no SFDP header, skip calibration\n");
+		return 0;
+	}
+
+	return sunxi_spi_calibrate(spi, max_clk, spi_nor_calib_check, NULL);
+}
@@ -7,14 +7,31 @@
 #include <stdint.h>
 #include <types.h>
 
+#include <cache.h>
 #include <log.h>
+#include <string.h>
+#include <timer.h>
 
 #include <sys-dma.h>
 
+#if defined(CONFIG_CHIP_GIC) && defined(AW_IRQ_DMA)
+#include <interrupt.h>
+#include <sys-intc.h>
+#define SUNXI_DMA_SCHED_IRQ
+#endif
+
 #ifndef SUNXI_DMA_MAX
 #define SUNXI_DMA_MAX 4
 #endif
 
+#ifndef SUNXI_DMA_DESC_POOL
+#define SUNXI_DMA_DESC_POOL 32
+#endif
+
+/* Address mode bits of a descriptor config word */
+#define DMA_CFG_SRC_IO_MODE (1U << 8)
+#define DMA_CFG_DST_IO_MODE (1U << 24)
+
 static int dma_int_cnt = 0;
 
 static int dma_init_ok = -1;
@@ -23,8 +40,38 @@ static sunxi_dma_source_t dma_channel_source[SUNXI_DMA_MAX];
 
 static sunxi_dma_desc_t dma_channel_desc[SUNXI_DMA_MAX] __attribute__((aligned(64)));
 
+static sunxi_dma_desc_t dma_desc_pool[SUNXI_DMA_DESC_POOL] __attribute__((aligned(64)));
+
+static uint32_t dma_desc_used[(SUNXI_DMA_DESC_POOL + 31) / 32];
+
+static uint32_t dma_fill_pattern[SUNXI_DMA_MAX] __attribute__((aligned(64)));
+
+static sunxi_dma_req_t *dma_sched_running[SUNXI_DMA_MAX];
+
+static sunxi_dma_req_t *dma_sched_head, *dma_sched_tail;
+
 static uint32_t DMA_REG_BASE = 0x0;
 
+#ifdef SUNXI_DMA_SCHED_IRQ
+static void sunxi_dma_irq_handler(void *data);
+
+static inline uint32_t dma_sched_lock(void) {
+	return arm32_interrupt_save();
+}
+
+static inline void dma_sched_unlock(uint32_t flags) {
+	arm32_interrupt_restore(flags);
+}
+#else
+static inline uint32_t dma_sched_lock(void) {
+	return 0;
+}
+
+static inline void dma_sched_unlock(uint32_t flags) {
+	(void) flags;
+}
+#endif
+
 void sunxi_dma_clk_init(sunxi_dma_t *dma) {
 	/* DMA : mbus clock gating */
 	setbits_le32(dma->bus_clk.gate_reg_base, BIT(dma->bus_clk.gate_reg_offset));
@@ -56,6 +103,9 @@ void sunxi_dma_init(sunxi_dma_t *dma) {
 	dma_reg->auto_gate |= 0x7 << 0;
 
 	memset((void *) dma_channel_source, 0, SUNXI_DMA_MAX * sizeof(sunxi_dma_source_t));
+	memset(dma_desc_used, 0, sizeof(dma_desc_used));
+	memset(dma_sched_running, 0, sizeof(dma_sched_running));
+	dma_sched_head = dma_sched_tail = NULL;
 
 	for (i = 0; i < SUNXI_DMA_MAX; i++) {
 		dma_channel_source[i].used = 0;
@@ -66,6 +116,11 @@ void sunxi_dma_init(sunxi_dma_t *dma) {
 	dma_int_cnt = 0;
 	dma_init_ok = 1;
 
+#ifdef SUNXI_DMA_SCHED_IRQ
+	irq_install_handler(AW_IRQ_DMA, sunxi_dma_irq_handler, NULL);
+	irq_enable(AW_IRQ_DMA);
+#endif
+
 	return;
 }
 
@@ -84,6 +139,11 @@ void sunxi_dma_exit(sunxi_dma_t *dma) {
 		}
 	}
 
+#ifdef SUNXI_DMA_SCHED_IRQ
+	irq_disable(AW_IRQ_DMA);
+	irq_free_handler(AW_IRQ_DMA);
+#endif
+
 	/* close dma clock when dma exit */
 	dma_reg->auto_gate &= ~(1 << dma->dma_clk.gate_reg_offset | 1 << dma->dma_clk.rst_reg_offset);
 
@@ -96,43 +156,91 @@ void sunxi_dma_exit(sunxi_dma_t *dma) {
 	dma_init_ok--;
 }
 
+/* The pool is also used from the DMA interrupt, bitmap updates run with it masked */
+static sunxi_dma_desc_t *sunxi_dma_desc_alloc(void) {
+	uint32_t flags = dma_sched_lock();
+
+	for (int i = 0; i < SUNXI_DMA_DESC_POOL; i++) {
+		if (!(dma_desc_used[i / 32] & (1U << (i % 32)))) {
+			dma_desc_used[i / 32] |= 1U << (i % 32);
+			dma_sched_unlock(flags);
+			return &dma_desc_pool[i];
+		}
+	}
+
+	dma_sched_unlock(flags);
+
+	return NULL;
+}
+
+static void sunxi_dma_desc_free_chain(sunxi_dma_desc_t *desc) {
+	uint32_t flags = dma_sched_lock();
+
+	while (desc != NULL) {
+		uint32_t i = desc - dma_desc_pool;
+
+		dma_desc_used[i / 32] &= ~(1U << (i % 32));
+		desc = (desc->link == SUNXI_DMA_LINK_NULL) ? NULL : (sunxi_dma_desc_t *) desc->link;
+	}
+
+	dma_sched_unlock(flags);
+}
+
+/* Channels are also requested and released by the scheduler from the DMA interrupt */
 uint32_t sunxi_dma_request_from_last(uint32_t dmatype) {
+	uint32_t flags = dma_sched_lock();
+
 	for (int i = SUNXI_DMA_MAX - 1; i >= 0; i--) {
 		if (dma_channel_source[i].used == 0) {
 			dma_channel_source[i].used = 1;
 			dma_channel_source[i].channel_count = i;
+			dma_sched_unlock(flags);
 			return (uint32_t) &dma_channel_source[i];
 		}
 	}
 
+	dma_sched_unlock(flags);
+
 	return 0;
 }
 
 uint32_t sunxi_dma_request(uint32_t dmatype) {
+	uint32_t flags = dma_sched_lock();
+
 	for (int i = 0; i < SUNXI_DMA_MAX; i++) {
 		if (dma_channel_source[i].used == 0) {
 			dma_channel_source[i].used = 1;
 			dma_channel_source[i].channel_count = i;
+			dma_sched_unlock(flags);
 			printk_debug("DMA: provide channel %u\n", i);
 			return (uint32_t) &dma_channel_source[i];
 		}
 	}
 
+	dma_sched_unlock(flags);
+
 	return 0;
 }
 
 int sunxi_dma_release(uint32_t dma_fd) {
 	sunxi_dma_source_t *dma_source = (sunxi_dma_source_t *) dma_fd;
+	uint32_t flags = dma_sched_lock();
 
 	if (!dma_source->used) {
+		dma_sched_unlock(flags);
 		return -1;
 	}
 
 	sunxi_dma_disable_int(dma_fd);
 	sunxi_dma_free_int(dma_fd);
 
+	sunxi_dma_desc_free_chain(dma_source->chain);
+	dma_source->chain = NULL;
+
 	dma_source->used = 0;
 
+	dma_sched_unlock(flags);
+
 	return 0;
 }
 
@@ -147,7 +255,7 @@ int sunxi_dma_setting(uint32_t dma_fd, sunxi_dma_set_t *cfg) {
 		return -1;
 
 	if (dma_set->loop_mode)
-		desc->link = (uint32_t) (&dma_source->desc);
+		desc->link = (uint32_t) desc;
 	else
 		desc->link = SUNXI_DMA_LINK_NULL;
 
@@ -172,6 +280,7 @@ int sunxi_dma_start(uint32_t dma_fd, uint32_t saddr, uint32_t daddr, uint32_t by
 	desc->source_addr = saddr;
 	desc->dest_addr = daddr;
 	desc->byte_count = bytes;
+	flush_dcache_range((uint32_t) desc, (uint32_t) (desc + 1));
 
 	/* start dma */
 	channel->desc_addr = (uint32_t) desc;
@@ -180,6 +289,60 @@ int sunxi_dma_start(uint32_t dma_fd, uint32_t saddr, uint32_t daddr, uint32_t by
 	return 0;
 }
 
+int sunxi_dma_start_sg(uint32_t dma_fd, const sunxi_dma_sg_t *sg, uint32_t count) {
+	sunxi_dma_source_t *dma_source = (sunxi_dma_source_t *) dma_fd;
+	sunxi_dma_channel_reg_t *channel = dma_source->channel;
+	sunxi_dma_desc_t *tmpl = dma_source->desc;
+	sunxi_dma_desc_t *head = NULL, *prev = NULL, *desc;
+	uint32_t offset, n;
+
+	if (!dma_source->used || count == 0)
+		return -1;
+
+	sunxi_dma_desc_free_chain(dma_source->chain);
+	dma_source->chain = NULL;
+
+	for (uint32_t i = 0; i < count; i++) {
+		for (offset = 0; offset < sg[i].len; offset += n) {
+			n = min(sg[i].len - offset, (uint32_t) SUNXI_DMA_DESC_MAX_BYTES);
+
+			desc = sunxi_dma_desc_alloc();
+			if (desc == NULL) {
+				printk_error("DMA: descriptor pool exhausted\n");
+				sunxi_dma_desc_free_chain(head);
+				return -1;
+			}
+
+			desc->config = tmpl->config;
+			desc->commit_para = tmpl->commit_para;
+			desc->source_addr = sg[i].src + ((tmpl->config & DMA_CFG_SRC_IO_MODE) ? 0 : offset);
+			desc->dest_addr = sg[i].dst + ((tmpl->config & DMA_CFG_DST_IO_MODE) ? 0 : offset);
+			desc->byte_count = n;
+			desc->link = SUNXI_DMA_LINK_NULL;
+
+			if (prev)
+				prev->link = (uint32_t) desc;
+			else
+				head = desc;
+			prev = desc;
+		}
+	}
+
+	if (head == NULL)
+		return -1;
+
+	/* The controller fetches the descriptors from memory */
+	flush_dcache_range((uint32_t) dma_desc_pool, (uint32_t) (dma_desc_pool + SUNXI_DMA_DESC_POOL));
+
+	dma_source->chain = head;
+
+	/* start dma */
+	channel->desc_addr = (uint32_t) head;
+	channel->enable = 1;
+
+	return 0;
+}
+
 int sunxi_dma_stop(uint32_t dma_fd) {
 	sunxi_dma_source_t *dma_source = (sunxi_dma_source_t *) dma_fd;
 	sunxi_dma_channel_reg_t *channel = dma_source->channel;
@@ -188,6 +351,9 @@ int sunxi_dma_stop(uint32_t dma_fd) {
 		return -1;
 	channel->enable = 0;
 
+	sunxi_dma_desc_free_chain(dma_source->chain);
+	dma_source->chain = NULL;
+
 	return 0;
 }
 
@@ -268,13 +434,13 @@ int sunxi_dma_disable_int(uint32_t dma_fd) {
 	channel_count = dma_source->channel_count;
 	if (channel_count < 8) {
 		if (!((dma_reg->irq_en0) & (DMA_PKG_END_INT << channel_count * 4))) {
-			printk_debug("DMA: 0x%08x int is not used yet\n", dma_fd);
+			printk_trace("DMA: 0x%08x int is not used yet\n", dma_fd);
 			return 0;
 		}
 		dma_reg->irq_en0 &= ~(DMA_PKG_END_INT << channel_count * 4);
 	} else {
 		if (!((dma_reg->irq_en1) & (DMA_PKG_END_INT << (channel_count - 8) * 4))) {
-			printk_debug("DMA: 0x%08x int is not used yet\n", dma_fd);
+			printk_trace("DMA: 0x%08x int is not used yet\n", dma_fd);
 			return 0;
 		}
 		dma_reg->irq_en1 &= ~(DMA_PKG_END_INT << (channel_count - 8) * 4);
@@ -297,15 +463,15 @@ int sunxi_dma_free_int(uint32_t dma_fd) {
 
 	channel_count = dma_source->channel_count;
 	if (channel_count < 8)
-		dma_reg->irq_pending0 = (7 << channel_count);
+		dma_reg->irq_pending0 = (7 << channel_count * 4);
 	else
-		dma_reg->irq_pending1 = (7 << (channel_count - 8));
+		dma_reg->irq_pending1 = (7 << (channel_count - 8) * 4);
 
 	if (dma_source->dma_func.m_func) {
 		dma_source->dma_func.m_func = NULL;
 		dma_source->dma_func.m_data = NULL;
 	} else {
-		printk_debug("DMA: 0x%08x int is free, you do not need to free it again\n", dma_fd);
+		printk_trace("DMA: 0x%08x int is free, you do not need to free it again\n", dma_fd);
 		return -1;
 	}
 
@@ -313,6 +479,224 @@ int sunxi_dma_free_int(uint32_t dma_fd) {
 }
 
 
+static uint32_t dma_memcpy_start(uint32_t dst, uint32_t src, uint32_t len, bool fill) {
+	sunxi_dma_set_t dma_set;
+	sunxi_dma_sg_t sg;
+	uint32_t dma_fd;
+	bool word = !((dst | (fill ? 0 : src) | len) & 0x3);
+
+	if (dma_init_ok <= 0 || len == 0)
+		return 0;
+
+	dma_set.loop_mode = 0;
+	dma_set.wait_cyc = 8;
+	dma_set.data_block_size = 1 * 32 / 8;
+	/* channel config (from dram to dram)*/
+	dma_set.channel_cfg.src_drq_type = DMAC_CFG_TYPE_DRAM;
+	dma_set.channel_cfg.src_addr_mode = fill ? DMAC_CFG_SRC_ADDR_TYPE_IO_MODE : DMAC_CFG_SRC_ADDR_TYPE_LINEAR_MODE;
+	dma_set.channel_cfg.src_burst_length = DMAC_CFG_SRC_8_BURST;
+	dma_set.channel_cfg.src_data_width = word ? DMAC_CFG_SRC_DATA_WIDTH_32BIT : DMAC_CFG_SRC_DATA_WIDTH_8BIT;
+	dma_set.channel_cfg.reserved0 = 0;
+
+	dma_set.channel_cfg.dst_drq_type = DMAC_CFG_TYPE_DRAM;
+	dma_set.channel_cfg.dst_addr_mode = DMAC_CFG_DEST_ADDR_TYPE_LINEAR_MODE;
+	dma_set.channel_cfg.dst_burst_length = DMAC_CFG_DEST_8_BURST;
+	dma_set.channel_cfg.dst_data_width = word ? DMAC_CFG_DEST_DATA_WIDTH_32BIT : DMAC_CFG_DEST_DATA_WIDTH_8BIT;
+	dma_set.channel_cfg.reserved1 = 0;
+
+	dma_fd = sunxi_dma_request(DMAC_DMATYPE_NORMAL);
+	if (!dma_fd)
+		return 0;
+
+	sunxi_dma_setting(dma_fd, &dma_set);
+
+	if (fill) {
+		/* Each channel has its own pattern word, the controller reads it over and over */
+		uint32_t *pattern = &dma_fill_pattern[((sunxi_dma_source_t *) dma_fd)->channel_count];
+
+		*pattern = (src & 0xff) * 0x01010101;
+		src = (uint32_t) pattern;
+		flush_dcache_range(src, src + 4);
+	} else {
+		flush_dcache_range(src, src + len);
+	}
+	flush_dcache_range(dst, dst + len);
+
+	sg.src = src;
+	sg.dst = dst;
+	sg.len = len;
+	if (sunxi_dma_start_sg(dma_fd, &sg, 1)) {
+		sunxi_dma_release(dma_fd);
+		return 0;
+	}
+
+	return dma_fd;
+}
+
+uint32_t dma_memcpy_async(void *dst, const void *src, uint32_t len) {
+	return dma_memcpy_start((uint32_t) dst, (uint32_t) src, len, false);
+}
+
+uint32_t dma_memset_async(void *dst, uint8_t c, uint32_t len) {
+	return dma_memcpy_start((uint32_t) dst, c, len, true);
+}
+
+int dma_memcpy_wait(uint32_t dma_fd) {
+	sunxi_dma_source_t *dma_source = (sunxi_dma_source_t *) dma_fd;
+	sunxi_dma_desc_t *desc;
+
+	if (!dma_source->used)
+		return -1;
+
+	while (sunxi_dma_querystatus(dma_fd) == 1)
+		;
+
+	/* Drop lines the CPU may have prefetched while the copy was running */
+	for (desc = dma_source->chain; desc != NULL; desc = (desc->link == SUNXI_DMA_LINK_NULL) ? NULL : (sunxi_dma_desc_t *) desc->link)
+		invalidate_dcache_range(desc->dest_addr, desc->dest_addr + desc->byte_count);
+
+	sunxi_dma_stop(dma_fd);
+	sunxi_dma_release(dma_fd);
+
+	return 0;
+}
+
+int dma_memcpy(void *dst, const void *src, uint32_t len) {
+	uint32_t dma_fd = dma_memcpy_async(dst, src, len);
+
+	if (!dma_fd) {
+		memcpy(dst, src, len);
+		return 1;
+	}
+
+	return dma_memcpy_wait(dma_fd);
+}
+
+static inline void sunxi_dma_sched_irq_set(uint32_t channel_count, bool on) {
+	sunxi_dma_reg_t *dma_reg = (sunxi_dma_reg_t *) DMA_REG_BASE;
+	volatile uint32_t *irq_en = channel_count < 8 ? &dma_reg->irq_en0 : &dma_reg->irq_en1;
+	uint32_t bit = DMA_QUEUE_END_INT << ((channel_count % 8) * 4);
+
+	if (on)
+		*irq_en |= bit;
+	else
+		*irq_en &= ~bit;
+}
+
+static inline void sunxi_dma_sched_irq_clear(uint32_t channel_count) {
+	sunxi_dma_reg_t *dma_reg = (sunxi_dma_reg_t *) DMA_REG_BASE;
+
+	if (channel_count < 8)
+		dma_reg->irq_pending0 = 7 << (channel_count * 4);
+	else
+		dma_reg->irq_pending1 = 7 << ((channel_count - 8) * 4);
+}
+
+static int sunxi_dma_sched_start(sunxi_dma_req_t *req) {
+	uint32_t dma_fd = sunxi_dma_request(DMAC_DMATYPE_NORMAL);
+	uint32_t channel_count;
+
+	if (!dma_fd)
+		return -1;
+
+	channel_count = ((sunxi_dma_source_t *) dma_fd)->channel_count;
+
+	sunxi_dma_setting(dma_fd, &req->cfg);
+	sunxi_dma_sched_irq_clear(channel_count);
+	sunxi_dma_sched_irq_set(channel_count, true);
+
+	req->dma_fd = dma_fd;
+	dma_sched_running[channel_count] = req;
+
+	/* A pool shortage is only temporary, keep the request queued */
+	if (sunxi_dma_start_sg(dma_fd, req->sg, req->count)) {
+		dma_sched_running[channel_count] = NULL;
+		req->dma_fd = 0;
+		sunxi_dma_sched_irq_set(channel_count, false);
+		sunxi_dma_release(dma_fd);
+		return -1;
+	}
+
+	return 0;
+}
+
+int sunxi_dma_submit(sunxi_dma_req_t *req) {
+	uint32_t flags;
+
+	if (dma_init_ok <= 0 || req->busy || req->sg == NULL || req->count == 0)
+		return -1;
+
+	flags = dma_sched_lock();
+
+	req->busy = true;
+	req->dma_fd = 0;
+	req->next = NULL;
+
+	/* Keep the submission order, nothing overtakes queued requests */
+	if (dma_sched_head != NULL || sunxi_dma_sched_start(req)) {
+		if (dma_sched_tail)
+			dma_sched_tail->next = req;
+		else
+			dma_sched_head = req;
+		dma_sched_tail = req;
+		printk_trace("DMA: request 0x%08x queued\n", (uint32_t) req);
+	}
+
+	dma_sched_unlock(flags);
+
+	return 0;
+}
+
+void sunxi_dma_sched_poll(void) {
+	sunxi_dma_req_t *req;
+	uint32_t flags, dma_fd;
+
+	flags = dma_sched_lock();
+
+	for (uint32_t i = 0; i < SUNXI_DMA_MAX; i++) {
+		req = dma_sched_running[i];
+		if (req == NULL || sunxi_dma_querystatus(req->dma_fd) == 1)
+			continue;
+
+		dma_fd = req->dma_fd;
+		dma_sched_running[i] = NULL;
+		sunxi_dma_sched_irq_set(i, false);
+		sunxi_dma_sched_irq_clear(i);
+		sunxi_dma_stop(dma_fd);
+		sunxi_dma_release(dma_fd);
+
+		req->dma_fd = 0;
+		req->busy = false;
+		if (req->done)
+			req->done(req, req->arg);
+	}
+
+	while (dma_sched_head != NULL && !sunxi_dma_sched_start(dma_sched_head)) {
+		dma_sched_head = dma_sched_head->next;
+		if (dma_sched_head == NULL)
+			dma_sched_tail = NULL;
+	}
+
+	dma_sched_unlock(flags);
+}
+
+void sunxi_dma_wait(sunxi_dma_req_t *req) {
+	while (req->busy)
+		sunxi_dma_sched_poll();
+}
+
+#ifdef SUNXI_DMA_SCHED_IRQ
+static void sunxi_dma_irq_handler(void *data) {
+	sunxi_dma_reg_t *dma_reg = (sunxi_dma_reg_t *) DMA_REG_BASE;
+
+	/* Channels outside the scheduler do not enable their interrupt, ack them anyway */
+	dma_reg->irq_pending0 = dma_reg->irq_pending0 & dma_reg->irq_en0;
+	dma_reg->irq_pending1 = dma_reg->irq_pending1 & dma_reg->irq_en1;
+
+	sunxi_dma_sched_poll();
+}
+#endif
+
 int sunxi_dma_test(uint32_t *src_addr, uint32_t *dst_addr, uint32_t len) {
 	sunxi_dma_set_t dma_set;
 	uint32_t st = 0;
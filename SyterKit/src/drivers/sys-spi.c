@@ -9,32 +9,67 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 #include <types.h>
 
 #include <timer.h>
 
+#include <cache.h>
+#include <common.h>
 #include <log.h>
 
 #include <sys-spi.h>
 
-/* DMA Handler */
+#define SPI_DMA_LINE 32 /* Data cache line size */
+
+/* DMA requests */
 /**
- * @brief DMA configuration structure for SPI RX (Receive)
+ * @brief DMA scheduler request for SPI RX (Receive)
  * 
- * This structure is used for configuring the Direct Memory Access (DMA) 
- * controller for SPI data reception. It is placed in the section ".data" 
- * of the memory.
+ * SPI does not own a DMA channel. Each DMA reception is submitted to the
+ * DMA channel scheduler, which picks a free channel and releases it when
+ * the transfer is done. It is placed in the section ".data" of the memory.
  */
-static __attribute__((section(".data"))) sunxi_dma_set_t spi_rx_dma;
+static __attribute__((section(".data"))) sunxi_dma_req_t spi_rx_req;
+static __attribute__((section(".data"))) sunxi_dma_sg_t spi_rx_sg[3];
 
 /**
- * @brief DMA handler for SPI
+ * @brief Bounce lines for the partial cache lines at both ends of a reception
  * 
- * This variable holds the DMA handler for SPI operations. It is used to
- * manage the DMA transfer during SPI communication. It is initialized to 0
- * by default.
+ * Invalidating a line the buffer only partly covers would drop whatever the
+ * CPU wrote next to it, so those bytes are received here and copied out.
  */
-static uint32_t spi_dma_handler = 0;
+static __attribute__((section(".data"))) uint8_t spi_rx_edge[2][SPI_DMA_LINE] __attribute__((aligned(SPI_DMA_LINE)));
+
+/**
+ * @brief DMA scheduler request for SPI TX (Transmit)
+ */
+static __attribute__((section(".data"))) sunxi_dma_req_t spi_tx_req;
+static __attribute__((section(".data"))) sunxi_dma_sg_t spi_tx_sg;
+
+/**
+ * @brief The DMA requests are configured, SPI falls back to PIO otherwise
+ */
+static bool spi_dma_ready = false;
+
+/**
+ * @brief State of the transfer in flight
+ * 
+ * Only one transfer can be in flight at a time, it is started by
+ * `sunxi_spi_transfer_async` and finished by `sunxi_spi_transfer_poll`.
+ */
+static struct {
+	sunxi_spi_t *spi;		  /**< Controller running the transfer, NULL when idle */
+	uint8_t *rxbuf;			  /**< Reception buffer */
+	uint32_t rxlen;			  /**< Reception length */
+	uint32_t rx_head;		  /**< DMA reception bytes before the first whole cache line */
+	uint32_t rx_tail;		  /**< DMA reception bytes after the last whole cache line */
+	uint32_t txlen;			  /**< Transmission length */
+	bool rx_dma;			  /**< Reception goes through DMA */
+	bool tx_dma;			  /**< Transmission goes through DMA */
+	sunxi_spi_xfer_cb_t done; /**< Completion callback */
+	void *arg;				  /**< Completion callback argument */
+} spi_xfer;
 
 
 /**
@@ -415,43 +450,101 @@ static void sunxi_spi_write_tx_fifo(sunxi_spi_t *spi, uint8_t *buf, uint32_t len
 }
 
 /**
- * @brief Perform SPI data reception using DMA
+ * @brief Start SPI data reception using DMA
  * 
- * This function initiates a DMA transfer to read data from the SPI receive FIFO into
- * a provided buffer. It enables the DMA receive request and starts the DMA transfer. 
- * The function waits until the DMA transfer is complete before returning.
+ * This function enables the DMA receive request and starts a DMA transfer
+ * from the SPI receive FIFO into the provided buffer, without waiting for it
+ * to complete. The whole cache lines of the buffer are received in place,
+ * after being cleaned and invalidated from the data cache so no dirty line
+ * can be written back over the received data. The partial lines at both
+ * ends go through `spi_rx_edge` and are copied out when the transfer is
+ * finished. The buffer has to be word aligned, the DMA moves whole words.
  * 
  * @param[in] spi A pointer to the SPI structure, which contains the base address
  *                of the SPI controller's registers.
  * @param[out] buf A pointer to the buffer where received data will be stored.
  * @param[in] len The number of bytes to read from the SPI receive FIFO.
  * 
- * @note This function uses DMA for data transfer, so it requires the DMA controller
- *       to be set up and ready to handle the transfer. The DMA handler `spi_dma_handler`
- *       must be initialized properly before calling this function.
- * 
- * @warning If the DMA transfer fails, a warning message will be printed using
- *          `printk_warning`.
+ * @return 0 on success, -1 if the DMA transfer could not be started.
  */
-static void sunxi_spi_read_by_dma(sunxi_spi_t *spi, uint8_t *buf, uint32_t len) {
+static int sunxi_spi_start_rx_dma(sunxi_spi_t *spi, uint8_t *buf, uint32_t len) {
 	sunxi_spi_reg_t *spi_reg = (sunxi_spi_reg_t *) spi->base;
-	uint8_t ret = 0x0;
+	uint32_t head, tail, body, count = 0;
 
-	// Initialize the buffer to zero
-	memset(buf, 0x0, len);
+	if ((uint32_t) buf & 0x3)
+		return -1;
+
+	head = min(-(uint32_t) buf & (SPI_DMA_LINE - 1), len);
+	tail = ((uint32_t) buf + len) & (SPI_DMA_LINE - 1);
+	if (head + tail > len)
+		tail = 0; /**< The buffer sits inside one line */
+	body = len - head - tail;
+
+	spi_xfer.rx_head = head;
+	spi_xfer.rx_tail = tail;
+
+	if (head) {
+		spi_rx_sg[count].dst = (uint32_t) spi_rx_edge[0];
+		spi_rx_sg[count++].len = head;
+	}
+	if (body) {
+		flush_dcache_range((uint32_t) buf + head, (uint32_t) buf + head + body);
+		spi_rx_sg[count].dst = (uint32_t) buf + head;
+		spi_rx_sg[count++].len = body;
+	}
+	if (tail) {
+		spi_rx_sg[count].dst = (uint32_t) spi_rx_edge[1];
+		spi_rx_sg[count++].len = tail;
+	}
+	if (head || tail)
+		flush_dcache_range((uint32_t) spi_rx_edge, (uint32_t) (spi_rx_edge + 2));
+
+	for (uint32_t i = 0; i < count; i++)
+		spi_rx_sg[i].src = (uint32_t) &spi_reg->rxdata;
+	spi_rx_req.count = count;
 
 	// Enable the RX DMA request in the FIFO control register
 	spi_reg->fifo_ctl |= SPI_FIFO_CTL_RX_DRQEN;
 
-	// Start the DMA transfer
-	ret = sunxi_dma_start(spi_dma_handler, (uint32_t) &spi_reg->rxdata, (uint32_t) buf, len);
-	if (ret) {
+	if (sunxi_dma_submit(&spi_rx_req)) {
+		spi_reg->fifo_ctl &= ~SPI_FIFO_CTL_RX_DRQEN;
 		printk_warning("SPI: DMA transfer failed\n");
+		return -1;
 	}
 
-	// Wait for the DMA transfer to complete
-	while (sunxi_dma_querystatus(spi_dma_handler))
-		;
+	return 0;
+}
+
+/**
+ * @brief Start SPI data transmission using DMA
+ * 
+ * This function cleans the buffer from the data cache, enables the DMA
+ * transmit request and starts a DMA transfer from the buffer into the SPI
+ * transmit FIFO, without waiting for it to complete.
+ * 
+ * @param[in] spi A pointer to the SPI structure.
+ * @param[in] buf A pointer to the data to transmit.
+ * @param[in] len The number of bytes to transmit.
+ * 
+ * @return 0 on success, -1 if the DMA transfer could not be started.
+ */
+static int sunxi_spi_start_tx_dma(sunxi_spi_t *spi, uint8_t *buf, uint32_t len) {
+	sunxi_spi_reg_t *spi_reg = (sunxi_spi_reg_t *) spi->base;
+
+	flush_dcache_range((uint32_t) buf, (uint32_t) buf + len);
+
+	spi_reg->fifo_ctl |= SPI_FIFO_CTL_TX_DRQEN;
+
+	spi_tx_sg.src = (uint32_t) buf;
+	spi_tx_sg.dst = (uint32_t) &spi_reg->txdata;
+	spi_tx_sg.len = len;
+	if (sunxi_dma_submit(&spi_tx_req)) {
+		spi_reg->fifo_ctl &= ~SPI_FIFO_CTL_TX_DRQEN;
+		printk_warning("SPI: TX DMA transfer failed\n");
+		return -1;
+	}
+
+	return 0;
 }
 
 /**
@@ -520,55 +613,65 @@ clk_out:
 /**
  * @brief Initialize the SPI DMA for data transfer.
  * 
- * This function initializes the DMA controller for SPI data reception. It requests
- * a DMA channel, configures the DMA settings for the SPI receive path, and installs 
- * the DMA interrupt handler. The DMA is then enabled and the necessary settings 
- * are applied to start data transfer via DMA.
+ * This function initializes the DMA controller and fills in the scheduler
+ * requests for the SPI receive and transmit paths. No channel is taken
+ * here: every transfer gets one from the DMA channel scheduler and gives
+ * it back on completion, so SPI shares the channels with the other users.
  * 
  * @param[in] spi A pointer to the SPI structure, containing the necessary information
  *                about the SPI controller and DMA settings.
  * 
- * @return 0 on success, -1 on failure if DMA channel request fails.
- * 
- * @note The DMA handler must be available and correctly initialized before calling this function.
- * 
- * @warning If the DMA channel cannot be requested, an error message is printed using `printk_error`.
+ * @return 0 on success.
  */
 static int sunxi_spi_dma_init(sunxi_spi_t *spi) {
+	sunxi_dma_set_t *cfg;
+
 	// Initialize the DMA controller using the SPI handle.
 	sunxi_dma_init(spi->dma_handle);
 
-	// Request a DMA channel for normal transfer.
-	spi_dma_handler = sunxi_dma_request(DMAC_DMATYPE_NORMAL);
-
-	if (spi_dma_handler == 0) {
-		printk_error("SPI: DMA channel request failed\n");
-		return -1;
-	}
-
 	/* Configure SPI RX DMA transfer settings */
-	spi_rx_dma.loop_mode = 0;				// No loop mode for DMA transfer.
-	spi_rx_dma.wait_cyc = 0x8;				// Wait cycles set to 8.
-	spi_rx_dma.data_block_size = 1 * 32 / 8;// Data block size is 32 bits (4 bytes).
+	cfg = &spi_rx_req.cfg;
+	cfg->loop_mode = 0;				   // No loop mode for DMA transfer.
+	cfg->wait_cyc = 0x8;			   // Wait cycles set to 8.
+	cfg->data_block_size = 1 * 32 / 8;// Data block size is 32 bits (4 bytes).
 
 	// Configure source (SPI0) settings for DMA.
-	spi_rx_dma.channel_cfg.src_drq_type = DMAC_CFG_TYPE_SPI0;			  // Source is SPI0.
-	spi_rx_dma.channel_cfg.src_addr_mode = DMAC_CFG_SRC_ADDR_TYPE_IO_MODE;// Source address is I/O mode.
-	spi_rx_dma.channel_cfg.src_burst_length = DMAC_CFG_SRC_8_BURST;		  // 8-byte burst length for source.
-	spi_rx_dma.channel_cfg.src_data_width = DMAC_CFG_SRC_DATA_WIDTH_32BIT;// Source data width is 32 bits.
+	cfg->channel_cfg.src_drq_type = DMAC_CFG_TYPE_SPI0;			   // Source is SPI0.
+	cfg->channel_cfg.src_addr_mode = DMAC_CFG_SRC_ADDR_TYPE_IO_MODE;// Source address is I/O mode.
+	cfg->channel_cfg.src_burst_length = DMAC_CFG_SRC_8_BURST;	   // 8-byte burst length for source.
+	cfg->channel_cfg.src_data_width = DMAC_CFG_SRC_DATA_WIDTH_32BIT;// Source data width is 32 bits.
 
 	// Configure destination (DRAM) settings for DMA.
-	spi_rx_dma.channel_cfg.dst_drq_type = DMAC_CFG_TYPE_DRAM;				   // Destination is DRAM.
-	spi_rx_dma.channel_cfg.dst_addr_mode = DMAC_CFG_DEST_ADDR_TYPE_LINEAR_MODE;// Destination address is linear mode.
-	spi_rx_dma.channel_cfg.dst_burst_length = DMAC_CFG_DEST_8_BURST;		   // 8-byte burst length for destination.
-	spi_rx_dma.channel_cfg.dst_data_width = DMAC_CFG_DEST_DATA_WIDTH_32BIT;	   // Destination data width is 32 bits.
+	cfg->channel_cfg.dst_drq_type = DMAC_CFG_TYPE_DRAM;				   // Destination is DRAM.
+	cfg->channel_cfg.dst_addr_mode = DMAC_CFG_DEST_ADDR_TYPE_LINEAR_MODE;// Destination address is linear mode.
+	cfg->channel_cfg.dst_burst_length = DMAC_CFG_DEST_8_BURST;		   // 8-byte burst length for destination.
+	cfg->channel_cfg.dst_data_width = DMAC_CFG_DEST_DATA_WIDTH_32BIT;	   // Destination data width is 32 bits.
+
+	spi_rx_req.sg = spi_rx_sg;
+	spi_rx_req.count = 1;
+	spi_rx_req.done = NULL;
+
+	/* Configure SPI TX DMA transfer settings, DRAM to SPI0 */
+	cfg = &spi_tx_req.cfg;
+	cfg->loop_mode = 0;
+	cfg->wait_cyc = 0x8;
+	cfg->data_block_size = 1 * 32 / 8;
 
-	// Install DMA interrupt handler and enable interrupts.
-	sunxi_dma_install_int(spi_dma_handler, NULL);
-	sunxi_dma_enable_int(spi_dma_handler);
+	cfg->channel_cfg.src_drq_type = DMAC_CFG_TYPE_DRAM;
+	cfg->channel_cfg.src_addr_mode = DMAC_CFG_SRC_ADDR_TYPE_LINEAR_MODE;
+	cfg->channel_cfg.src_burst_length = DMAC_CFG_SRC_8_BURST;
+	cfg->channel_cfg.src_data_width = DMAC_CFG_SRC_DATA_WIDTH_32BIT;
 
-	// Set DMA transfer settings.
-	sunxi_dma_setting(spi_dma_handler, &spi_rx_dma);
+	cfg->channel_cfg.dst_drq_type = DMAC_CFG_TYPE_SPI0;
+	cfg->channel_cfg.dst_addr_mode = DMAC_CFG_DEST_ADDR_TYPE_IO_MODE;
+	cfg->channel_cfg.dst_burst_length = DMAC_CFG_DEST_8_BURST;
+	cfg->channel_cfg.dst_data_width = DMAC_CFG_DEST_DATA_WIDTH_32BIT;
+
+	spi_tx_req.sg = &spi_tx_sg;
+	spi_tx_req.count = 1;
+	spi_tx_req.done = NULL;
+
+	spi_dma_ready = true;
 
 	return 0;// Success
 }
@@ -576,8 +679,8 @@ static int sunxi_spi_dma_init(sunxi_spi_t *spi) {
 /**
  * @brief Deinitialize the SPI DMA.
  * 
- * This function disables the DMA interrupt for the SPI DMA channel, effectively 
- * deinitializing the DMA setup and preparing for cleanup.
+ * This function waits for the SPI DMA requests still in flight and stops
+ * using DMA. No channel is held between transfers, so none is released here.
  * 
  * @param[in] spi A pointer to the SPI structure.
  * 
@@ -586,8 +689,12 @@ static int sunxi_spi_dma_init(sunxi_spi_t *spi) {
  * @note This function is typically called when SPI DMA operations are no longer required.
  */
 static int sunxi_spi_dma_deinit(sunxi_spi_t *spi) {
-	// Disable DMA interrupts for the current SPI DMA channel.
-	sunxi_dma_disable_int(spi_dma_handler);
+	if (!spi_dma_ready)
+		return 0;
+
+	sunxi_dma_wait(&spi_rx_req);
+	sunxi_dma_wait(&spi_tx_req);
+	spi_dma_ready = false;
 
 	return 0;// Success
 }
@@ -720,27 +827,76 @@ static void sunxi_spi_clk_deinit(sunxi_spi_t *spi) {
 	clrbits_le32(spi->parent_clk_reg.gate_reg_base, BIT(spi->parent_clk_reg.gate_reg_offset));
 }
 
+/**
+ * @brief Sample modes ordered by increasing sample delay.
+ */
+static const uint32_t spi_samp_modes[] = {
+		DELAY_NORMAL_SAMPLE, DELAY_0_5_CYCLE_SAMPLE, DELAY_1_CYCLE_SAMPLE, DELAY_1_5_CYCLE_SAMPLE, DELAY_2_CYCLE_SAMPLE, DELAY_2_5_CYCLE_SAMPLE, DELAY_3_CYCLE_SAMPLE,
+};
+
+/**
+ * @brief Sets the SPI sample mode and delay chain.
+ * 
+ * The sample mode selects the SDM, SDC and SDC1 bits of the transfer control register
+ * with the new sample mode enabled, the delay chain adds a fine delay on top of it.
+ * 
+ * @param spi Pointer to the SPI structure containing configuration and register information.
+ * @param mode The sample mode, one of the DELAY_*_SAMPLE values.
+ * @param delay The delay chain setting, 0 turns the delay chain off.
+ */
+static void sunxi_spi_set_sample(sunxi_spi_t *spi, uint32_t mode, uint32_t delay) {
+	sunxi_spi_reg_t *spi_reg = (sunxi_spi_reg_t *) spi->base;
+	uint32_t reg_val;
+
+	reg_val = spi_reg->tc & ~(SPI_TC_SDM | SPI_TC_SDC | SPI_TC_SDC1);
+	if (mode & 0x100)
+		reg_val |= SPI_TC_SDM;
+	if (mode & 0x010)
+		reg_val |= SPI_TC_SDC;
+	if (mode & 0x001)
+		reg_val |= SPI_TC_SDC1;
+	spi_reg->tc = reg_val;
+
+	spi_reg->gc |= SPI_SAMP_MODE_EN;
+
+	reg_val = spi_reg->sdc & ~(SPI_SAMP_DL_SW_EN | SPI_SAMP_DL_SW_MASK);
+	if (delay)
+		reg_val |= SPI_SAMP_DL_SW_EN | (delay & SPI_SAMP_DL_SW_MASK);
+	spi_reg->sdc = reg_val;
+}
+
 /**
  * @brief Configures the SPI transfer control settings.
  * 
  * This function configures the transfer control register (`tc`) based on the SPI clock frequency.
  * The transfer control settings such as data width, polarity, and phase are set accordingly.
+ * When the bus runs at the clock of a previous `sunxi_spi_calibrate`, the calibrated sample
+ * mode and delay are used instead.
  * 
  * @param spi Pointer to the SPI structure containing configuration and register information.
  */
 static void sunxi_spi_config_transer_control(sunxi_spi_t *spi) {
 	sunxi_spi_reg_t *spi_reg = (sunxi_spi_reg_t *) spi->base;
 
-	uint32_t reg_val = spi_reg->tc;
+	uint32_t reg_val;
 
-	if (spi->spi_clk.spi_clock_freq > SPI_HIGH_FREQUENCY) {
-		reg_val &= ~(SPI_TC_SDC | SPI_TC_SDM);
-		reg_val |= SPI_TC_SDC;
-	} else if (spi->spi_clk.spi_clock_freq <= SPI_LOW_FREQUENCY) {
-		reg_val &= ~(SPI_TC_SDC | SPI_TC_SDM);
-		reg_val |= SPI_TC_SDM;
+	if (spi->samp.freq != 0 && spi->samp.freq == spi->spi_clk.spi_clock_freq) {
+		sunxi_spi_set_sample(spi, spi->samp.mode, spi->samp.delay);
+		reg_val = spi_reg->tc;
 	} else {
-		reg_val &= ~(SPI_TC_SDC | SPI_TC_SDM);
+		spi_reg->gc &= ~SPI_SAMP_MODE_EN;
+		spi_reg->sdc &= ~SPI_SAMP_DL_SW_EN;
+
+		reg_val = spi_reg->tc;
+		if (spi->spi_clk.spi_clock_freq > SPI_HIGH_FREQUENCY) {
+			reg_val &= ~(SPI_TC_SDC | SPI_TC_SDM);
+			reg_val |= SPI_TC_SDC;
+		} else if (spi->spi_clk.spi_clock_freq <= SPI_LOW_FREQUENCY) {
+			reg_val &= ~(SPI_TC_SDC | SPI_TC_SDM);
+			reg_val |= SPI_TC_SDM;
+		} else {
+			reg_val &= ~(SPI_TC_SDC | SPI_TC_SDM);
+		}
 	}
 	reg_val |= SPI_TC_DHB | SPI_TC_SS_LEVEL | SPI_TC_SPOL;
 
@@ -922,26 +1078,195 @@ int sunxi_spi_update_clk(sunxi_spi_t *spi, uint32_t clk) {
 }
 
 /**
- * @brief Performs SPI data transfer.
+ * @brief Finds the widest window of sample modes reading the pattern correctly.
  * 
- * This function initiates a data transfer on the SPI bus. The transfer can be either full-duplex (both 
- * transmission and reception) or half-duplex (only transmission or reception). The transfer is done based 
- * on the specified SPI I/O mode. The function handles both transmit and receive operations, including the 
- * use of DMA if required for large transfers.
+ * @param spi Pointer to the SPI structure containing configuration and register information.
+ * @param check Pattern check callback.
+ * @param arg Argument passed to the pattern check callback.
+ * @param centre Index in `spi_samp_modes` of the centre of the window.
+ * 
+ * @return The number of modes in the window, 0 if no mode passes.
+ */
+static uint32_t sunxi_spi_scan_modes(sunxi_spi_t *spi, sunxi_spi_calib_check_t check, void *arg, uint32_t *centre) {
+	uint32_t start = 0, len = 0, best = 0;
+
+	for (uint32_t i = 0; i < ARRAY_SIZE(spi_samp_modes); i++) {
+		sunxi_spi_set_sample(spi, spi_samp_modes[i], 0);
+		if (check(spi, arg)) {
+			len = 0;
+			continue;
+		}
+		if (len++ == 0)
+			start = i;
+		if (len > best) {
+			best = len;
+			*centre = start + (len - 1) / 2;
+		}
+	}
+
+	return best;
+}
+
+/**
+ * @brief Finds the widest window of delay chain settings reading the pattern correctly.
  * 
  * @param spi Pointer to the SPI structure containing configuration and register information.
- * @param mode The I/O mode to use for the transfer (e.g., single, dual, quad).
- * @param txbuf Pointer to the transmission buffer.
- * @param txlen Length of the transmission data in bytes.
- * @param rxbuf Pointer to the reception buffer.
- * @param rxlen Length of the reception data in bytes.
+ * @param mode The sample mode to sweep the delay chain with.
+ * @param check Pattern check callback.
+ * @param arg Argument passed to the pattern check callback.
+ * @param centre Delay chain setting at the centre of the window.
  * 
- * @return The total number of bytes transferred (txlen + rxlen).
+ * @return The number of settings in the window, 0 if no setting passes.
  */
-int sunxi_spi_transfer(sunxi_spi_t *spi, spi_io_mode_t mode, void *txbuf, uint32_t txlen, void *rxbuf, uint32_t rxlen) {
+static uint32_t sunxi_spi_scan_delay(sunxi_spi_t *spi, uint32_t mode, sunxi_spi_calib_check_t check, void *arg, uint32_t *centre) {
+	uint32_t start = 0, len = 0, best = 0;
+
+	for (uint32_t delay = 0; delay <= SPI_SAMP_DL_SW_MASK; delay++) {
+		sunxi_spi_set_sample(spi, mode, delay);
+		if (check(spi, arg)) {
+			len = 0;
+			continue;
+		}
+		if (len++ == 0)
+			start = delay;
+		if (len > best) {
+			best = len;
+			*centre = start + (len - 1) / 2;
+		}
+	}
+
+	return best;
+}
+
+uint32_t sunxi_spi_calibrate(sunxi_spi_t *spi, uint32_t max_clk, sunxi_spi_calib_check_t check, void *arg) {
+	uint32_t parent = spi->parent_clk_reg.parent_clk;
+	uint32_t start_clk = spi->clk_rate, good_clk = spi->clk_rate;
+	uint32_t div, win, centre = 0, mode = 0, delay = 0, best = 0;
+
+	spi->samp.freq = 0;
+	sunxi_spi_update_clk(spi, start_clk);
+
+	if (check(spi, arg)) {
+		printk_warning("SPI: calibration pattern fails at %uHz\n", spi->spi_clk.spi_clock_freq);
+		return 0;
+	}
+
+	/* Raise the clock one divider step at a time while enough sample modes pass */
+	for (div = (parent + start_clk) / start_clk - 1; div > 1; div--) {
+		uint32_t clk = parent / (div - 1);
+
+		if (clk > max_clk)
+			break;
+
+		sunxi_spi_update_clk(spi, clk);
+		win = sunxi_spi_scan_modes(spi, check, arg, &centre);
+		printk_debug("SPI: calibrate %uHz, %u sample modes pass\n", spi->spi_clk.spi_clock_freq, win);
+		if (win < SPI_SAMP_MIN_WINDOW)
+			break;
+
+		good_clk = clk;
+	}
+
+	if (spi->clk_rate != good_clk)
+		sunxi_spi_update_clk(spi, good_clk);
+
+	/* Fine tune with the delay chain, keeping the mode with the widest window */
+	for (uint32_t i = 0; i < ARRAY_SIZE(spi_samp_modes); i++) {
+		win = sunxi_spi_scan_delay(spi, spi_samp_modes[i], check, arg, &centre);
+		if (win > best) {
+			best = win;
+			mode = spi_samp_modes[i];
+			delay = centre;
+		}
+	}
+
+	if (best == 0) {
+		printk_warning("SPI: no sample setting passes at %uHz\n", spi->spi_clk.spi_clock_freq);
+		sunxi_spi_update_clk(spi, start_clk);
+		return 0;
+	}
+
+	spi->samp.mode = mode;
+	spi->samp.delay = delay;
+	spi->samp.freq = spi->spi_clk.spi_clock_freq;
+	sunxi_spi_config_transer_control(spi);
+
+	if (check(spi, arg)) {
+		printk_warning("SPI: calibrated setting fails, back to %uHz\n", start_clk);
+		spi->samp.freq = 0;
+		sunxi_spi_update_clk(spi, start_clk);
+		return 0;
+	}
+
+	printk_info("SPI: calibrated %uMHz, sample mode 0x%03x delay %u window %u\n", spi->samp.freq / 1000000, mode, delay, best);
+
+	return spi->samp.freq;
+}
+
+/**
+ * @brief Finish the transfer in flight.
+ *
+ * Reads a PIO reception out of the FIFO, checks the controller status,
+ * disables the DMA requests, invalidates the whole cache lines of a DMA
+ * reception and copies its partial end lines out of `spi_rx_edge`, then
+ * calls the completion callback.
+ *
+ * @param spi Pointer to the SPI structure running the transfer.
+ */
+static void sunxi_spi_finish_xfer(sunxi_spi_t *spi) {
 	sunxi_spi_reg_t *spi_reg = (sunxi_spi_reg_t *) spi->base;
+	sunxi_spi_xfer_cb_t done = spi_xfer.done;
+	void *arg = spi_xfer.arg;
+
+	if (spi_xfer.rxbuf && spi_xfer.rxlen && !spi_xfer.rx_dma)
+		sunxi_spi_read_rx_fifo(spi, spi_xfer.rxbuf, spi_xfer.rxlen); /**< Small receptions wait in the FIFO */
+
+	if (sunxi_spi_query_irq_pending(spi) & SPI_INT_STA_ERR) {
+		printk_warning("SPI: int sta err\n"); /**< Check for error interrupt */
+	}
+
+	sunxi_spi_dma_disable(spi); /**< Disable DMA if used */
+
+	if (spi_xfer.rx_dma) {
+		uint8_t *body = spi_xfer.rxbuf + spi_xfer.rx_head;
+		uint32_t body_len = spi_xfer.rxlen - spi_xfer.rx_head - spi_xfer.rx_tail;
+
+		/* Only whole lines are invalidated, the edges never shared a line with the DMA */
+		if (body_len)
+			invalidate_dcache_range((uint32_t) body, (uint32_t) body + body_len);
+		if (spi_xfer.rx_head || spi_xfer.rx_tail)
+			invalidate_dcache_range((uint32_t) spi_rx_edge, (uint32_t) (spi_rx_edge + 2));
+		memcpy(spi_xfer.rxbuf, spi_rx_edge[0], spi_xfer.rx_head);
+		memcpy(body + body_len, spi_rx_edge[1], spi_xfer.rx_tail);
+	}
+
+	if (spi_reg->burst_cnt == 0) {
+		if (spi_reg->tc & SPI_TC_XCH) {
+			printk_warning("SPI: XCH Control failed\n"); /**< Warn if exchange control fails */
+		}
+	} else {
+		printk_warning("SPI: MBC error\n"); /**< Warn if there is an MBC error (memory-to-bus control) */
+	}
+
+	sunxi_spi_clr_irq_pending(spi, SPI_INT_STA_PENDING_BIT); /**< Clear any pending interrupt */
+
+	printk_trace("SPI: ISR=0x%x\n", spi_reg->int_sta); /**< Log the current interrupt status register */
+
+	spi_xfer.spi = NULL;
+
+	if (done)
+		done(spi, arg);
+}
+
+int sunxi_spi_transfer_async(sunxi_spi_t *spi, spi_io_mode_t mode, void *txbuf, uint32_t txlen, void *rxbuf, uint32_t rxlen, sunxi_spi_xfer_cb_t done,
+							 void *arg) {
 	uint32_t stxlen;
 
+	if (spi_xfer.spi != NULL) {
+		printk_warning("SPI: transfer already in flight\n");
+		return -1;
+	}
+
 	printk_trace("SPI: tsfr mode=%u tx=%u rx=%u\n", mode, txlen, rxlen);
 
 	sunxi_spi_disable_irq(spi, SPI_INT_STA_PENDING_BIT);	 /**< Disable interrupt for pending status */
@@ -963,42 +1288,89 @@ int sunxi_spi_transfer(sunxi_spi_t *spi, spi_io_mode_t mode, void *txbuf, uint32
 			break;
 	}
 
+	spi_xfer.spi = spi;
+	spi_xfer.rxbuf = rxbuf;
+	spi_xfer.rxlen = rxlen;
+	spi_xfer.txlen = txlen;
+	spi_xfer.done = done;
+	spi_xfer.arg = arg;
+	/* Transfers fitting in the FIFO are cheaper by PIO, TX DMA needs whole words */
+	spi_xfer.tx_dma = txbuf && txlen > MAX_FIFU && !(txlen & 0x3) && spi_dma_ready;
+	spi_xfer.rx_dma = rxbuf && rxlen > MAX_FIFU && spi_dma_ready;
+
 	sunxi_spi_set_counters(spi, txlen, rxlen, stxlen, 0); /**< Set the SPI transfer counters */
 	sunxi_spi_reset_fifo(spi);							  /**< Reset the SPI FIFOs */
-	sunxi_spi_start_xfer(spi);							  /**< Start the SPI transfer */
 
-	if (txbuf && txlen) {
+	if (spi_xfer.rx_dma && sunxi_spi_start_rx_dma(spi, rxbuf, rxlen))
+		spi_xfer.rx_dma = false;
+
+	if (spi_xfer.tx_dma && sunxi_spi_start_tx_dma(spi, txbuf, txlen))
+		spi_xfer.tx_dma = false;
+
+	sunxi_spi_start_xfer(spi); /**< Start the SPI transfer */
+
+	if (txbuf && txlen && !spi_xfer.tx_dma) {
 		sunxi_spi_write_tx_fifo(spi, txbuf, txlen); /**< Write data to TX FIFO if there's data to transmit */
 	}
 
-	if (rxbuf && rxlen) {
-		if (rxlen > 64) {
-			sunxi_spi_read_by_dma(spi, rxbuf, rxlen); /**< Use DMA for large receive buffers */
-		} else {
-			sunxi_spi_read_rx_fifo(spi, rxbuf, rxlen); /**< Use FIFO for smaller receive buffers */
-		}
+	/* Without DMA a reception larger than the FIFO has to be drained now */
+	if (rxbuf && rxlen > MAX_FIFU && !spi_xfer.rx_dma) {
+		sunxi_spi_read_rx_fifo(spi, rxbuf, rxlen);
+		spi_xfer.rxlen = 0;
 	}
 
-	if (sunxi_spi_query_irq_pending(spi) & SPI_INT_STA_ERR) {
-		printk_warning("SPI: int sta err\n"); /**< Check for error interrupt */
-	}
+	return 0;
+}
 
-	while (!(sunxi_spi_query_irq_pending(spi) & SPI_INT_STA_TC))
-		; /**< Wait for transfer completion interrupt (TC) */
+int sunxi_spi_transfer_poll(sunxi_spi_t *spi) {
+	if (spi_xfer.spi != spi)
+		return 0;
 
-	sunxi_spi_dma_disable(spi); /**< Disable DMA if used */
+	if (!(sunxi_spi_query_irq_pending(spi) & SPI_INT_STA_TC))
+		return 1; /**< Transfer completion interrupt (TC) not raised yet */
 
-	if (spi_reg->burst_cnt == 0) {
-		if (spi_reg->tc & SPI_TC_XCH) {
-			printk_warning("SPI: XCH Control failed\n"); /**< Warn if exchange control fails */
-		}
-	} else {
-		printk_warning("SPI: MBC error\n"); /**< Warn if there is an MBC error (memory-to-bus control) */
+	/* The last DMA burst may still be on its way to memory, the scheduler hands the channels back */
+	if ((spi_xfer.rx_dma && spi_rx_req.busy) || (spi_xfer.tx_dma && spi_tx_req.busy)) {
+		sunxi_dma_sched_poll();
+		if ((spi_xfer.rx_dma && spi_rx_req.busy) || (spi_xfer.tx_dma && spi_tx_req.busy))
+			return 1;
 	}
 
-	sunxi_spi_clr_irq_pending(spi, SPI_INT_STA_PENDING_BIT); /**< Clear any pending interrupt */
+	sunxi_spi_finish_xfer(spi);
 
-	printk_trace("SPI: ISR=0x%x\n", spi_reg->int_sta); /**< Log the current interrupt status register */
+	return 0;
+}
+
+void sunxi_spi_transfer_wait(sunxi_spi_t *spi) {
+	while (sunxi_spi_transfer_poll(spi))
+		;
+}
+
+/**
+ * @brief Performs SPI data transfer.
+ *
+ * This function initiates a data transfer on the SPI bus. The transfer can be either full-duplex (both
+ * transmission and reception) or half-duplex (only transmission or reception). The transfer is done based
+ * on the specified SPI I/O mode. The function handles both transmit and receive operations, including the
+ * use of DMA if required for large transfers.
+ *
+ * @param spi Pointer to the SPI structure containing configuration and register information.
+ * @param mode The I/O mode to use for the transfer (e.g., single, dual, quad).
+ * @param txbuf Pointer to the transmission buffer.
+ * @param txlen Length of the transmission data in bytes.
+ * @param rxbuf Pointer to the reception buffer.
+ * @param rxlen Length of the reception data in bytes.
+ *
+ * @return The total number of bytes transferred (txlen + rxlen).
+ */
+int sunxi_spi_transfer(sunxi_spi_t *spi, spi_io_mode_t mode, void *txbuf, uint32_t txlen, void *rxbuf, uint32_t rxlen) {
+	if (spi_xfer.spi == spi)
+		sunxi_spi_transfer_wait(spi); /**< Let a transfer in flight finish first */
+
+	if (sunxi_spi_transfer_async(spi, mode, txbuf, txlen, rxbuf, rxlen, NULL, NULL))
+		return -1;
+
+	sunxi_spi_transfer_wait(spi);
 
 	return rxlen + txlen; /**< Return the total number of transferred bytes (TX + RX) */
 }
@@ -95,4 +95,44 @@ int __attribute__((weak)) sunxi_serial_tstc(void *arg) {
 	sunxi_serial_reg_t *serial_reg = (sunxi_serial_reg_t *) uart->base;
 
 	return serial_reg->lsr & 1;
-}
\ No newline at end of file
+}
+
+uint32_t sunxi_serial_write_nowait(sunxi_serial_t *uart, const char *buf, uint32_t len) {
+	sunxi_serial_reg_t *serial_reg = (sunxi_serial_reg_t *) uart->base;
+	uint32_t n;
+
+	/* THRE is set once the whole FIFO has drained */
+	if ((serial_reg->lsr & (1 << 5)) == 0)
+		return 0;
+
+	if (len > SERIAL_TX_FIFO_SIZE)
+		len = SERIAL_TX_FIFO_SIZE;
+	for (n = 0; n < len; n++)
+		serial_reg->thr = buf[n];
+
+	return len;
+}
+
+void sunxi_serial_flush(sunxi_serial_t *uart) {
+	sunxi_serial_reg_t *serial_reg = (sunxi_serial_reg_t *) uart->base;
+
+	while ((serial_reg->lsr & (1 << 6)) == 0)
+		;
+}
+
+void sunxi_serial_tx_irq(sunxi_serial_t *uart, bool enable) {
+	sunxi_serial_reg_t *serial_reg = (sunxi_serial_reg_t *) uart->base;
+
+	/* Bit 1: ETBEI, the line control DLAB bit is never left set */
+	if (enable)
+		serial_reg->ier |= (1 << 1);
+	else
+		serial_reg->ier &= ~(1 << 1);
+}
+
+uint32_t sunxi_serial_irq_ack(sunxi_serial_t *uart) {
+	sunxi_serial_reg_t *serial_reg = (sunxi_serial_reg_t *) uart->base;
+
+	/* Reading IIR clears a pending THR empty interrupt */
+	return serial_reg->iir & 0xf;
+}
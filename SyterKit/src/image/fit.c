@@ -0,0 +1,357 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <types.h>
+
+#include <common.h>
+#include <log.h>
+
+#include <crc32.h>
+#include <fit.h>
+#include <lz4.h>
+#include <sha256.h>
+
+#include "libfdt.h"
+
+/* Upper bound for a decompressed component */
+#define FIT_LZ4_MAX_SIZE (0x02000000)
+
+/* Start of external data, right after the 4 byte aligned structure */
+static inline uint32_t fit_data_base(const void *fit) {
+	return (fdt_totalsize(fit) + 3) & ~3;
+}
+
+static int fit_get_u32(const void *fit, int node, const char *name, uint32_t *val) {
+	const fdt32_t *prop;
+	int len;
+
+	prop = fdt_getprop(fit, node, name, &len);
+	if (prop == NULL || len < (int) sizeof(fdt32_t))
+		return -1;
+
+	/* A 64-bit address is two cells, keep the low one */
+	*val = fdt32_to_cpu(prop[len / sizeof(fdt32_t) - 1]);
+	return 0;
+}
+
+static int fit_get_data(const void *fit, uint32_t fit_size, int node, const uint8_t **data, uint32_t *size) {
+	uint32_t offset;
+	int len;
+
+	*data = fdt_getprop(fit, node, "data", &len);
+	if (*data) {
+		*size = len;
+		return 0;
+	}
+
+	if (fit_get_u32(fit, node, "data-size", size))
+		return -1;
+
+	if (fit_get_u32(fit, node, "data-position", &offset)) {
+		if (fit_get_u32(fit, node, "data-offset", &offset))
+			return -1;
+		/* data-offset counts from the end of the structure */
+		if (offset > fit_size - fit_data_base(fit))
+			return -1;
+		offset += fit_data_base(fit);
+	}
+
+	/* Nothing beyond the loaded bytes may be referenced */
+	if (offset > fit_size || *size > fit_size - offset)
+		return -1;
+
+	*data = (const uint8_t *) fit + offset;
+	return 0;
+}
+
+static void fit_get_hash(const void *fit, int node, fit_component_t *c) {
+	int sub, len;
+
+	fdt_for_each_subnode(sub, fit, node) {
+		const char *algo;
+		const uint8_t *value;
+
+		if (strncmp(fdt_get_name(fit, sub, NULL), "hash", 4))
+			continue;
+
+		algo = fdt_getprop(fit, sub, "algo", NULL);
+		value = fdt_getprop(fit, sub, "value", &len);
+		if (algo == NULL || value == NULL)
+			continue;
+
+		if (strcmp(algo, "sha256") == 0 && len == SHA256_DIGEST_SIZE) {
+			c->hash_algo = FIT_HASH_SHA256;
+			c->hash = value;
+			return;
+		}
+		if (strcmp(algo, "crc32") == 0 && len == 4) {
+			c->hash_algo = FIT_HASH_CRC32;
+			c->hash = value;
+			return;
+		}
+	}
+}
+
+static int fit_add_image(fit_image_t *img, int images, const char *name) {
+	const void *fit = img->fit;
+	fit_component_t *c;
+	const char *comp;
+	int node;
+
+	/* An image can be referenced by more than one property */
+	for (int i = 0; i < img->count; i++) {
+		if (strcmp(img->comp[i].name, name) == 0)
+			return 0;
+	}
+
+	if (img->count >= FIT_MAX_COMPONENTS) {
+		printk_error("FIT: more than %d images\n", FIT_MAX_COMPONENTS);
+		return -1;
+	}
+
+	node = fdt_subnode_offset(fit, images, name);
+	if (node < 0) {
+		printk_error("FIT: image '%s' not found\n", name);
+		return -1;
+	}
+
+	c = &img->comp[img->count];
+	memset(c, 0, sizeof(*c));
+	c->name = fdt_get_name(fit, node, NULL);
+	c->type = fdt_getprop(fit, node, "type", NULL);
+	c->arch = fdt_getprop(fit, node, "arch", NULL);
+	c->has_load = fit_get_u32(fit, node, "load", &c->load) == 0;
+	c->has_entry = fit_get_u32(fit, node, "entry", &c->entry) == 0;
+
+	if (c->type == NULL || fit_get_data(fit, img->size, node, &c->data, &c->size)) {
+		printk_error("FIT: image '%s' has no type or its data is out of bounds\n", name);
+		return -1;
+	}
+
+	comp = fdt_getprop(fit, node, "compression", NULL);
+	if (comp == NULL || strcmp(comp, "none") == 0) {
+		c->comp = FIT_COMP_NONE;
+	} else if (strcmp(comp, "lz4") == 0) {
+		c->comp = FIT_COMP_LZ4;
+	} else {
+		printk_error("FIT: image '%s' uses unsupported %s compression\n", name, comp);
+		return -1;
+	}
+
+	fit_get_hash(fit, node, c);
+
+	printk_debug("FIT: %s '%s' size %u at 0x%08x\n", c->type, c->name, c->size, (uint32_t) c->data);
+
+	c->dest = (uint8_t *) c->data;
+	c->dest_size = c->size;
+	img->count++;
+
+	return 0;
+}
+
+int fit_check_header(const void *fit) {
+	if (fdt_check_header(fit))
+		return -1;
+
+	return fdt_path_offset(fit, "/images") < 0 ? -1 : 0;
+}
+
+uint32_t fit_total_size(const void *fit) {
+	uint32_t total = fit_data_base(fit);
+	uint32_t offset, size;
+	int images, node;
+
+	images = fdt_path_offset(fit, "/images");
+	fdt_for_each_subnode(node, fit, images) {
+		if (fit_get_u32(fit, node, "data-size", &size))
+			continue;
+		if (fit_get_u32(fit, node, "data-position", &offset) == 0) {
+			if (offset + size > total)
+				total = offset + size;
+		} else if (fit_get_u32(fit, node, "data-offset", &offset) == 0) {
+			if (fit_data_base(fit) + offset + size > total)
+				total = fit_data_base(fit) + offset + size;
+		}
+	}
+
+	return total;
+}
+
+int fit_parse(const void *fit, uint32_t size, const char *config, fit_image_t *img) {
+	static const char *const roles[] = {"kernel", "fdt", "ramdisk", "firmware", "loadables"};
+	int images, confs, conf, node;
+	const char *name;
+
+	memset(img, 0, sizeof(*img));
+	img->fit = fit;
+	img->size = size;
+
+	if (fit_check_header(fit) || fit_data_base(fit) > size) {
+		printk_error("FIT: not a FIT image\n");
+		return -1;
+	}
+
+	images = fdt_path_offset(fit, "/images");
+	confs = fdt_path_offset(fit, "/configurations");
+
+	/* No configurations, take every image */
+	if (confs < 0) {
+		fdt_for_each_subnode(node, fit, images) {
+			if (fit_add_image(img, images, fdt_get_name(fit, node, NULL)))
+				return -1;
+		}
+		return 0;
+	}
+
+	if (config == NULL)
+		config = fdt_getprop(fit, confs, "default", NULL);
+	if (config == NULL) {
+		printk_error("FIT: no default configuration\n");
+		return -1;
+	}
+
+	conf = fdt_subnode_offset(fit, confs, config);
+	if (conf < 0) {
+		printk_error("FIT: configuration '%s' not found\n", config);
+		return -1;
+	}
+	img->config = fdt_get_name(fit, conf, NULL);
+
+	for (uint32_t r = 0; r < ARRAY_SIZE(roles); r++) {
+		for (int i = 0; (name = fdt_stringlist_get(fit, conf, roles[r], i, NULL)) != NULL; i++) {
+			if (fit_add_image(img, images, name))
+				return -1;
+		}
+	}
+
+	printk_info("FIT: configuration '%s', %d images\n", img->config, img->count);
+
+	return 0;
+}
+
+static int fit_check_hash(fit_component_t *c) {
+	uint8_t digest[SHA256_DIGEST_SIZE];
+	uint32_t crc;
+
+	if (c->hash_algo == FIT_HASH_SHA256) {
+		sha256_final(&c->sha, digest);
+		if (memcmp(digest, c->hash, SHA256_DIGEST_SIZE) == 0)
+			return 0;
+	} else {
+		crc = crc32(0, c->data, c->size);
+		if (crc == fdt32_to_cpu(*(const fdt32_t *) c->hash))
+			return 0;
+	}
+
+	printk_error("FIT: %s '%s' hash mismatch\n", c->type, c->name);
+	return -1;
+}
+
+int fit_verify(fit_image_t *img) {
+	uint32_t load[2] = {0, 0};
+	bool on_cpu1[FIT_MAX_COMPONENTS];
+	int ret = 0;
+
+	for (int i = 0; i < img->count; i++) {
+		if (img->comp[i].hash_algo == FIT_HASH_NONE) {
+			printk_error("FIT: %s '%s' has no sha256 or crc32 hash\n", img->comp[i].type, img->comp[i].name);
+			return -1;
+		}
+	}
+
+	/* Hand the largest share of SHA-256 work to CPU1 first, it runs while CPU0 hashes the rest */
+	for (int i = 0; i < img->count; i++) {
+		fit_component_t *c = &img->comp[i];
+
+		on_cpu1[i] = false;
+		if (c->hash_algo != FIT_HASH_SHA256)
+			continue;
+
+		sha256_init(&c->sha);
+		if (load[1] <= load[0]) {
+			on_cpu1[i] = true;
+			load[1] += c->size;
+			sha256_update_async(&c->sha, c->data, c->size);
+		} else {
+			load[0] += c->size;
+		}
+	}
+
+	for (int i = 0; i < img->count; i++) {
+		fit_component_t *c = &img->comp[i];
+
+		if (c->hash_algo == FIT_HASH_SHA256 && !on_cpu1[i])
+			sha256_update(&c->sha, c->data, c->size);
+	}
+
+	/* fit_check_hash() waits for CPU1 through sha256_final() */
+	for (int i = 0; i < img->count; i++) {
+		if (fit_check_hash(&img->comp[i]))
+			ret = -1;
+	}
+
+	if (ret == 0)
+		printk_info("FIT: %d images verified\n", img->count);
+
+	return ret;
+}
+
+int fit_place(fit_image_t *img, fit_component_t *c) {
+	const uint8_t *blob = img->fit;
+	uint8_t *dst = (uint8_t *) c->load;
+
+	if (!c->has_load || (dst == c->data && c->comp == FIT_COMP_NONE)) {
+		if (c->comp != FIT_COMP_NONE) {
+			printk_error("FIT: compressed '%s' has no load address\n", c->name);
+			return -1;
+		}
+		c->dest = (uint8_t *) c->data;
+		c->dest_size = c->size;
+		return 0;
+	}
+
+	/* Other components are still read from the blob, it must stay intact */
+	if (dst >= blob && dst < blob + img->size) {
+		printk_error("FIT: '%s' load address 0x%08x is inside the FIT image\n", c->name, c->load);
+		return -1;
+	}
+
+	if (c->comp == FIT_COMP_LZ4) {
+		uint32_t out_size = FIT_LZ4_MAX_SIZE;
+		lz4_stream_t lz4;
+
+		if (dst < blob && (uint32_t) (blob - dst) < out_size)
+			out_size = blob - dst;
+
+		lz4_stream_init(&lz4, dst, out_size);
+		if (lz4_stream_feed(&lz4, c->data, c->size) < 0 || lz4_stream_end(&lz4)) {
+			printk_error("FIT: '%s' LZ4 decompression failed\n", c->name);
+			return -1;
+		}
+		c->dest_size = lz4_stream_size(&lz4);
+	} else {
+		if (dst < blob && (uint32_t) (blob - dst) < c->size) {
+			printk_error("FIT: '%s' at 0x%08x runs into the FIT image\n", c->name, c->load);
+			return -1;
+		}
+		memcpy(dst, c->data, c->size);
+		c->dest_size = c->size;
+	}
+
+	c->dest = dst;
+	printk_debug("FIT: '%s' placed at 0x%08x size %u\n", c->name, c->load, c->dest_size);
+
+	return 0;
+}
+
+fit_component_t *fit_find(fit_image_t *img, const char *type, int index) {
+	for (int i = 0; i < img->count; i++) {
+		if (strcmp(img->comp[i].type, type) == 0 && index-- == 0)
+			return &img->comp[i];
+	}
+
+	return NULL;
+}
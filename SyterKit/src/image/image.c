@@ -0,0 +1,63 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <types.h>
+
+#include <log.h>
+
+#include "image_loader.h"
+#include "uimage.h"
+
+/* Big endian magic of a FIT image or a DTB */
+#define IMAGE_FDT_MAGIC 0xd00dfeed
+
+/* "ARM\x64" at offset 56 of an arm64 Image, this loader only enters arm32 */
+#define IMAGE_ARM64_MAGIC 0x644d5241
+#define IMAGE_ARM64_MAGIC_OFFSET 56
+
+static inline uint32_t image_get_be32(const uint8_t *p) {
+	return ((uint32_t) p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+int Image_loader(uint8_t *addr, uint32_t *entry) {
+	linux_zimage_header_t *zimage_header = (linux_zimage_header_t *) addr;
+	uint32_t text_offset = (uint32_t) addr & (LINUX_IMAGE_PHYS_ALIGN - 1);
+	uint32_t magic = image_get_be32(addr);
+
+	/* A zImage carries its own decompressor and can run from anywhere */
+	if (zimage_header->magic == LINUX_ZIMAGE_MAGIC) {
+		printk_debug("Linux Image: 0x%08x holds a zImage\n", (uint32_t) addr);
+		return -1;
+	}
+
+	/* The plain Image has no magic of its own, rule out the known wrappers */
+	if (magic == UIMAGE_MAGIC || magic == IMAGE_FDT_MAGIC) {
+		printk_debug("Linux Image: 0x%08x holds a %s\n", (uint32_t) addr, magic == IMAGE_FDT_MAGIC ? "FIT or DTB" : "uImage");
+		return -1;
+	}
+
+	if (*(uint32_t *) (addr + IMAGE_ARM64_MAGIC_OFFSET) == IMAGE_ARM64_MAGIC) {
+		printk_error("Linux Image: 0x%08x holds an arm64 Image\n", (uint32_t) addr);
+		return -1;
+	}
+
+	/*
+	 * The plain Image has no header, it is the kernel text itself. The
+	 * kernel derives PHYS_OFFSET from its running address, so it has to
+	 * sit at TEXT_OFFSET above a 16MiB aligned base.
+	 */
+	if (text_offset != LINUX_IMAGE_TEXT_OFFSET) {
+		printk_debug("Linux Image: 0x%08x is not at text offset 0x%x\n", (uint32_t) addr, LINUX_IMAGE_TEXT_OFFSET);
+		return -1;
+	}
+
+	if (zimage_header->code[0] == 0 || zimage_header->code[0] == 0xffffffff) {
+		printk_error("Linux Image: no kernel at 0x%08x\n", (uint32_t) addr);
+		return -1;
+	}
+
+	printk_debug("Linux Image->entry = 0x%x\n", (uint32_t) addr);
+
+	*entry = (uint32_t) addr;
+	return 0;
+}
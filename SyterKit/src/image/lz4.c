@@ -0,0 +1,353 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <types.h>
+
+#include <log.h>
+
+#include "lz4.h"
+
+/* Frame descriptor FLG bits */
+#define LZ4_FLG_VERSION_MASK (0x3 << 6)
+#define LZ4_FLG_VERSION (0x1 << 6)
+#define LZ4_FLG_BLOCK_CSUM (1 << 4)
+#define LZ4_FLG_CONTENT_SIZE (1 << 3)
+#define LZ4_FLG_CONTENT_CSUM (1 << 2)
+#define LZ4_FLG_DICT_ID (1 << 0)
+
+#define LZ4_BLOCK_UNCOMPRESSED (1U << 31)
+#define LZ4_MIN_MATCH 4
+
+enum {
+	LZ4_ST_MAGIC,
+	LZ4_ST_FRAME_DESC,
+	LZ4_ST_FRAME_HDR,
+	LZ4_ST_BLOCK_SIZE,
+	LZ4_ST_BLOCK_RAW,
+	LZ4_ST_TOKEN,
+	LZ4_ST_LIT_LEN,
+	LZ4_ST_LITERALS,
+	LZ4_ST_OFFSET,
+	LZ4_ST_MATCH_LEN,
+	LZ4_ST_BLOCK_CSUM,
+	LZ4_ST_CONTENT_CSUM,
+	LZ4_ST_DONE,
+};
+
+static inline uint32_t lz4_get_le32(const uint8_t *p) {
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+bool lz4_is_compressed(const void *buf) {
+	uint32_t magic = lz4_get_le32(buf);
+	return magic == LZ4_FRAME_MAGIC || magic == LZ4_LEGACY_MAGIC;
+}
+
+void lz4_stream_init(lz4_stream_t *s, void *dst, uint32_t dst_size) {
+	memset(s, 0, sizeof(*s));
+	s->state = LZ4_ST_MAGIC;
+	s->need = 4;
+	s->out = s->out_start = dst;
+	s->out_end = (uint8_t *) dst + dst_size;
+}
+
+/**
+ * @brief Collect header bytes that may be split across chunks.
+ *
+ * @return true once s->need bytes are in s->hdr.
+ */
+static bool lz4_collect(lz4_stream_t *s, const uint8_t **src, uint32_t *len) {
+	uint32_t n = s->need - s->have;
+
+	if (n > *len)
+		n = *len;
+	memcpy(s->hdr + s->have, *src, n);
+	s->have += n;
+	*src += n;
+	*len -= n;
+
+	if (s->have < s->need)
+		return false;
+
+	s->have = 0;
+	return true;
+}
+
+static void lz4_expect(lz4_stream_t *s, uint8_t state, uint32_t need) {
+	s->state = state;
+	s->need = need;
+	s->have = 0;
+}
+
+/**
+ * @brief Copy a match out of the already decoded output.
+ *
+ * A match may overlap its own output. The distance to the source grows with
+ * each copy, so the pattern is doubled with plain non-overlapping memcpy.
+ */
+static int lz4_copy_match(lz4_stream_t *s, uint32_t offset, uint32_t len) {
+	uint8_t *dst = s->out;
+	uint8_t *match = dst - offset;
+	uint32_t n;
+
+	if (offset == 0 || offset > (uint32_t) (dst - s->out_start) || len > (uint32_t) (s->out_end - dst))
+		return -1;
+
+	while (len) {
+		n = dst - match;
+		if (n > len)
+			n = len;
+		memcpy(dst, match, n);
+		dst += n;
+		len -= n;
+	}
+
+	s->out = dst;
+	return 0;
+}
+
+static int lz4_frame_header(lz4_stream_t *s) {
+	uint32_t hdr_len = 1; /* header checksum */
+
+	s->flags = s->hdr[0];
+	if ((s->flags & LZ4_FLG_VERSION_MASK) != LZ4_FLG_VERSION) {
+		printk_error("LZ4: unsupported frame version\n");
+		return -1;
+	}
+
+	if (s->flags & LZ4_FLG_CONTENT_SIZE)
+		hdr_len += 8;
+	if (s->flags & LZ4_FLG_DICT_ID) {
+		printk_error("LZ4: dictionaries are not supported\n");
+		return -1;
+	}
+
+	lz4_expect(s, LZ4_ST_FRAME_HDR, hdr_len);
+	return 0;
+}
+
+static int lz4_block_size(lz4_stream_t *s) {
+	uint32_t size = lz4_get_le32(s->hdr);
+
+	if (s->legacy) {
+		if (size == LZ4_LEGACY_MAGIC) {
+			lz4_expect(s, LZ4_ST_BLOCK_SIZE, 4); /* concatenated stream */
+			return 0;
+		}
+		if (size > LZ4_LEGACY_BLOCK_BOUND || (size != 0 && size == (uint32_t) (s->out - s->out_start))) {
+			/* the kernel build appends the decompressed size */
+			s->state = LZ4_ST_DONE;
+			return 1;
+		}
+		s->block_left = size;
+		lz4_expect(s, size ? LZ4_ST_TOKEN : LZ4_ST_BLOCK_SIZE, size ? 1 : 4);
+		return 0;
+	}
+
+	if (size == 0) {
+		/* end mark, skip the content checksum */
+		if (s->flags & LZ4_FLG_CONTENT_CSUM) {
+			s->block_left = 4;
+			lz4_expect(s, LZ4_ST_CONTENT_CSUM, 0);
+			return 0;
+		}
+		s->state = LZ4_ST_DONE;
+		return 1;
+	}
+
+	s->block_left = size & ~LZ4_BLOCK_UNCOMPRESSED;
+	lz4_expect(s, (size & LZ4_BLOCK_UNCOMPRESSED) ? LZ4_ST_BLOCK_RAW : LZ4_ST_TOKEN, 1);
+	return 0;
+}
+
+/**
+ * @brief Finish a data block, the block checksum is skipped.
+ */
+static void lz4_block_end(lz4_stream_t *s) {
+	if (!s->legacy && (s->flags & LZ4_FLG_BLOCK_CSUM)) {
+		s->block_left = 4;
+		lz4_expect(s, LZ4_ST_BLOCK_CSUM, 0);
+		return;
+	}
+	lz4_expect(s, LZ4_ST_BLOCK_SIZE, 4);
+}
+
+int lz4_stream_feed(lz4_stream_t *s, const void *src_buf, uint32_t len) {
+	const uint8_t *src = src_buf;
+	uint32_t n, magic;
+	bool got;
+	uint8_t c;
+
+	while (len) {
+		switch (s->state) {
+			case LZ4_ST_MAGIC:
+				if (!lz4_collect(s, &src, &len))
+					break;
+				magic = lz4_get_le32(s->hdr);
+				if (magic == LZ4_LEGACY_MAGIC) {
+					s->legacy = true;
+					lz4_expect(s, LZ4_ST_BLOCK_SIZE, 4);
+				} else if (magic == LZ4_FRAME_MAGIC) {
+					lz4_expect(s, LZ4_ST_FRAME_DESC, 2);
+				} else {
+					printk_error("LZ4: bad magic 0x%08x\n", magic);
+					return -1;
+				}
+				break;
+
+			case LZ4_ST_FRAME_DESC:
+				if (lz4_collect(s, &src, &len) && lz4_frame_header(s))
+					return -1;
+				break;
+
+			case LZ4_ST_FRAME_HDR:
+				if (!lz4_collect(s, &src, &len))
+					break;
+				if (s->flags & LZ4_FLG_CONTENT_SIZE)
+					s->content_size = lz4_get_le32(s->hdr) | ((uint64_t) lz4_get_le32(s->hdr + 4) << 32);
+				if (s->content_size > (uint64_t) (s->out_end - s->out_start)) {
+					printk_error("LZ4: content size %u exceeds the output buffer\n", (uint32_t) s->content_size);
+					return -1;
+				}
+				lz4_expect(s, LZ4_ST_BLOCK_SIZE, 4);
+				break;
+
+			case LZ4_ST_BLOCK_SIZE:
+				if (!lz4_collect(s, &src, &len))
+					break;
+				if (lz4_block_size(s))
+					goto out;
+				break;
+
+			case LZ4_ST_BLOCK_RAW:
+				n = len < s->block_left ? len : s->block_left;
+				if (n > (uint32_t) (s->out_end - s->out))
+					return -1;
+				memcpy(s->out, src, n);
+				s->out += n;
+				src += n;
+				len -= n;
+				s->block_left -= n;
+				if (s->block_left == 0)
+					lz4_block_end(s);
+				break;
+
+			case LZ4_ST_TOKEN:
+				if (s->block_left == 0)
+					return -1;
+				c = *src++;
+				len--;
+				s->block_left--;
+				s->lit_left = c >> 4;
+				s->match_len = (c & 0xf) + LZ4_MIN_MATCH;
+				if (s->lit_left == 15)
+					s->state = LZ4_ST_LIT_LEN;
+				else if (s->lit_left)
+					s->state = LZ4_ST_LITERALS;
+				else if (s->block_left)
+					lz4_expect(s, LZ4_ST_OFFSET, 2);
+				else
+					lz4_block_end(s);
+				break;
+
+			case LZ4_ST_LIT_LEN:
+				if (s->block_left == 0)
+					return -1;
+				c = *src++;
+				len--;
+				s->block_left--;
+				s->lit_left += c;
+				if (c != 255)
+					s->state = LZ4_ST_LITERALS;
+				break;
+
+			case LZ4_ST_LITERALS:
+				n = len < s->lit_left ? len : s->lit_left;
+				if (n > s->block_left || n > (uint32_t) (s->out_end - s->out))
+					return -1;
+				memcpy(s->out, src, n);
+				s->out += n;
+				src += n;
+				len -= n;
+				s->lit_left -= n;
+				s->block_left -= n;
+				if (s->lit_left)
+					break;
+				/* the last sequence of a block has no match */
+				if (s->block_left == 0)
+					lz4_block_end(s);
+				else
+					lz4_expect(s, LZ4_ST_OFFSET, 2);
+				break;
+
+			case LZ4_ST_OFFSET:
+				n = len;
+				got = lz4_collect(s, &src, &len);
+				n -= len;
+				if (n > s->block_left)
+					return -1;
+				s->block_left -= n;
+				if (!got)
+					break;
+				if (s->match_len == 15 + LZ4_MIN_MATCH) {
+					s->state = LZ4_ST_MATCH_LEN;
+					break;
+				}
+				if (lz4_copy_match(s, s->hdr[0] | (s->hdr[1] << 8), s->match_len))
+					return -1;
+				s->state = LZ4_ST_TOKEN;
+				break;
+
+			case LZ4_ST_MATCH_LEN:
+				if (s->block_left == 0)
+					return -1;
+				c = *src++;
+				len--;
+				s->block_left--;
+				s->match_len += c;
+				if (c == 255)
+					break;
+				if (lz4_copy_match(s, s->hdr[0] | (s->hdr[1] << 8), s->match_len))
+					return -1;
+				s->state = LZ4_ST_TOKEN;
+				break;
+
+			case LZ4_ST_BLOCK_CSUM:
+			case LZ4_ST_CONTENT_CSUM:
+				n = len < s->block_left ? len : s->block_left;
+				src += n;
+				len -= n;
+				s->block_left -= n;
+				if (s->block_left)
+					break;
+				if (s->state == LZ4_ST_CONTENT_CSUM) {
+					s->state = LZ4_ST_DONE;
+					goto out;
+				}
+				lz4_expect(s, LZ4_ST_BLOCK_SIZE, 4);
+				break;
+
+			case LZ4_ST_DONE:
+				goto out;
+		}
+	}
+
+out:
+	s->in_size += src - (const uint8_t *) src_buf;
+	return s->state == LZ4_ST_DONE ? 1 : 0;
+}
+
+int lz4_stream_end(lz4_stream_t *s) {
+	if (s->state == LZ4_ST_DONE)
+		return 0;
+
+	/* legacy streams simply stop after a block */
+	if (s->legacy && s->state == LZ4_ST_BLOCK_SIZE && s->have == 0)
+		return 0;
+
+	printk_error("LZ4: truncated stream\n");
+	return -1;
+}
@@ -0,0 +1,135 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <types.h>
+
+#include <log.h>
+
+#include <manifest.h>
+
+static int hex_value(char c) {
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	return -1;
+}
+
+/* Text ends at a NUL byte or in erased flash */
+static inline bool is_text_end(char c) {
+	return c == '\0' || (uint8_t) c == 0xff;
+}
+
+static const char *skip_path_prefix(const char *name) {
+	if (name[0] == '.' && name[1] == '/')
+		name += 2;
+	while (*name == '/') name++;
+	return name;
+}
+
+static void print_digest(const char *prefix, const uint8_t *digest) {
+	printk(LOG_LEVEL_MUTE, "%s", prefix);
+	for (int i = 0; i < SHA256_DIGEST_SIZE; i++) printk(LOG_LEVEL_MUTE, "%02x", digest[i]);
+	printk(LOG_LEVEL_MUTE, "\n");
+}
+
+int manifest_parse(manifest_t *m, const char *text, uint32_t len) {
+	const char *end = text + len;
+	const char *p = text;
+	int line = 0;
+
+	m->count = 0;
+
+	while (p < end && !is_text_end(*p)) {
+		const char *eol = p;
+		manifest_entry_t *ent;
+		uint32_t n = 0;
+
+		while (eol < end && !is_text_end(*eol) && *eol != '\n') eol++;
+		line++;
+
+		/* Trim CR and trailing blanks */
+		const char *last = eol;
+		while (last > p && (last[-1] == '\r' || last[-1] == ' ' || last[-1] == '\t')) last--;
+
+		if (last == p || *p == '#')
+			goto next;
+
+		if (m->count >= MANIFEST_MAX_ENTRIES) {
+			printk_warning("MANIFEST: more than %d entries, ignoring the rest\n", MANIFEST_MAX_ENTRIES);
+			break;
+		}
+
+		ent = &m->entry[m->count];
+		if (last - p < SHA256_DIGEST_SIZE * 2 + 2)
+			goto bad_line;
+
+		for (int i = 0; i < SHA256_DIGEST_SIZE; i++) {
+			int hi = hex_value(p[i * 2]);
+			int lo = hex_value(p[i * 2 + 1]);
+			if (hi < 0 || lo < 0)
+				goto bad_line;
+			ent->digest[i] = (hi << 4) | lo;
+		}
+
+		p += SHA256_DIGEST_SIZE * 2;
+		if (*p != ' ' && *p != '\t')
+			goto bad_line;
+		while (p < last && (*p == ' ' || *p == '\t')) p++;
+		if (p < last && *p == '*')
+			p++;
+		if (p >= last)
+			goto bad_line;
+
+		while (p < last && n < MANIFEST_NAME_LEN - 1) ent->name[n++] = *p++;
+		ent->name[n] = '\0';
+
+		printk_debug("MANIFEST: %s\n", ent->name);
+		m->count++;
+	next:
+		p = eol + 1;
+		continue;
+
+	bad_line:
+		printk_error("MANIFEST: malformed line %d\n", line);
+		return -1;
+	}
+
+	return m->count ? m->count : -1;
+}
+
+const manifest_entry_t *manifest_find(const manifest_t *m, const char *name) {
+	name = skip_path_prefix(name);
+
+	for (int i = 0; i < m->count; i++) {
+		if (strcmp(skip_path_prefix(m->entry[i].name), name) == 0)
+			return &m->entry[i];
+	}
+
+	return NULL;
+}
+
+int manifest_verify(const manifest_t *m, const char *name, const uint8_t *digest) {
+	const manifest_entry_t *ent = manifest_find(m, name);
+
+	if (ent == NULL) {
+		printk_error("MANIFEST: %s is not listed\n", name);
+		return -1;
+	}
+
+	if (memcmp(ent->digest, digest, SHA256_DIGEST_SIZE)) {
+		printk_error("MANIFEST: %s digest mismatch\n", name);
+		print_digest("  expected ", ent->digest);
+		print_digest("  computed ", digest);
+		return -1;
+	}
+
+	printk_info("MANIFEST: %s verified\n", name);
+
+	return 0;
+}
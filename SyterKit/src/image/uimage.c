@@ -1,15 +1,227 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 #include <types.h>
 
 #include <log.h>
 
+#include <crc32.h>
+#include <lz4.h>
+
 #include "image_loader.h"
+#include "uimage.h"
+
+#if defined(__aarch64__)
+#define UIMAGE_ARCH_NATIVE UIMAGE_ARCH_ARM64
+#elif defined(__arm__)
+#define UIMAGE_ARCH_NATIVE UIMAGE_ARCH_ARM
+#elif defined(__riscv)
+#define UIMAGE_ARCH_NATIVE UIMAGE_ARCH_RISCV
+#endif
+
+/* Upper bound for a decompressed kernel */
+#define UIMAGE_LZ4_MAX_SIZE (0x02000000)
+
+static inline uint32_t get_be32(const void *p) {
+	const uint8_t *b = (const uint8_t *) p;
+	return ((uint32_t) b[0] << 24) | ((uint32_t) b[1] << 16) | ((uint32_t) b[2] << 8) | b[3];
+}
+
+static inline bool ranges_overlap(const uint8_t *a, uint32_t a_len, const uint8_t *b, uint32_t b_len) {
+	return a < b + b_len && b < a + a_len;
+}
+
+int uImage_check_header(const uimage_header_t *hdr) {
+	uimage_header_t tmp;
+
+	if (get_be32(&hdr->ih_magic) != UIMAGE_MAGIC)
+		return -1;
+
+	/* The header CRC is computed with its own field zeroed */
+	memcpy(&tmp, hdr, sizeof(tmp));
+	tmp.ih_hcrc = 0;
+	if (crc32(0, &tmp, sizeof(tmp)) != get_be32(&hdr->ih_hcrc)) {
+		printk_error("uImage: bad header CRC\n");
+		return -1;
+	}
+
+	return 0;
+}
+
+uint32_t uImage_size(const uimage_header_t *hdr) {
+	return sizeof(uimage_header_t) + get_be32(&hdr->ih_size);
+}
+
+/**
+ * @brief Find the components of a multi-file image.
+ *
+ * The data starts with a zero terminated table of big endian sizes,
+ * followed by the files, each padded to 4 bytes.
+ */
+static int uImage_split_multi(uint8_t *data, uint32_t data_size, uimage_info_t *info, uint8_t **kernel, uint32_t *kernel_size) {
+	uint32_t count = 0, offset, size;
+	uint8_t *file;
+
+	/* The size table, terminated by a zero entry, has to fit in the data */
+	for (;;) {
+		if ((count + 1) * 4 > data_size)
+			return -1;
+		if (get_be32(data + count * 4) == 0)
+			break;
+		count++;
+	}
+
+	if (count == 0)
+		return -1;
+
+	offset = (count + 1) * 4;
+	for (uint32_t i = 0; i < count; i++) {
+		size = get_be32(data + i * 4);
+		file = data + offset;
+		/* offset can pass data_size by the padding of the previous file */
+		if (offset > data_size || size > data_size - offset)
+			return -1;
+
+		/* Same order as U-Boot: kernel, ramdisk, device tree */
+		if (i == 0) {
+			*kernel = file;
+			*kernel_size = size;
+		} else if (i == 1) {
+			info->ramdisk = size ? file : NULL;
+			info->ramdisk_size = size;
+		} else if (i == 2) {
+			info->fdt = size ? file : NULL;
+			info->fdt_size = size;
+		}
+
+		offset += (size + 3) & ~3;
+	}
+
+	printk_debug("uImage: multi-file image with %u files\n", count);
+
+	return 0;
+}
 
-#define KERNEL_CODE_OFFSET_IN_UIMAGE 0x40
+int uImage_load(uint8_t *addr, uimage_info_t *info, bool check_data) {
+	uimage_header_t *hdr = (uimage_header_t *) addr;
+	uint8_t *data = addr + sizeof(uimage_header_t);
+	uint32_t data_size, load, ep;
+	uint8_t *kernel;
+	uint32_t kernel_size;
+	uint8_t *dst;
+
+	memset(info, 0, sizeof(*info));
+
+	if (uImage_check_header(hdr))
+		return -1;
+
+	data_size = get_be32(&hdr->ih_size);
+	load = get_be32(&hdr->ih_load);
+	ep = get_be32(&hdr->ih_ep);
+	memcpy(info->name, hdr->ih_name, UIMAGE_NAME_LEN);
+	info->name[UIMAGE_NAME_LEN] = '\0';
+
+	printk_debug("uImage: '%s' type %u os %u arch %u comp %u\n", info->name, hdr->ih_type, hdr->ih_os, hdr->ih_arch, hdr->ih_comp);
+	printk_debug("uImage: size 0x%x load 0x%08x entry 0x%08x\n", data_size, load, ep);
+
+#ifdef UIMAGE_ARCH_NATIVE
+	if (hdr->ih_arch != UIMAGE_ARCH_NATIVE) {
+		printk_error("uImage: built for arch %u\n", hdr->ih_arch);
+		return -1;
+	}
+#endif
+
+	if (check_data && crc32(0, data, data_size) != get_be32(&hdr->ih_dcrc)) {
+		printk_error("uImage: bad data CRC\n");
+		return -1;
+	}
+
+	switch (hdr->ih_type) {
+		case UIMAGE_TYPE_KERNEL:
+		case UIMAGE_TYPE_KERNEL_NOLOAD:
+			kernel = data;
+			kernel_size = data_size;
+			break;
+		case UIMAGE_TYPE_MULTI:
+			if (uImage_split_multi(data, data_size, info, &kernel, &kernel_size)) {
+				printk_error("uImage: bad multi-file size table\n");
+				return -1;
+			}
+			break;
+		default:
+			printk_error("uImage: type %u is not bootable\n", hdr->ih_type);
+			return -1;
+	}
+
+	/* Position independent kernel, run it where it is */
+	if (hdr->ih_type == UIMAGE_TYPE_KERNEL_NOLOAD) {
+		if (hdr->ih_comp != UIMAGE_COMP_NONE) {
+			printk_error("uImage: compressed NOLOAD kernel\n");
+			return -1;
+		}
+		info->kernel = kernel;
+		info->kernel_size = kernel_size;
+		info->entry = (uint32_t) kernel + (ep - load);
+		return 0;
+	}
+
+	dst = (uint8_t *) load;
+
+	if (hdr->ih_comp == UIMAGE_COMP_NONE) {
+		if (ranges_overlap(dst, kernel_size, info->ramdisk, info->ramdisk_size) || ranges_overlap(dst, kernel_size, info->fdt, info->fdt_size)) {
+			printk_error("uImage: load address 0x%08x overlaps the image\n", load);
+			return -1;
+		}
+
+		if (dst != kernel) {
+			printk_debug("uImage: move kernel 0x%08x -> 0x%08x\n", (uint32_t) kernel, load);
+			if (ranges_overlap(dst, kernel_size, kernel, kernel_size))
+				memmove(dst, kernel, kernel_size);
+			else
+				memcpy(dst, kernel, kernel_size);
+		}
+	} else if (hdr->ih_comp == UIMAGE_COMP_LZ4) {
+		uint32_t out_size = UIMAGE_LZ4_MAX_SIZE;
+		lz4_stream_t lz4;
+
+		/* The output doubles as the match history, it must not run into the input */
+		if (dst < addr && (uint32_t) (addr - dst) < out_size)
+			out_size = addr - dst;
+		if (ranges_overlap(dst, out_size, addr, sizeof(uimage_header_t) + data_size)) {
+			printk_error("uImage: load address 0x%08x overlaps the image\n", load);
+			return -1;
+		}
+
+		lz4_stream_init(&lz4, dst, out_size);
+		if (lz4_stream_feed(&lz4, kernel, kernel_size) < 0 || lz4_stream_end(&lz4)) {
+			printk_error("uImage: LZ4 decompression failed\n");
+			return -1;
+		}
+		kernel_size = lz4_stream_size(&lz4);
+	} else {
+		printk_error("uImage: compression %u is not supported\n", hdr->ih_comp);
+		return -1;
+	}
+
+	info->kernel = dst;
+	info->kernel_size = kernel_size;
+	info->entry = ep;
+
+	return 0;
+}
 
 int uImage_loader(uint8_t *addr, uint32_t *entry) {
-	*entry = (uint32_t) (addr + KERNEL_CODE_OFFSET_IN_UIMAGE);
-	return 1;
-}
\ No newline at end of file
+	uimage_info_t info;
+
+	if (get_be32(addr) != UIMAGE_MAGIC) {
+		printk_debug("uImage: no uImage at 0x%08x\n", (uint32_t) addr);
+		return -1;
+	}
+
+	if (uImage_load(addr, &info, true))
+		return -1;
+
+	*entry = info.entry;
+	return 0;
+}
@@ -10,30 +10,207 @@
 #include "uart.h"
 #include "xformat.h"
 
+#ifdef CONFIG_LOG_ASYNC
+
+#include <reg-ncat.h>
+
+#ifdef CONFIG_CHIP_GIC
+#include <sys-intc.h>
+#endif
+
+#ifdef __arm__
+#include <interrupt.h>
+#endif
+
+/* Must be a power of two, the ring lives in SRAM next to the stack */
+#ifndef CONFIG_LOG_RING_SIZE
+#define CONFIG_LOG_RING_SIZE 4096
+#endif
+
+#if CONFIG_LOG_RING_SIZE & (CONFIG_LOG_RING_SIZE - 1)
+#error "CONFIG_LOG_RING_SIZE must be a power of two"
+#endif
+
+#if defined(CONFIG_CHIP_GIC) && defined(AW_IRQ_UART0)
+#define LOG_RING_IRQ
+#endif
+
+extern sunxi_serial_t uart_dbg;
+
+static char log_ring[CONFIG_LOG_RING_SIZE];
+static volatile uint32_t log_head; /* Advanced by printk */
+static volatile uint32_t log_tail; /* Advanced by the drain */
+static bool log_irq_on;
+
+/* Producers and the drain may run from IRQ context, mask it around ring updates */
+#ifdef __arm__
+#define log_lock() arm32_interrupt_save()
+#define log_unlock(flags) arm32_interrupt_restore(flags)
+#else
+#define log_lock() 0
+#define log_unlock(flags) ((void) (flags))
+#endif
+
+/* Load the UART FIFO from the ring, called with the lock held */
+static void log_drain_locked(void) {
+	uint32_t head = log_head, tail = log_tail;
+	uint32_t off, n;
+
+	while (tail != head) {
+		off = tail & (CONFIG_LOG_RING_SIZE - 1);
+		n = head - tail;
+		if (n > CONFIG_LOG_RING_SIZE - off)
+			n = CONFIG_LOG_RING_SIZE - off;
+		n = sunxi_serial_write_nowait(&uart_dbg, &log_ring[off], n);
+		if (n == 0)
+			break;
+		tail += n;
+	}
+
+	log_tail = tail;
+}
+
+static void log_ring_putc(char c) {
+	/* A full ring falls back to waiting on the UART, nothing is dropped */
+	while (log_head - log_tail >= CONFIG_LOG_RING_SIZE)
+		log_drain_locked();
+
+	log_ring[log_head & (CONFIG_LOG_RING_SIZE - 1)] = c;
+	log_head++;
+}
+
+static void log_putchar(void *arg, char c) {
+	if (c == '\n')
+		log_ring_putc('\r');
+	log_ring_putc(c);
+}
+
+/* Start draining a newly queued message, called with the lock held */
+static void log_kick(void) {
+#ifdef LOG_RING_IRQ
+	if (log_irq_on) {
+		sunxi_serial_tx_irq(&uart_dbg, true);
+		return;
+	}
+#endif
+	log_drain_locked();
+}
+
+void log_ring_replay(void (*putc)(char c)) {
+	uint32_t head = log_head;
+	uint32_t i = head > CONFIG_LOG_RING_SIZE ? head - CONFIG_LOG_RING_SIZE : 0;
+
+	for (; i != head; i++) {
+		char c = log_ring[i & (CONFIG_LOG_RING_SIZE - 1)];
+		if (c != '\r')
+			putc(c);
+	}
+}
+
+void log_poll(void) {
+	uint32_t flags;
+
+	if (log_tail == log_head)
+		return;
+
+	flags = log_lock();
+	log_drain_locked();
+	log_unlock(flags);
+}
+
+void log_flush(void) {
+	while (log_tail != log_head)
+		log_poll();
+
+	sunxi_serial_flush(&uart_dbg);
+}
+
+#ifdef LOG_RING_IRQ
+static void log_uart_irq_handler(void *data) {
+	sunxi_serial_irq_ack(&uart_dbg);
+	log_drain_locked();
+	if (log_tail == log_head)
+		sunxi_serial_tx_irq(&uart_dbg, false);
+}
+#endif
+
+int log_irq_init(void) {
+#ifdef LOG_RING_IRQ
+	irq_install_handler(AW_IRQ_UART0 + uart_dbg.id, log_uart_irq_handler, NULL);
+	irq_enable(AW_IRQ_UART0 + uart_dbg.id);
+	log_irq_on = true;
+	return 0;
+#else
+	return -1;
+#endif
+}
+
+void log_irq_exit(void) {
+#ifdef LOG_RING_IRQ
+	if (!log_irq_on)
+		return;
+
+	uint32_t flags = log_lock();
+	log_irq_on = false;
+	sunxi_serial_tx_irq(&uart_dbg, false);
+	irq_disable(AW_IRQ_UART0 + uart_dbg.id);
+	log_unlock(flags);
+	irq_free_handler(AW_IRQ_UART0 + uart_dbg.id);
+#endif
+	log_flush();
+}
+
+#else
+
+#define log_putchar uart_log_putchar
+#define log_lock() 0
+#define log_unlock(flags) ((void) (flags))
+#define log_kick() ((void) 0)
+
+#endif// CONFIG_LOG_ASYNC
+
+#ifdef CONFIG_LOG_RAMOOPS
+/* Every printk character also goes to the ramoops console zone */
+static void log_emit(void *arg, char c) {
+	log_ramoops_putc(c);
+	log_putchar(arg, c);
+}
+#else
+#define log_emit log_putchar
+#endif
+
+static void log_printf(const char *fmt, ...) {
+	va_list args;
+	va_start(args, fmt);
+	xvformat(log_emit, NULL, fmt, args);
+	va_end(args);
+}
+
 void printk(int level, const char *fmt, ...) {
 	uint32_t now_timestamp = time_us() - get_init_timestamp();
 	uint32_t seconds = now_timestamp / (1000 * 1000);
 	uint32_t milliseconds = now_timestamp % (1000 * 1000);
+	uint32_t flags = log_lock();
 
 #ifdef DISBALE_COLOR_PRINTK
 	switch (level) {
 		case LOG_LEVEL_TRACE:
-			uart_printf("[%5lu.%06lu][T] ", seconds, milliseconds);
+			log_printf("[%5lu.%06lu][T] ", seconds, milliseconds);
 			break;
 		case LOG_LEVEL_DEBUG:
-			uart_printf("[%5lu.%06lu][D] ", seconds, milliseconds);
+			log_printf("[%5lu.%06lu][D] ", seconds, milliseconds);
 			break;
 		case LOG_LEVEL_INFO:
-			uart_printf("[%5lu.%06lu][I] ", seconds, milliseconds);
+			log_printf("[%5lu.%06lu][I] ", seconds, milliseconds);
 			break;
 		case LOG_LEVEL_WARNING:
-			uart_printf("[%5lu.%06lu][W] ", seconds, milliseconds);
+			log_printf("[%5lu.%06lu][W] ", seconds, milliseconds);
 			break;
 		case LOG_LEVEL_ERROR:
-			uart_printf("[%5lu.%06lu][E] ", seconds, milliseconds);
+			log_printf("[%5lu.%06lu][E] ", seconds, milliseconds);
 			break;
 		case LOG_LEVEL_BACKTRACE:
-			uart_printf("[%5lu.%06lu][B] ", seconds, milliseconds);
+			log_printf("[%5lu.%06lu][B] ", seconds, milliseconds);
 		case LOG_LEVEL_MUTE:
 		default:
 			break;
@@ -41,22 +218,22 @@ void printk(int level, const char *fmt, ...) {
 #else
 	switch (level) {
 		case LOG_LEVEL_TRACE:
-			uart_printf("[%5lu.%06lu][\033[30mT\033[37m] ", seconds, milliseconds);
+			log_printf("[%5lu.%06lu][\033[30mT\033[37m] ", seconds, milliseconds);
 			break;
 		case LOG_LEVEL_DEBUG:
-			uart_printf("[%5lu.%06lu][\033[32mD\033[37m] ", seconds, milliseconds);
+			log_printf("[%5lu.%06lu][\033[32mD\033[37m] ", seconds, milliseconds);
 			break;
 		case LOG_LEVEL_INFO:
-			uart_printf("[%5lu.%06lu][\033[36mI\033[37m] ", seconds, milliseconds);
+			log_printf("[%5lu.%06lu][\033[36mI\033[37m] ", seconds, milliseconds);
 			break;
 		case LOG_LEVEL_WARNING:
-			uart_printf("[%5lu.%06lu][\033[33mW\033[37m] ", seconds, milliseconds);
+			log_printf("[%5lu.%06lu][\033[33mW\033[37m] ", seconds, milliseconds);
 			break;
 		case LOG_LEVEL_ERROR:
-			uart_printf("[%5lu.%06lu][\033[31mE\033[37m] ", seconds, milliseconds);
+			log_printf("[%5lu.%06lu][\033[31mE\033[37m] ", seconds, milliseconds);
 			break;
 		case LOG_LEVEL_BACKTRACE:
-			uart_printf("[%5lu.%06lu][\033[38;5;214mB\033[37m] ", seconds, milliseconds);
+			log_printf("[%5lu.%06lu][\033[38;5;214mB\033[37m] ", seconds, milliseconds);
 		case LOG_LEVEL_MUTE:
 		default:
 			break;
@@ -66,12 +243,17 @@ void printk(int level, const char *fmt, ...) {
 	va_start(args, fmt);
 	va_list args_copy;
 	va_copy(args_copy, args);
-	xvformat(uart_log_putchar, NULL, fmt, args_copy);
+	xvformat(log_emit, NULL, fmt, args_copy);
 	va_end(args);
 	va_end(args_copy);
+
+	log_kick();
+	log_unlock(flags);
 }
 
 void uart_printf(const char *fmt, ...) {
+	log_flush();
+
 	va_list args;
 	va_start(args, fmt);
 	va_list args_copy;
@@ -82,6 +264,8 @@ void uart_printf(const char *fmt, ...) {
 }
 
 int printf(const char *fmt, ...) {
+	log_flush();
+
 	va_list args;
 	va_start(args, fmt);
 	va_list args_copy;
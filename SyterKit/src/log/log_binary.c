@@ -0,0 +1,69 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <timer.h>
+#include <types.h>
+
+#include "log.h"
+
+#ifdef __arm__
+#include <interrupt.h>
+#endif
+
+#ifdef CONFIG_LOG_BINARY
+
+#if CONFIG_LOG_BINARY_RING_WORDS & (CONFIG_LOG_BINARY_RING_WORDS - 1)
+#error "CONFIG_LOG_BINARY_RING_WORDS must be a power of two"
+#endif
+
+#define LOG_BINARY_MASK (CONFIG_LOG_BINARY_RING_WORDS - 1)
+
+/* Flight recorder, the newest records overwrite the oldest */
+static uint32_t log_binary_ring[CONFIG_LOG_BINARY_RING_WORDS];
+static volatile uint32_t log_binary_head;
+
+void log_binary(int level, const char *fmt, const uint32_t *args, uint32_t nargs) {
+	uint32_t now = time_us() - get_init_timestamp();
+	uint32_t head;
+#ifdef __arm__
+	uint32_t flags = arm32_interrupt_save();
+#endif
+
+	head = log_binary_head;
+	log_binary_ring[head++ & LOG_BINARY_MASK] = LOG_BINARY_MAGIC | ((level & 0xff) << 8) | (nargs & 0xff);
+	log_binary_ring[head++ & LOG_BINARY_MASK] = now;
+	log_binary_ring[head++ & LOG_BINARY_MASK] = (uint32_t) (uintptr_t) fmt;
+	for (uint32_t i = 0; i < nargs; i++)
+		log_binary_ring[head++ & LOG_BINARY_MASK] = args[i];
+	log_binary_head = head;
+
+#ifdef __arm__
+	arm32_interrupt_restore(flags);
+#endif
+}
+
+uint32_t log_binary_float(double v) {
+	union {
+		float f;
+		uint32_t u;
+	} bits = {.f = (float) v};
+
+	return bits.u;
+}
+
+void log_binary_dump(void) {
+	uint32_t head = log_binary_head;
+	uint32_t start = head > CONFIG_LOG_BINARY_RING_WORDS ? head - CONFIG_LOG_BINARY_RING_WORDS : 0;
+
+	printk(LOG_LEVEL_MUTE, "binlog: ring 0x%08x, %u words, head %u\n", (uint32_t) log_binary_ring, CONFIG_LOG_BINARY_RING_WORDS, head);
+	for (uint32_t i = start; i < head; i += 8) {
+		printk(LOG_LEVEL_MUTE, "BL %08x:", i);
+		for (uint32_t j = i; j < i + 8 && j < head; j++)
+			printk(LOG_LEVEL_MUTE, " %08x", log_binary_ring[j & LOG_BINARY_MASK]);
+		printk(LOG_LEVEL_MUTE, "\n");
+	}
+}
+
+#endif// CONFIG_LOG_BINARY
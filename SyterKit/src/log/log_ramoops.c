@@ -0,0 +1,136 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <types.h>
+
+#include <cache.h>
+#include <log.h>
+#include <xformat.h>
+
+#include <fdt_wrapper.h>
+
+#include "libfdt.h"
+
+#ifdef CONFIG_LOG_RAMOOPS
+
+/* Header of a Linux pstore persistent_ram_zone, the console zone signature is "DBGC" */
+#define RAMOOPS_SIG 0x43474244
+
+typedef struct {
+	uint32_t sig;	/**< RAMOOPS_SIG */
+	uint32_t start; /**< Next write offset in data */
+	uint32_t size;	/**< Valid bytes in data */
+	uint8_t data[];
+} ramoops_buffer_t;
+
+static ramoops_buffer_t *ramoops_buf;
+static uint32_t ramoops_base, ramoops_size, ramoops_data_size;
+
+void log_ramoops_putc(char c) {
+	ramoops_buffer_t *buf = ramoops_buf;
+
+	if (buf == NULL)
+		return;
+
+	buf->data[buf->start] = c;
+	if (++buf->start == ramoops_data_size)
+		buf->start = 0;
+	if (buf->size < ramoops_data_size)
+		buf->size++;
+}
+
+int log_ramoops_init(uint32_t base, uint32_t size) {
+	if (size <= sizeof(ramoops_buffer_t) || (base & 0x3))
+		return -1;
+
+	ramoops_buf = (ramoops_buffer_t *) base;
+	ramoops_base = base;
+	ramoops_size = size;
+	ramoops_data_size = size - sizeof(ramoops_buffer_t);
+
+	/* A new boot log replaces the console record of the previous boot */
+	ramoops_buf->sig = RAMOOPS_SIG;
+	ramoops_buf->start = 0;
+	ramoops_buf->size = 0;
+
+#ifdef CONFIG_LOG_ASYNC
+	/* Messages from before DRAM init are still in the SRAM log ring */
+	log_ring_replay(log_ramoops_putc);
+#endif
+
+	printk_debug("RAMOOPS: console log at 0x%08x, %u bytes\n", base, size);
+	return 0;
+}
+
+static void name_putc(void *arg, char c) {
+	char **p = (char **) arg;
+	*(*p)++ = c;
+}
+
+int log_ramoops_fdt_export(void *fdt) {
+	uint32_t reg[4];
+	char name[32], *p = name;
+	int root, resv, node, ac, sc, n = 0, ret;
+
+	if (ramoops_buf == NULL)
+		return -1;
+
+	ret = fdt_increase_size(fdt, 512);
+	if (ret)
+		goto err;
+
+	root = fdt_path_offset(fdt, "/");
+	resv = fdt_find_or_add_subnode(fdt, root, "reserved-memory");
+	if (resv < 0)
+		goto err;
+
+	/* A new /reserved-memory node follows the root address layout */
+	if (fdt_getprop(fdt, resv, "ranges", NULL) == NULL) {
+		fdt_setprop_u32(fdt, resv, "#address-cells", fdt_address_cells(fdt, root));
+		fdt_setprop_u32(fdt, resv, "#size-cells", fdt_size_cells(fdt, root));
+		fdt_setprop_empty(fdt, resv, "ranges");
+	}
+
+	ac = fdt_address_cells(fdt, resv);
+	sc = fdt_size_cells(fdt, resv);
+	if (ac < 1 || ac > 2 || sc < 1 || sc > 2)
+		goto err;
+
+	xformat(name_putc, &p, "ramoops@%x", ramoops_base);
+	*p = '\0';
+	node = fdt_find_or_add_subnode(fdt, resv, name);
+	if (node < 0)
+		goto err;
+
+	if (ac == 2)
+		reg[n++] = 0;
+	reg[n++] = cpu_to_fdt32(ramoops_base);
+	if (sc == 2)
+		reg[n++] = 0;
+	reg[n++] = cpu_to_fdt32(ramoops_size);
+
+	/* The whole region is the console zone, so Linux finds it right at the base */
+	ret = fdt_setprop_string(fdt, node, "compatible", "ramoops");
+	ret |= fdt_setprop(fdt, node, "reg", reg, n * sizeof(uint32_t));
+	ret |= fdt_setprop_u32(fdt, node, "console-size", ramoops_size);
+	ret |= fdt_setprop_u32(fdt, node, "record-size", 0);
+	ret |= fdt_setprop_u32(fdt, node, "ftrace-size", 0);
+	ret |= fdt_setprop_u32(fdt, node, "pmsg-size", 0);
+	if (ret)
+		goto err;
+
+	/* Linux maps the zone uncached, push out what is still in the data cache */
+	flush_dcache_range(ramoops_base, ramoops_base + ramoops_size);
+
+	printk_debug("RAMOOPS: added /reserved-memory/%s\n", name);
+	return 0;
+
+err:
+	printk_warning("RAMOOPS: cannot add the ramoops node to the FDT\n");
+	return -1;
+}
+
+#endif// CONFIG_LOG_RAMOOPS
@@ -0,0 +1,191 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <types.h>
+
+#include <log.h>
+
+#include <part.h>
+
+/* GPT header field offsets */
+#define GPT_HDR_ENTRIES_LBA 72
+#define GPT_HDR_NUM_ENTRIES 80
+#define GPT_HDR_ENTRY_SIZE 84
+
+/* GPT partition entry field offsets */
+#define GPT_ENT_TYPE_GUID 0
+#define GPT_ENT_FIRST_LBA 32
+#define GPT_ENT_LAST_LBA 40
+#define GPT_ENT_NAME 56
+
+/* MBR layout */
+#define MBR_PART_OFFSET 0x1BE
+#define MBR_PART_SIZE 16
+#define MBR_SIG_OFFSET 0x1FE
+
+static uint8_t part_buf[PART_SECTOR_SIZE] __attribute__((aligned(64)));
+
+static inline uint32_t get_le32(const uint8_t *p) {
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static inline uint64_t get_le64(const uint8_t *p) {
+	return get_le32(p) | ((uint64_t) get_le32(p + 4) << 32);
+}
+
+static bool guid_is_zero(const uint8_t *guid) {
+	for (int i = 0; i < 16; i++) {
+		if (guid[i])
+			return false;
+	}
+	return true;
+}
+
+static int part_scan_gpt(part_table_t *table) {
+	uint64_t entries_lba;
+	uint32_t num_entries, entry_size, per_sector;
+
+	if (table->read(table->ctx, part_buf, 1, 1) != 1)
+		return -1;
+
+	if (memcmp(part_buf, GPT_HEADER_SIGNATURE, 8))
+		return -1;
+
+	entries_lba = get_le64(part_buf + GPT_HDR_ENTRIES_LBA);
+	num_entries = get_le32(part_buf + GPT_HDR_NUM_ENTRIES);
+	entry_size = get_le32(part_buf + GPT_HDR_ENTRY_SIZE);
+
+	if (entry_size < 128 || entry_size > PART_SECTOR_SIZE || PART_SECTOR_SIZE % entry_size) {
+		printk_warning("GPT: bad entry size %u\n", entry_size);
+		return -1;
+	}
+	per_sector = PART_SECTOR_SIZE / entry_size;
+
+	printk_debug("GPT: %u entries at LBA %u\n", num_entries, (uint32_t) entries_lba);
+
+	table->is_gpt = true;
+	table->count = 0;
+
+	for (uint32_t i = 0; i < num_entries && table->count < PART_MAX_ENTRIES; i++) {
+		const uint8_t *ent;
+		part_entry_t *part;
+
+		if (i % per_sector == 0 && table->read(table->ctx, part_buf, entries_lba + i / per_sector, 1) != 1)
+			return -1;
+
+		ent = part_buf + (i % per_sector) * entry_size;
+		if (guid_is_zero(ent + GPT_ENT_TYPE_GUID))
+			continue;
+
+		part = &table->part[table->count++];
+		memset(part, 0, sizeof(*part));
+		memcpy(part->type_guid, ent + GPT_ENT_TYPE_GUID, 16);
+		part->start_lba = get_le64(ent + GPT_ENT_FIRST_LBA);
+		part->num_lba = get_le64(ent + GPT_ENT_LAST_LBA) - part->start_lba + 1;
+
+		/* UTF-16LE label, keep the ASCII part only */
+		for (int c = 0; c < PART_NAME_LEN; c++) {
+			uint8_t lo = ent[GPT_ENT_NAME + c * 2];
+			uint8_t hi = ent[GPT_ENT_NAME + c * 2 + 1];
+			if (lo == 0 && hi == 0)
+				break;
+			part->name[c] = hi ? '?' : (char) lo;
+		}
+	}
+
+	return table->count;
+}
+
+static int part_scan_mbr(part_table_t *table) {
+	if (table->read(table->ctx, part_buf, 0, 1) != 1)
+		return -1;
+
+	if ((part_buf[MBR_SIG_OFFSET] | (part_buf[MBR_SIG_OFFSET + 1] << 8)) != MBR_SIGNATURE)
+		return -1;
+
+	table->is_gpt = false;
+	table->count = 0;
+
+	for (int i = 0; i < 4; i++) {
+		const uint8_t *ent = part_buf + MBR_PART_OFFSET + i * MBR_PART_SIZE;
+		part_entry_t *part;
+
+		if (ent[4] == 0 || ent[4] == MBR_TYPE_GPT_PROTECTIVE)
+			continue;
+
+		part = &table->part[table->count++];
+		memset(part, 0, sizeof(*part));
+		part->mbr_type = ent[4];
+		part->start_lba = get_le32(ent + 8);
+		part->num_lba = get_le32(ent + 12);
+	}
+
+	return table->count;
+}
+
+int part_scan(part_table_t *table, part_blk_read_t read, void *ctx) {
+	int ret;
+
+	table->read = read;
+	table->ctx = ctx;
+	table->count = 0;
+
+	ret = part_scan_gpt(table);
+	if (ret < 0)
+		ret = part_scan_mbr(table);
+
+	if (ret < 0)
+		printk_debug("PART: no partition table found\n");
+
+	return ret;
+}
+
+part_entry_t *part_find_by_name(part_table_t *table, const char *name) {
+	for (int i = 0; i < table->count; i++) {
+		if (strcmp(table->part[i].name, name) == 0)
+			return &table->part[i];
+	}
+	return NULL;
+}
+
+part_entry_t *part_find_by_type(part_table_t *table, const uint8_t *guid) {
+	for (int i = 0; i < table->count; i++) {
+		if (memcmp(table->part[i].type_guid, guid, 16) == 0)
+			return &table->part[i];
+	}
+	return NULL;
+}
+
+part_entry_t *part_find_by_mbr_type(part_table_t *table, uint8_t type) {
+	for (int i = 0; i < table->count; i++) {
+		if (table->part[i].mbr_type == type)
+			return &table->part[i];
+	}
+	return NULL;
+}
+
+uint32_t part_load(part_table_t *table, part_entry_t *part, void *dest, uint32_t size) {
+	uint64_t count = size ? (size + PART_SECTOR_SIZE - 1) / PART_SECTOR_SIZE : part->num_lba;
+
+	if (count > part->num_lba) {
+		printk_warning("PART: %s: 0x%x bytes exceeds partition size\n", part->name, size);
+		count = part->num_lba;
+	}
+
+	if (table->read(table->ctx, (uint8_t *) dest, part->start_lba, (uint32_t) count) != count)
+		return 0;
+
+	return (uint32_t) count * PART_SECTOR_SIZE;
+}
+
+void part_dump(part_table_t *table) {
+	printk(LOG_LEVEL_MUTE, "%s partition table, %d entries\n", table->is_gpt ? "GPT" : "MBR", table->count);
+	for (int i = 0; i < table->count; i++) {
+		part_entry_t *part = &table->part[i];
+		printk(LOG_LEVEL_MUTE, "  %2d: start %8u size %8u type 0x%02x name '%s'\n", i, (uint32_t) part->start_lba, (uint32_t) part->num_lba,
+			   table->is_gpt ? part->type_guid[0] : part->mbr_type, part->name);
+	}
+}
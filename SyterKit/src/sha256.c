@@ -0,0 +1,244 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <types.h>
+
+#include <log.h>
+
+#include <sha256.h>
+
+#ifdef CONFIG_CHIP_SMP
+#include <smp.h>
+#endif
+
+static const uint32_t sha256_k[64] = {
+		0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be,
+		0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa,
+		0x5cb0a9dc, 0x76f988da, 0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967, 0x27b70a85,
+		0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+		0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070, 0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f,
+		0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+#define ROR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+#define CH(x, y, z) ((z) ^ ((x) & ((y) ^ (z))))
+#define MAJ(x, y, z) (((x) & (y)) | ((z) & ((x) | (y))))
+#define S0(x) (ROR(x, 2) ^ ROR(x, 13) ^ ROR(x, 22))
+#define S1(x) (ROR(x, 6) ^ ROR(x, 11) ^ ROR(x, 25))
+#define s0(x) (ROR(x, 7) ^ ROR(x, 18) ^ ((x) >> 3))
+#define s1(x) (ROR(x, 17) ^ ROR(x, 19) ^ ((x) >> 10))
+
+/* Message schedule kept in a 16 word window, expanded in place */
+#define W(i) w[(i) & 15]
+#define EXPAND(i) (W(i) += s1(W((i) - 2)) + W((i) - 7) + s0(W((i) - 15)))
+
+/* Rotate the variable names instead of the values, 8 rounds per iteration */
+#define ROUND(a, b, c, d, e, f, g, h, i, wi)            \
+	do {                                                \
+		h += S1(e) + CH(e, f, g) + sha256_k[i] + (wi);  \
+		d += h;                                         \
+		h += S0(a) + MAJ(a, b, c);                      \
+	} while (0)
+
+static inline uint32_t get_be32(const uint8_t *p) {
+	return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | p[3];
+}
+
+static inline void put_be32(uint8_t *p, uint32_t v) {
+	p[0] = v >> 24;
+	p[1] = v >> 16;
+	p[2] = v >> 8;
+	p[3] = v;
+}
+
+static void sha256_blocks(uint32_t *state, const uint8_t *data, uint32_t nblocks) {
+	uint32_t a, b, c, d, e, f, g, h;
+	uint32_t w[16];
+	int i;
+
+	while (nblocks--) {
+		a = state[0];
+		b = state[1];
+		c = state[2];
+		d = state[3];
+		e = state[4];
+		f = state[5];
+		g = state[6];
+		h = state[7];
+
+		for (i = 0; i < 16; i++) w[i] = get_be32(data + i * 4);
+
+		for (i = 0; i < 16; i += 8) {
+			ROUND(a, b, c, d, e, f, g, h, i + 0, W(i + 0));
+			ROUND(h, a, b, c, d, e, f, g, i + 1, W(i + 1));
+			ROUND(g, h, a, b, c, d, e, f, i + 2, W(i + 2));
+			ROUND(f, g, h, a, b, c, d, e, i + 3, W(i + 3));
+			ROUND(e, f, g, h, a, b, c, d, i + 4, W(i + 4));
+			ROUND(d, e, f, g, h, a, b, c, i + 5, W(i + 5));
+			ROUND(c, d, e, f, g, h, a, b, i + 6, W(i + 6));
+			ROUND(b, c, d, e, f, g, h, a, i + 7, W(i + 7));
+		}
+
+		for (; i < 64; i += 8) {
+			ROUND(a, b, c, d, e, f, g, h, i + 0, EXPAND(i + 0));
+			ROUND(h, a, b, c, d, e, f, g, i + 1, EXPAND(i + 1));
+			ROUND(g, h, a, b, c, d, e, f, i + 2, EXPAND(i + 2));
+			ROUND(f, g, h, a, b, c, d, e, i + 3, EXPAND(i + 3));
+			ROUND(e, f, g, h, a, b, c, d, i + 4, EXPAND(i + 4));
+			ROUND(d, e, f, g, h, a, b, c, i + 5, EXPAND(i + 5));
+			ROUND(c, d, e, f, g, h, a, b, i + 6, EXPAND(i + 6));
+			ROUND(b, c, d, e, f, g, h, a, i + 7, EXPAND(i + 7));
+		}
+
+		state[0] += a;
+		state[1] += b;
+		state[2] += c;
+		state[3] += d;
+		state[4] += e;
+		state[5] += f;
+		state[6] += g;
+		state[7] += h;
+
+		data += SHA256_BLOCK_SIZE;
+	}
+}
+
+void sha256_init(sha256_ctx_t *ctx) {
+	ctx->state[0] = 0x6a09e667;
+	ctx->state[1] = 0xbb67ae85;
+	ctx->state[2] = 0x3c6ef372;
+	ctx->state[3] = 0xa54ff53a;
+	ctx->state[4] = 0x510e527f;
+	ctx->state[5] = 0x9b05688c;
+	ctx->state[6] = 0x1f83d9ab;
+	ctx->state[7] = 0x5be0cd19;
+	ctx->count = 0;
+	ctx->ticket = -1;
+}
+
+void sha256_update(sha256_ctx_t *ctx, const void *data, uint32_t len) {
+	const uint8_t *p = (const uint8_t *) data;
+	uint32_t used = ctx->count % SHA256_BLOCK_SIZE;
+	uint32_t n;
+
+	ctx->count += len;
+
+	if (used) {
+		n = SHA256_BLOCK_SIZE - used;
+		if (n > len)
+			n = len;
+		memcpy(ctx->buf + used, p, n);
+		p += n;
+		len -= n;
+		if (used + n < SHA256_BLOCK_SIZE)
+			return;
+		sha256_blocks(ctx->state, ctx->buf, 1);
+	}
+
+	/* Whole blocks are hashed straight from the source */
+	if (len >= SHA256_BLOCK_SIZE) {
+		sha256_blocks(ctx->state, p, len / SHA256_BLOCK_SIZE);
+		p += len & ~(SHA256_BLOCK_SIZE - 1);
+		len %= SHA256_BLOCK_SIZE;
+	}
+
+	if (len)
+		memcpy(ctx->buf, p, len);
+}
+
+#ifdef CONFIG_CHIP_SMP
+typedef struct {
+	sha256_ctx_t *ctx;
+	const void *data;
+	uint32_t len;
+	int ticket; /* Ticket of the update using this slot, -1 if free */
+} sha256_job_t;
+
+static sha256_job_t sha256_jobs[SMP_QUEUE_LEN] = {[0 ... SMP_QUEUE_LEN - 1] = {.ticket = -1}};
+static uint32_t sha256_job_seq;
+
+static int sha256_job_run(void *arg) {
+	sha256_job_t *job = (sha256_job_t *) arg;
+	sha256_update(job->ctx, job->data, job->len);
+	return 0;
+}
+
+void sha256_update_async(sha256_ctx_t *ctx, const void *data, uint32_t len) {
+	sha256_job_t *job = &sha256_jobs[sha256_job_seq++ % SMP_QUEUE_LEN];
+
+	/* The slot may still belong to an update in flight */
+	if (job->ticket >= 0) {
+		smp_wait(job->ticket);
+		job->ticket = -1;
+	}
+
+	job->ctx = ctx;
+	job->data = data;
+	job->len = len;
+	job->ticket = smp_run_async(sha256_job_run, job);
+
+	/* CPU1 is not running or its queue is full of other work */
+	if (job->ticket < 0) {
+		sha256_wait(ctx);
+		sha256_update(ctx, data, len);
+		return;
+	}
+
+	ctx->ticket = job->ticket;
+}
+
+void sha256_wait(sha256_ctx_t *ctx) {
+	if (ctx->ticket >= 0) {
+		smp_wait(ctx->ticket);
+		ctx->ticket = -1;
+	}
+
+	/* Updates run in order, all slots of this context are done and free now */
+	for (int i = 0; i < SMP_QUEUE_LEN; i++) {
+		if (sha256_jobs[i].ctx == ctx)
+			sha256_jobs[i].ticket = -1;
+	}
+}
+#else
+void sha256_update_async(sha256_ctx_t *ctx, const void *data, uint32_t len) {
+	sha256_update(ctx, data, len);
+}
+
+void sha256_wait(sha256_ctx_t *ctx) {
+	(void) ctx;
+}
+#endif
+
+void sha256_final(sha256_ctx_t *ctx, uint8_t *digest) {
+	uint32_t used;
+	uint64_t bits;
+
+	sha256_wait(ctx);
+
+	used = ctx->count % SHA256_BLOCK_SIZE;
+	bits = ctx->count * 8;
+
+	ctx->buf[used++] = 0x80;
+	if (used > SHA256_BLOCK_SIZE - 8) {
+		memset(ctx->buf + used, 0, SHA256_BLOCK_SIZE - used);
+		sha256_blocks(ctx->state, ctx->buf, 1);
+		used = 0;
+	}
+	memset(ctx->buf + used, 0, SHA256_BLOCK_SIZE - 8 - used);
+	put_be32(ctx->buf + 56, (uint32_t) (bits >> 32));
+	put_be32(ctx->buf + 60, (uint32_t) bits);
+	sha256_blocks(ctx->state, ctx->buf, 1);
+
+	for (int i = 0; i < 8; i++) put_be32(digest + i * 4, ctx->state[i]);
+}
+
+void sha256(const void *data, uint32_t len, uint8_t *digest) {
+	sha256_ctx_t ctx;
+
+	sha256_init(&ctx);
+	sha256_update(&ctx, data, len);
+	sha256_final(&ctx, digest);
+}
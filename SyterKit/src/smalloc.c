@@ -6,122 +6,438 @@
 #include <string.h>
 #include <types.h>
 
+#include <log.h>
+
 #include "smalloc.h"
 
-static struct alloc_struct_t boot_heap_head, boot_heap_tail;
+/*
+ * Two level segregated fit (TLSF) allocator.
+ *
+ * Free blocks are kept in size class lists: the first level splits sizes
+ * by power of two, the second level splits each power of two range in
+ * SL_COUNT linear steps. Blocks below SMALL_BLOCK all go to first level 0
+ * in SMALLOC_ALIGN steps. Two bitmaps tell which lists are not empty, so
+ * allocation and free are O(1). Neighbouring free blocks are always merged.
+ */
 
-int32_t smalloc_init(uint32_t p_heap_head, uint32_t n_heap_size) {
-	boot_heap_head.size = boot_heap_tail.size = 0;
-	boot_heap_head.address = p_heap_head;
-	boot_heap_tail.address = p_heap_head + n_heap_size;
-	boot_heap_head.next = &boot_heap_tail;
-	boot_heap_tail.next = 0;
-	return 0;
+#define SMALLOC_ALIGN_LOG2 4
+#define SMALLOC_ALIGN (1 << SMALLOC_ALIGN_LOG2)
+
+#define SL_LOG2 4
+#define SL_COUNT (1 << SL_LOG2)
+#define FL_SHIFT (SL_LOG2 + SMALLOC_ALIGN_LOG2)
+#define FL_MAX 30
+#define FL_COUNT (FL_MAX - FL_SHIFT + 2)
+#define SMALL_BLOCK (1 << FL_SHIFT)
+#define SMALLOC_MAX_SIZE (1u << FL_MAX)
+
+#define BLOCK_FREE 0x1
+#define BLOCK_PREV_FREE 0x2
+#define BLOCK_FLAGS (SMALLOC_ALIGN - 1)
+
+typedef struct smalloc_block {
+	struct smalloc_block *prev_phys; /* Block right below in memory */
+	uint32_t size;					 /* Payload size, flags in the low bits */
+	struct smalloc_block *next_free; /* Free list links, valid while free */
+	struct smalloc_block *prev_free;
+} __attribute__((aligned(SMALLOC_ALIGN))) smalloc_block_t;
+
+#define BLOCK_HDR ((uint32_t) sizeof(smalloc_block_t))
+
+static struct {
+	uint32_t fl_bitmap;
+	uint32_t sl_bitmap[FL_COUNT];
+	smalloc_block_t *blocks[FL_COUNT][SL_COUNT];
+	smalloc_block_t *first;
+	uint32_t total;
+	uint32_t used;
+	uint32_t peak;
+	uint32_t allocs;
+	uint32_t failures;
+} heap;
+
+static inline int smalloc_fls(uint32_t x) {
+	return 31 - __builtin_clz(x);
 }
 
-void *smalloc(uint32_t num_bytes) {
-	struct alloc_struct_t *ptr, *newptr;
-	uint32_t actual_bytes;
+static inline int smalloc_ffs(uint32_t x) {
+	return __builtin_ctz(x);
+}
 
-	if (!num_bytes)
-		return 0;
+static inline uint32_t block_size(const smalloc_block_t *b) {
+	return b->size & ~BLOCK_FLAGS;
+}
 
-	actual_bytes = BYTE_ALIGN(num_bytes);
+static inline void *block_payload(smalloc_block_t *b) {
+	return (uint8_t *) b + BLOCK_HDR;
+}
 
-	ptr = &boot_heap_head;
+static inline smalloc_block_t *block_from_payload(void *p) {
+	return (smalloc_block_t *) ((uint8_t *) p - BLOCK_HDR);
+}
 
-	while (ptr && ptr->next) {
-		if (ptr->next->address >= (ptr->address + ptr->size + 2 * sizeof(struct alloc_struct_t) + actual_bytes)) {
-			break;
-		}
-		ptr = ptr->next;
+static inline smalloc_block_t *block_next(smalloc_block_t *b) {
+	return (smalloc_block_t *) ((uint8_t *) block_payload(b) + block_size(b));
+}
+
+static inline uint32_t align_up(uint32_t x, uint32_t align) {
+	return (x + align - 1) & ~(align - 1);
+}
+
+/* Size class holding blocks of this size */
+static void mapping_insert(uint32_t size, int *fl, int *sl) {
+	if (size < SMALL_BLOCK) {
+		*fl = 0;
+		*sl = size >> SMALLOC_ALIGN_LOG2;
+	} else {
+		int f = smalloc_fls(size);
+		*sl = (size >> (f - SL_LOG2)) ^ SL_COUNT;
+		*fl = f - FL_SHIFT + 1;
 	}
+}
 
-	if (!ptr->next) {
-		return 0;
+/* Size class whose blocks are all large enough for this size */
+static void mapping_search(uint32_t size, int *fl, int *sl) {
+	if (size >= SMALL_BLOCK)
+		size += (1u << (smalloc_fls(size) - SL_LOG2)) - 1;
+	mapping_insert(size, fl, sl);
+}
+
+static void free_list_insert(smalloc_block_t *b) {
+	int fl, sl;
+
+	mapping_insert(block_size(b), &fl, &sl);
+	b->prev_free = NULL;
+	b->next_free = heap.blocks[fl][sl];
+	if (b->next_free)
+		b->next_free->prev_free = b;
+	heap.blocks[fl][sl] = b;
+	heap.fl_bitmap |= 1u << fl;
+	heap.sl_bitmap[fl] |= 1u << sl;
+}
+
+static void free_list_remove(smalloc_block_t *b) {
+	int fl, sl;
+
+	mapping_insert(block_size(b), &fl, &sl);
+	if (b->prev_free)
+		b->prev_free->next_free = b->next_free;
+	else
+		heap.blocks[fl][sl] = b->next_free;
+	if (b->next_free)
+		b->next_free->prev_free = b->prev_free;
+
+	if (heap.blocks[fl][sl] == NULL) {
+		heap.sl_bitmap[fl] &= ~(1u << sl);
+		if (heap.sl_bitmap[fl] == 0)
+			heap.fl_bitmap &= ~(1u << fl);
 	}
+}
 
-	newptr = (struct alloc_struct_t *) (ptr->address + ptr->size);
-	if (!newptr) {
-		return 0;
+static smalloc_block_t *free_list_find(uint32_t size) {
+	uint32_t sl_map, fl_map;
+	int fl, sl;
+
+	mapping_search(size, &fl, &sl);
+	if (fl >= FL_COUNT)
+		return NULL;
+
+	sl_map = heap.sl_bitmap[fl] & (~0u << sl);
+	if (sl_map == 0) {
+		fl_map = heap.fl_bitmap & (~0u << (fl + 1));
+		if (fl_map == 0)
+			return NULL;
+		fl = smalloc_ffs(fl_map);
+		sl_map = heap.sl_bitmap[fl];
 	}
+	sl = smalloc_ffs(sl_map);
 
-	newptr->address = ptr->address + ptr->size + sizeof(struct alloc_struct_t);
-	newptr->size = actual_bytes;
-	newptr->o_size = num_bytes;
-	newptr->next = ptr->next;
-	ptr->next = newptr;
+	return heap.blocks[fl][sl];
+}
 
-	return (void *) newptr->address;
+static void block_mark_free(smalloc_block_t *b) {
+	b->size |= BLOCK_FREE;
+	block_next(b)->size |= BLOCK_PREV_FREE;
 }
 
-void *srealloc(void *p, uint32_t num_bytes) {
-	struct alloc_struct_t *ptr, *prev;
-	void *tmp;
-	uint32_t actual_bytes;
+static void block_mark_used(smalloc_block_t *b) {
+	b->size &= ~BLOCK_FREE;
+	block_next(b)->size &= ~BLOCK_PREV_FREE;
+}
 
-	if (!p) {
-		return smalloc(num_bytes);
-	}
-	if (!num_bytes) {
-		return p;
+/* Merge a block about to be freed with its free neighbours, returns the merged block */
+static smalloc_block_t *block_merge(smalloc_block_t *b) {
+	smalloc_block_t *next;
+
+	if (b->size & BLOCK_PREV_FREE) {
+		smalloc_block_t *prev = b->prev_phys;
+		free_list_remove(prev);
+		prev->size += BLOCK_HDR + block_size(b);
+		b = prev;
+		block_next(b)->prev_phys = b;
 	}
 
-	ptr = &boot_heap_head;
-	while (ptr && ptr->next) {
-		if (ptr->next->address == (phys_addr_t) p)
-			break;
-		ptr = ptr->next;
+	next = block_next(b);
+	if (next->size & BLOCK_FREE) {
+		free_list_remove(next);
+		b->size += BLOCK_HDR + block_size(next);
+		block_next(b)->prev_phys = b;
 	}
-	prev = ptr;
-	ptr = ptr->next;
 
-	if (!ptr) {
+	return b;
+}
+
+/* Give the tail of a used block beyond size back to the free lists */
+static void block_trim(smalloc_block_t *b, uint32_t size) {
+	smalloc_block_t *rest;
+
+	if (block_size(b) < size + BLOCK_HDR + SMALLOC_ALIGN)
+		return;
+
+	rest = (smalloc_block_t *) ((uint8_t *) block_payload(b) + size);
+	rest->size = block_size(b) - size - BLOCK_HDR;
+	rest->prev_phys = b;
+	b->size = size | (b->size & BLOCK_FLAGS);
+	block_next(rest)->prev_phys = rest;
+
+	rest = block_merge(rest);
+	block_mark_free(rest);
+	free_list_insert(rest);
+}
+
+static uint32_t request_size(uint32_t num_bytes) {
+	if (num_bytes == 0 || num_bytes > SMALLOC_MAX_SIZE)
 		return 0;
-	}
+	return align_up(num_bytes, SMALLOC_ALIGN);
+}
 
-	actual_bytes = BYTE_ALIGN(ptr->o_size + num_bytes);
-	if (actual_bytes == ptr->size) {
-		return p;
+static void *block_use(smalloc_block_t *b, uint32_t size) {
+	block_trim(b, size);
+	block_mark_used(b);
+
+	heap.allocs++;
+	heap.used += BLOCK_HDR + block_size(b);
+	if (heap.used > heap.peak)
+		heap.peak = heap.used;
+
+	return block_payload(b);
+}
+
+int32_t smalloc_init(uint32_t p_heap_head, uint32_t n_heap_size) {
+	uint32_t start = align_up(p_heap_head, SMALLOC_ALIGN);
+	uint32_t end = (p_heap_head + n_heap_size) & ~(SMALLOC_ALIGN - 1);
+	smalloc_block_t *sentinel;
+
+	memset(&heap, 0, sizeof(heap));
+
+	if (end <= start || end - start < 3 * BLOCK_HDR)
+		return -1;
+
+	/* One free block spanning the heap, closed by a used zero sized sentinel */
+	heap.first = (smalloc_block_t *) (phys_addr_t) start;
+	heap.first->prev_phys = NULL;
+	heap.first->size = end - start - 2 * BLOCK_HDR;
+	heap.total = end - start - BLOCK_HDR;
+
+	sentinel = block_next(heap.first);
+	sentinel->prev_phys = heap.first;
+	sentinel->size = 0;
+
+	block_mark_free(heap.first);
+	free_list_insert(heap.first);
+
+	return 0;
+}
+
+void *smalloc(uint32_t num_bytes) {
+	uint32_t size = request_size(num_bytes);
+	smalloc_block_t *b;
+
+	if (size == 0)
+		return NULL;
+
+	b = free_list_find(size);
+	if (b == NULL) {
+		heap.failures++;
+		return NULL;
 	}
 
-	if (ptr->next->address >= (ptr->address + actual_bytes + 2 * sizeof(struct alloc_struct_t))) {
-		ptr->size = actual_bytes;
-		ptr->o_size += num_bytes;
+	free_list_remove(b);
+	return block_use(b, size);
+}
 
-		return p;
+void *smemalign(uint32_t align, uint32_t num_bytes) {
+	uint32_t size = request_size(num_bytes);
+	phys_addr_t payload, aligned;
+	smalloc_block_t *b, *ab;
+	uint32_t gap;
+
+	if (align & (align - 1))
+		return NULL;
+	if (align <= SMALLOC_ALIGN)
+		return smalloc(num_bytes);
+	if (size == 0 || align >= SMALLOC_MAX_SIZE || size > SMALLOC_MAX_SIZE - align - 2 * BLOCK_HDR)
+		return NULL;
+
+	/* Room for the worst case gap, which must hold a free block of its own */
+	b = free_list_find(size + align + BLOCK_HDR + SMALLOC_ALIGN);
+	if (b == NULL) {
+		heap.failures++;
+		return NULL;
 	}
+	free_list_remove(b);
 
-	tmp = smalloc(actual_bytes);
-	if (!tmp) {
-		return 0;
+	payload = (phys_addr_t) block_payload(b);
+	aligned = (payload + align - 1) & ~(phys_addr_t) (align - 1);
+	gap = aligned - payload;
+	if (gap && gap < BLOCK_HDR + SMALLOC_ALIGN) {
+		aligned = (payload + BLOCK_HDR + SMALLOC_ALIGN + align - 1) & ~(phys_addr_t) (align - 1);
+		gap = aligned - payload;
 	}
-	memcpy(tmp, (void *) ptr->address, ptr->size);
-	prev->next = ptr->next; /* delete the node which need be released from the memory block chain  */
 
-	return tmp;
+	if (gap) {
+		/* The gap in front becomes a free block of its own */
+		ab = (smalloc_block_t *) (aligned - BLOCK_HDR);
+		ab->size = block_size(b) - gap;
+		ab->prev_phys = b;
+		block_next(ab)->prev_phys = ab;
+		b->size = (gap - BLOCK_HDR) | (b->size & BLOCK_FLAGS);
+		block_mark_free(b);
+		free_list_insert(b);
+		b = ab;
+	}
+
+	return block_use(b, size);
 }
 
 void sfree(void *p) {
-	struct alloc_struct_t *ptr, *prev;
+	smalloc_block_t *b;
 
 	if (p == NULL)
 		return;
 
-	ptr = &boot_heap_head;
-	while (ptr && ptr->next) {
-		if (ptr->next->address == (phys_addr_t) p)
-			break;
-		ptr = ptr->next;
+	b = block_from_payload(p);
+	if (b->size & BLOCK_FREE) {
+		printk_warning("smalloc: double free of %p\n", p);
+		return;
+	}
+
+	heap.allocs--;
+	heap.used -= BLOCK_HDR + block_size(b);
+
+	b = block_merge(b);
+	block_mark_free(b);
+	free_list_insert(b);
+}
+
+void *srealloc(void *p, uint32_t num_bytes) {
+	uint32_t size, cur;
+	smalloc_block_t *b, *next;
+	void *np;
+
+	if (p == NULL)
+		return smalloc(num_bytes);
+
+	if (num_bytes == 0) {
+		sfree(p);
+		return NULL;
 	}
 
-	prev = ptr;
-	ptr = ptr->next;
+	size = request_size(num_bytes);
+	if (size == 0)
+		return NULL;
+
+	b = block_from_payload(p);
+	cur = block_size(b);
+	next = block_next(b);
 
-	if (!ptr)
+	/* Grow into a free neighbour in place when it is large enough */
+	if (size > cur && (next->size & BLOCK_FREE) && cur + BLOCK_HDR + block_size(next) >= size) {
+		free_list_remove(next);
+		b->size += BLOCK_HDR + block_size(next);
+		block_next(b)->prev_phys = b;
+		block_mark_used(b);
+	}
+
+	if (size <= block_size(b)) {
+		block_trim(b, size);
+		heap.used += block_size(b) - cur;
+		if (heap.used > heap.peak)
+			heap.peak = heap.used;
+		return p;
+	}
+
+	np = smalloc(num_bytes);
+	if (np == NULL)
+		return NULL;
+	memcpy(np, p, cur);
+	sfree(p);
+
+	return np;
+}
+
+void smalloc_stats(smalloc_stats_t *stats) {
+	smalloc_block_t *b;
+
+	memset(stats, 0, sizeof(*stats));
+	stats->total = heap.total;
+	stats->used = heap.used;
+	stats->peak = heap.peak;
+	stats->allocs = heap.allocs;
+	stats->failures = heap.failures;
+
+	if (heap.first == NULL)
 		return;
 
-	prev->next = ptr->next;
+	for (b = heap.first; block_size(b) != 0; b = block_next(b)) {
+		if (!(b->size & BLOCK_FREE))
+			continue;
+		stats->free += block_size(b);
+		stats->free_blocks++;
+		if (block_size(b) > stats->largest_free)
+			stats->largest_free = block_size(b);
+	}
+}
+
+int smalloc_check(void) {
+	smalloc_block_t *b, *prev = NULL;
+	bool prev_free = false;
+	uint32_t used = 0;
+	int fl, sl;
+
+	if (heap.first == NULL)
+		return 0;
+
+	for (b = heap.first;; b = block_next(b)) {
+		bool is_free = b->size & BLOCK_FREE;
+
+		if (b->prev_phys != prev || !!(b->size & BLOCK_PREV_FREE) != prev_free) {
+			printk_error("smalloc: block %p has a broken link to %p\n", b, prev);
+			return -1;
+		}
+		if (is_free && prev_free) {
+			printk_error("smalloc: free blocks %p and %p not merged\n", prev, b);
+			return -1;
+		}
+		if (block_size(b) == 0 && !is_free)
+			break;
+		if (is_free) {
+			mapping_insert(block_size(b), &fl, &sl);
+			if (!(heap.sl_bitmap[fl] & (1u << sl)) || heap.blocks[fl][sl] == NULL) {
+				printk_error("smalloc: free block %p missing from its list\n", b);
+				return -1;
+			}
+		} else {
+			used += BLOCK_HDR + block_size(b);
+		}
+		prev = b;
+		prev_free = is_free;
+	}
 
-	return;
+	if (used != heap.used) {
+		printk_error("smalloc: used %u bytes, accounted %u\n", used, heap.used);
+		return -1;
+	}
+
+	return 0;
 }
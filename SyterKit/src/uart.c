@@ -5,6 +5,7 @@
 #include <stdint.h>
 #include <types.h>
 
+#include <log.h>
 #include <timer.h>
 
 #include <sys-uart.h>
@@ -25,6 +26,8 @@ void uart_log_putchar(void *arg, char c) {
 
 /* Transmit a character over the UART */
 int uart_putchar(int c) {
+	/* Queued printk output goes first */
+	log_flush();
 	if (c == '\n') {
 		/* If the character is a newline, transmit a carriage return before newline */
 		sunxi_serial_putc(&uart_dbg, '\r');
@@ -78,6 +81,8 @@ char get_uart_input(void) {
 			/* If more than 10 milliseconds have passed, exit the loop */
 			break;
 		}
+		/* Keep the log ring draining while waiting */
+		log_poll();
 		/* Delay for 500 microseconds */
 		udelay(500);
 	}
@@ -87,6 +92,7 @@ char get_uart_input(void) {
 
 /* Check if there are characters available in the input buffer */
 int tstc() {
+	log_poll();
 	return sunxi_serial_tstc(&uart_dbg);
 }
 
@@ -0,0 +1,15 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+
+/* Host build stand-in for the SyterKit logger, see malloc_stress.c */
+
+#ifndef __HOST_LOG_H__
+#define __HOST_LOG_H__
+
+#include <stdio.h>
+
+#define printk_debug(...)
+#define printk_info(...) printf(__VA_ARGS__)
+#define printk_warning(...) printf("[W] " __VA_ARGS__)
+#define printk_error(...) printf("[E] " __VA_ARGS__)
+
+#endif// __HOST_LOG_H__
@@ -0,0 +1,12 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+
+/* Host build stand-in for the architecture types.h, see malloc_stress.c */
+
+#ifndef __HOST_TYPES_H__
+#define __HOST_TYPES_H__
+
+#include <stdint.h>
+
+typedef uintptr_t phys_addr_t;
+
+#endif// __HOST_TYPES_H__
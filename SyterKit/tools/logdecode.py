@@ -0,0 +1,162 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: GPL-2.0+
+"""Decode the SyterKit binary log ring (CONFIG_LOG_BINARY).
+
+Records are read either from a console capture holding the output of the
+"binlog" shell command, or with --raw from a memory dump of the ring (for
+example read over FEL from the address "binlog" prints). Format strings and
+%s arguments pointing into the image are looked up in the ELF.
+
+usage: logdecode.py syterkit.elf console.log
+       logdecode.py --raw --head N syterkit.elf ring.bin
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+LOG_BINARY_MAGIC = 0xb10c0000
+LOG_BINARY_MAGIC_MASK = 0xffff0000
+LEVELS = {0: "M", 1: "E", 2: "W", 3: "I", 4: "D", 5: "T", 6: "B"}
+SHF_ALLOC = 0x2
+SHT_NOBITS = 8
+
+FORMAT_RE = re.compile(r"%([-+ #0]*)(\d+|\*)?(?:\.(\d+|\*))?(hh|h|ll|l|z|j|t|L)?([diouxXcspfFeEgG%])")
+
+
+class Elf:
+    """Allocated sections of an ELF32/ELF64 little or big endian image."""
+
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            data = f.read()
+        if data[:4] != b"\x7fELF":
+            sys.exit("%s: not an ELF file" % path)
+        is64 = data[4] == 2
+        endian = "<" if data[5] == 1 else ">"
+        if is64:
+            shoff, = struct.unpack_from(endian + "Q", data, 0x28)
+            shentsize, shnum = struct.unpack_from(endian + "HH", data, 0x3a)
+            shfmt = endian + "IIQQQQIIQQ"
+        else:
+            shoff, = struct.unpack_from(endian + "I", data, 0x20)
+            shentsize, shnum = struct.unpack_from(endian + "HH", data, 0x2e)
+            shfmt = endian + "IIIIIIIIII"
+        self.sections = []
+        for i in range(shnum):
+            sh = struct.unpack_from(shfmt, data, shoff + i * shentsize)
+            sh_type, sh_flags, sh_addr, sh_offset, sh_size = sh[1], sh[2], sh[3], sh[4], sh[5]
+            if sh_flags & SHF_ALLOC and sh_type != SHT_NOBITS and sh_size:
+                self.sections.append((sh_addr, data[sh_offset:sh_offset + sh_size]))
+
+    def string(self, addr):
+        """The C string at addr, None if addr is not in the image."""
+        for base, blob in self.sections:
+            if base <= addr < base + len(blob):
+                off = addr - base
+                end = blob.find(b"\0", off)
+                if end < 0:
+                    end = len(blob)
+                return blob[off:end].decode("latin-1")
+        return None
+
+
+def signed(v):
+    return v - (1 << 32) if v & 0x80000000 else v
+
+
+def render(elf, fmt, args):
+    out = []
+    pos = 0
+    args = list(args)
+    for m in FORMAT_RE.finditer(fmt):
+        out.append(fmt[pos:m.start()])
+        pos = m.end()
+        flags, width, prec, _, conv = m.groups()
+        if conv == "%":
+            out.append("%")
+            continue
+        if width == "*":
+            width = str(signed(args.pop(0)) if args else 0)
+        if prec == "*":
+            prec = str(signed(args.pop(0)) if args else 0)
+        spec = "%" + (flags or "") + (width or "") + ("." + prec if prec is not None else "")
+        v = args.pop(0) if args else 0
+        if conv in "di":
+            out.append((spec + "d") % signed(v))
+        elif conv in "ouxX":
+            out.append((spec + conv) % v)
+        elif conv == "c":
+            out.append((spec + "c") % chr(v & 0xff))
+        elif conv == "p":
+            out.append((spec + "s") % ("0x%08x" % v))
+        elif conv == "s":
+            s = elf.string(v)
+            out.append((spec + "s") % (s if s is not None else "<0x%08x>" % v))
+        else:
+            out.append((spec + conv) % struct.unpack("<f", struct.pack("<I", v))[0])
+    out.append(fmt[pos:])
+    return "".join(out)
+
+
+def read_console(path):
+    words = []
+    line_re = re.compile(r"BL [0-9a-fA-F]{8}:((?: [0-9a-fA-F]{8})+)")
+    with open(path, "r", errors="replace") as f:
+        for line in f:
+            m = line_re.search(line)
+            if m:
+                words.extend(int(w, 16) for w in m.group(1).split())
+    return words
+
+
+def read_raw(path, head):
+    with open(path, "rb") as f:
+        data = f.read()
+    words = list(struct.unpack("<%dI" % (len(data) // 4), data[:len(data) // 4 * 4]))
+    # A raw dump is the ring in memory order, rotate it to start at the oldest word
+    if head is not None and words:
+        start = head % len(words)
+        words = words[start:] + words[:start]
+    return words
+
+
+def decode(elf, words, out):
+    i = 0
+    skipped = 0
+    while i + 3 <= len(words):
+        hdr, ts, fmt_addr = words[i], words[i + 1], words[i + 2]
+        nargs = hdr & 0xff
+        fmt = elf.string(fmt_addr) if (hdr & LOG_BINARY_MAGIC_MASK) == LOG_BINARY_MAGIC else None
+        # The oldest record may have been overwritten in part, resync on the next header
+        if fmt is None or i + 3 + nargs > len(words):
+            if words[i]:
+                skipped += 1
+            i += 1
+            continue
+        level = LEVELS.get((hdr >> 8) & 0xff, "?")
+        text = render(elf, fmt, words[i + 3:i + 3 + nargs])
+        out.write("[%5u.%06u][%s] %s" % (ts // 1000000, ts % 1000000, level, text))
+        if not text.endswith("\n"):
+            out.write("\n")
+        i += 3 + nargs
+    if skipped:
+        sys.stderr.write("logdecode: skipped %d words while resyncing\n" % skipped)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode the SyterKit binary log ring")
+    parser.add_argument("elf", help="ELF image the log was recorded with")
+    parser.add_argument("input", help="console capture with 'binlog' output, or a raw ring dump with --raw")
+    parser.add_argument("--raw", action="store_true", help="input is a raw little endian dump of the ring")
+    parser.add_argument("--head", type=int, help="head index printed by 'binlog', to order a raw dump")
+    args = parser.parse_args()
+
+    elf = Elf(args.elf)
+    words = read_raw(args.input, args.head) if args.raw else read_console(args.input)
+    decode(elf, words, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()
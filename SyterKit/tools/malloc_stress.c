@@ -0,0 +1,198 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+
+/*
+ * Host stress test and benchmark for the smalloc heap (src/smalloc.c).
+ *
+ * Build with "make -C tools malloc_stress" and run as
+ * "tools/malloc_stress [loops] [seed]". The heap takes 32-bit addresses,
+ * so on 64-bit hosts it is mapped below 4GiB. Exits non-zero on the first
+ * corruption. The same checks run on the board in the malloc_bench app.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+
+#include "smalloc.h"
+
+#define HEAP_SIZE (16 * 1024 * 1024)
+#define SLOTS 512
+#define BENCH_LOOPS 1000000
+
+static uint8_t *slot_ptr[SLOTS];
+static uint32_t slot_len[SLOTS];
+
+static uint32_t rand_seed = 1;
+
+static uint32_t stress_rand(void) {
+	rand_seed = rand_seed * 1103515245 + 12345;
+	return rand_seed >> 8;
+}
+
+/* Mostly small requests, some medium ones and a few large buffers */
+static uint32_t stress_size(void) {
+	uint32_t r = stress_rand() % 100;
+
+	if (r < 70)
+		return 1 + stress_rand() % 256;
+	if (r < 95)
+		return 1 + stress_rand() % 8192;
+	return 1 + stress_rand() % 262144;
+}
+
+static uint64_t now_ns(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static void slot_fill(uint32_t i) {
+	for (uint32_t k = 0; k < slot_len[i]; k++)
+		slot_ptr[i][k] = (uint8_t) (i * 31 + k);
+}
+
+static bool slot_check(uint32_t i, uint32_t len) {
+	for (uint32_t k = 0; k < len; k++)
+		if (slot_ptr[i][k] != (uint8_t) (i * 31 + k))
+			return false;
+	return true;
+}
+
+static void slots_release(void) {
+	for (uint32_t i = 0; i < SLOTS; i++) {
+		sfree(slot_ptr[i]);
+		slot_ptr[i] = NULL;
+	}
+}
+
+/* Random allocations, frees and resizes with pattern checks */
+static int stress(uint32_t loops) {
+	for (uint32_t n = 0; n < loops; n++) {
+		uint32_t i = stress_rand() % SLOTS;
+		uint32_t op = stress_rand() % 10;
+
+		if (slot_ptr[i]) {
+			if (!slot_check(i, slot_len[i])) {
+				printf("slot %u corrupted at loop %u\n", i, n);
+				return -1;
+			}
+
+			if (op < 2) {
+				uint32_t len = stress_size();
+				uint8_t *p = srealloc(slot_ptr[i], len);
+
+				if (p) {
+					slot_ptr[i] = p;
+					if (!slot_check(i, len < slot_len[i] ? len : slot_len[i])) {
+						printf("srealloc lost data of slot %u at loop %u\n", i, n);
+						return -1;
+					}
+					slot_len[i] = len;
+					slot_fill(i);
+				}
+			} else {
+				sfree(slot_ptr[i]);
+				slot_ptr[i] = NULL;
+			}
+		} else {
+			slot_len[i] = stress_size();
+			if (op < 2) {
+				uint32_t align = 1u << (stress_rand() % 13);
+
+				slot_ptr[i] = smemalign(align, slot_len[i]);
+				if (slot_ptr[i] && ((uintptr_t) slot_ptr[i] & (align - 1))) {
+					printf("smemalign(%u) returned %p\n", align, (void *) slot_ptr[i]);
+					return -1;
+				}
+			} else {
+				slot_ptr[i] = smalloc(slot_len[i]);
+			}
+
+			if (slot_ptr[i]) {
+				if ((uintptr_t) slot_ptr[i] & 15) {
+					printf("smalloc returned unaligned %p\n", (void *) slot_ptr[i]);
+					return -1;
+				}
+				slot_fill(i);
+			}
+		}
+
+		if ((n & 1023) == 0 && smalloc_check()) {
+			printf("heap corrupted at loop %u\n", n);
+			return -1;
+		}
+	}
+
+	slots_release();
+
+	return smalloc_check();
+}
+
+static void bench(uint32_t min, uint32_t max) {
+	uint64_t start, t, total, worst = 0;
+
+	start = now_ns();
+	for (uint32_t n = 0; n < BENCH_LOOPS; n++) {
+		uint32_t i = stress_rand() % SLOTS;
+
+		t = now_ns();
+		if (slot_ptr[i]) {
+			sfree(slot_ptr[i]);
+			slot_ptr[i] = NULL;
+		} else {
+			slot_ptr[i] = smalloc(min + stress_rand() % (max - min + 1));
+		}
+		t = now_ns() - t;
+		if (t > worst)
+			worst = t;
+	}
+	total = now_ns() - start;
+
+	slots_release();
+
+	printf("alloc/free %6u..%6u: %.1f ns/op, worst %u ns\n", min, max, (double) total / BENCH_LOOPS, (uint32_t) worst);
+}
+
+int main(int argc, char **argv) {
+	uint32_t loops = argc > 1 ? strtoul(argv[1], NULL, 0) : 1000000;
+	smalloc_stats_t st;
+	void *heap;
+
+	rand_seed = argc > 2 ? strtoul(argv[2], NULL, 0) : 1;
+
+#if UINTPTR_MAX > 0xffffffffu
+#ifndef MAP_32BIT
+#error "smalloc takes 32-bit addresses, build with -m32 on this host"
+#endif
+	heap = mmap(NULL, HEAP_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0);
+#else
+	heap = mmap(NULL, HEAP_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+#endif
+	if (heap == MAP_FAILED || smalloc_init((uint32_t) (uintptr_t) heap, HEAP_SIZE)) {
+		printf("cannot set up a %u byte heap\n", HEAP_SIZE);
+		return 1;
+	}
+
+	if (stress(loops)) {
+		printf("stress FAILED\n");
+		return 1;
+	}
+
+	smalloc_stats(&st);
+	printf("stress: %u loops ok, peak %u of %u bytes, %u failed requests\n", loops, st.peak, st.total, st.failures);
+	if (st.used != 0 || st.allocs != 0 || st.free_blocks != 1) {
+		printf("heap not empty after freeing everything: used %u, live %u, %u free blocks\n", st.used, st.allocs, st.free_blocks);
+		return 1;
+	}
+
+	bench(16, 64);
+	bench(16, 4096);
+	bench(4096, 65536);
+
+	return 0;
+}
@@ -17,6 +17,7 @@
 #define MSTATUS_TVM (1 << 20)
 #define MSTATUS_TW (1 << 21)
 #define MSTATUS_TSR (1 << 22)
+#define MSTATUS_VS (3 << 23) /* C906 vector state, RVV 0.7.1 layout */
 #define MSTATUS32_SD (1 << 31)
 #define MSTATUS_UXL (3ULL << 32)
 #define MSTATUS_SXL (3ULL << 34)
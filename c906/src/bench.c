@@ -0,0 +1,138 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <types.h>
+#include <uart.h>
+
+/*
+ * memcpy/memset 周期基准: 对比标量实现与 RVV 实现,
+ * 用 mcycle 计时, 输出每周期字节数.
+ */
+
+#define BENCH_MAX_SIZE (64 * 1024)
+#define BENCH_BYTES    (1024 * 1024) /* 每个尺寸总共搬运的字节数 */
+
+extern void *memcpy_scalar(void *dest, const void *src, size_t len);
+extern void *memset_scalar(void *s, int c, size_t n);
+
+static uint8_t bench_src[BENCH_MAX_SIZE + 16] __attribute__((aligned(64)));
+static uint8_t bench_dst[BENCH_MAX_SIZE + 16] __attribute__((aligned(64)));
+
+static inline uint64_t read_mcycle(void)
+{
+	uint64_t cycle;
+
+	__asm__ __volatile__("csrr %0, mcycle" : "=r"(cycle) : : "memory");
+	return cycle;
+}
+
+/* 以 x.yy 格式打印 bytes/cycle */
+static void bench_print_rate(uint64_t bytes, uint64_t cycles)
+{
+	uint32_t rate = cycles ? (uint32_t)(bytes * 100 / cycles) : 0;
+
+	sys_uart_printf("%d.%d%d", (int)(rate / 100), (int)(rate / 10 % 10),
+			(int)(rate % 10));
+}
+
+static void bench_copy(size_t len, size_t off)
+{
+	uint32_t loops = BENCH_BYTES / len;
+	uint64_t start, scalar, vector;
+	uint32_t i;
+
+	start = read_mcycle();
+	for (i = 0; i < loops; i++)
+		memcpy_scalar(bench_dst + off, bench_src, len);
+	scalar = read_mcycle() - start;
+
+	start = read_mcycle();
+	for (i = 0; i < loops; i++)
+		memcpy(bench_dst + off, bench_src, len);
+	vector = read_mcycle() - start;
+
+	sys_uart_printf("memcpy %6d dst+%d: scalar ", (int)len, (int)off);
+	bench_print_rate((uint64_t)loops * len, scalar);
+	sys_uart_printf(" rvv ");
+	bench_print_rate((uint64_t)loops * len, vector);
+	sys_uart_printf(" B/cycle\r\n");
+}
+
+static void bench_fill(size_t len, size_t off)
+{
+	uint32_t loops = BENCH_BYTES / len;
+	uint64_t start, scalar, vector;
+	uint32_t i;
+
+	start = read_mcycle();
+	for (i = 0; i < loops; i++)
+		memset_scalar(bench_dst + off, 0x5a, len);
+	scalar = read_mcycle() - start;
+
+	start = read_mcycle();
+	for (i = 0; i < loops; i++)
+		memset(bench_dst + off, 0xa5, len);
+	vector = read_mcycle() - start;
+
+	sys_uart_printf("memset %6d dst+%d: scalar ", (int)len, (int)off);
+	bench_print_rate((uint64_t)loops * len, scalar);
+	sys_uart_printf(" rvv ");
+	bench_print_rate((uint64_t)loops * len, vector);
+	sys_uart_printf(" B/cycle\r\n");
+}
+
+static int bench_check(void)
+{
+	size_t len, off, i;
+
+	for (i = 0; i < sizeof(bench_src); i++)
+		bench_src[i] = (uint8_t)(i * 31 + (i >> 8));
+
+	/* 覆盖标量短路径, 对齐头部和向量尾部 */
+	for (len = 1; len < 300; len += 7) {
+		for (off = 0; off < 16; off += 5) {
+			memset_scalar(bench_dst, 0, len + 32);
+			memcpy(bench_dst + off, bench_src + 3, len);
+			for (i = 0; i < len; i++)
+				if (bench_dst[off + i] != bench_src[3 + i])
+					return -1;
+			if (bench_dst[off + len] != 0)
+				return -1;
+
+			memset(bench_dst + off, 0xc3, len);
+			for (i = 0; i < len; i++)
+				if (bench_dst[off + i] != 0xc3)
+					return -1;
+			if (bench_dst[off + len] != 0)
+				return -1;
+		}
+	}
+
+	return 0;
+}
+
+void string_bench(void)
+{
+	size_t len;
+
+#ifdef __riscv_vector
+	sys_uart_printf("C906 string benchmark, RVV enabled\r\n");
+#else
+	sys_uart_printf("C906 string benchmark, RVV disabled\r\n");
+#endif
+
+	if (bench_check()) {
+		sys_uart_printf("string check failed\r\n");
+		return;
+	}
+
+	for (len = 16; len <= BENCH_MAX_SIZE; len <<= 2) {
+		bench_copy(len, 0);
+		bench_copy(len, 3);
+	}
+
+	for (len = 16; len <= BENCH_MAX_SIZE; len <<= 2) {
+		bench_fill(len, 0);
+		bench_fill(len, 3);
+	}
+}
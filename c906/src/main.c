@@ -24,6 +24,10 @@
 #define DBG_PRINTF(...) do { } while (0)
 #endif
 
+#ifdef C906_STRING_BENCH
+void string_bench(void);
+#endif
+
 /* C906 侧 MSGBOX 寄存器基址 */
 #define MSGBOX_BASE_RV      0x0601f000U
 /* ARM(CPUX) 侧 MSGBOX 寄存器基址(从 C906 直接访问) */
@@ -467,6 +471,10 @@ int main(void)
 
 	DBG_PRINTF("C906 RPMsg firmware start\r\n");
 
+#ifdef C906_STRING_BENCH
+	string_bench();
+#endif
+
 	/* 根据 resource table 中的 DA 初始化 TX/RX vring */
 	vring_setup(&vr_tx, (uintptr_t)VRING0_DA, VRING_NUM, VRING_ALIGN);
 	vring_setup(&vr_rx, (uintptr_t)VRING1_DA, VRING_NUM, VRING_ALIGN);